@@ -0,0 +1,217 @@
+// Conformance and throughput test of the codecs generated by fractal-abi2cpp against ftl::pack.
+//
+// This is a native program, the ftllib headers are only used for their datastream operators:
+//
+//   fractal-abi2cpp codec_test.abi -o codec_test_codec.hpp
+//   g++ -std=gnu++17 -O2 -w -I../../libraries/ftllib/include -I../../libraries/boost/include codec_test.cpp -o codec_test
+//   ./codec_test [records]
+//
+// codec_test.abi is the abi abigen produces for the contract-side types below.
+
+#ifndef __wasm__
+// provided by the wasm libc
+typedef __int128 int128_t;
+typedef unsigned __int128 uint128_t;
+#endif
+
+#include <ftllib/datastream.hpp>
+#include <ftllib/fixed.hpp>
+#include <ftllib/name.hpp>
+
+#include "codec_test_codec.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// ftl::check ends up here, the real host aborts the action
+extern "C" void ftl_assert(uint32_t test, const char *msg) {
+    if (!test)
+        throw std::runtime_error(msg);
+}
+
+namespace contract {
+    struct leg {
+        ftl::name venue;
+        int64_t qty;
+        uint32_t price;
+    };
+
+    struct order {
+        uint64_t id;
+        ftl::name owner;
+        std::array<uint8_t, 20> trader; // ftl::address, whose header needs the host functions
+        bool buy;
+        std::string memo;
+        std::vector<leg> legs;
+        std::optional<ftl::checksum256> ref;
+        std::map<std::string, uint64_t> tags;
+        std::tuple<uint8_t, int16_t, std::string> extra;
+        int128_t delta;
+        std::vector<char> payload;
+        ftl::unsigned_int seq;
+        ftl::fixed<int64_t, 4> amount;
+    };
+
+    // what fractal-cpp generates for order, reflection can't count the fields of a struct holding an optional
+    template<typename Stream>
+    inline ftl::datastream<Stream> &operator<<(ftl::datastream<Stream> &ds, const order &v) {
+        ds << v.id << v.owner << v.trader << v.buy << v.memo << v.legs << v.ref << v.tags << v.extra
+           << v.delta << v.payload << v.seq << v.amount;
+        return ds;
+    }
+
+    template<typename Stream>
+    inline ftl::datastream<Stream> &operator>>(ftl::datastream<Stream> &ds, order &v) {
+        ds >> v.id >> v.owner >> v.trader >> v.buy >> v.memo >> v.legs >> v.ref >> v.tags >> v.extra
+           >> v.delta >> v.payload >> v.seq >> v.amount;
+        return ds;
+    }
+}
+
+static std::string random_string(std::mt19937_64 &rng, size_t max) {
+    std::string s(rng() % (max + 1), ' ');
+    for (auto &c : s)
+        c = char('a' + rng() % 26);
+    return s;
+}
+
+static codec_test::order random_order(std::mt19937_64 &rng) {
+    codec_test::order o;
+    o.id = rng();
+    o.owner = ftl_abi2cpp::name::from_string(random_string(rng, 12));
+    for (auto &b : o.trader)
+        b = uint8_t(rng());
+    o.buy = rng() & 1;
+    o.memo = random_string(rng, rng() % 8 ? 40 : 300);
+    o.legs.resize(rng() % 5);
+    for (auto &l : o.legs) {
+        l.venue.value = rng();
+        l.qty = int64_t(rng());
+        l.price = uint32_t(rng());
+    }
+    if (rng() & 1) {
+        o.ref.emplace();
+        for (auto &b : *o.ref)
+            b = uint8_t(rng());
+    }
+    // map order, the contract side is a std::map
+    std::map<std::string, uint64_t> tags;
+    for (size_t i = rng() % 4; i; i--)
+        tags[random_string(rng, 10)] = rng();
+    for (const auto &t : tags)
+        o.tags.push_back({t.first, t.second});
+    o.extra = {uint8_t(rng()), int16_t(rng()), random_string(rng, 20)};
+    o.delta = (int128_t(int64_t(rng())) << 64) | rng();
+    o.payload.resize(rng() % 64);
+    for (auto &b : o.payload)
+        b = char(rng());
+    o.seq.value = uint32_t(rng() >> (rng() % 33));
+    o.amount = int64_t(rng());
+    return o;
+}
+
+static contract::order to_contract(const codec_test::order &g) {
+    contract::order o;
+    o.id = g.id;
+    o.owner = ftl::name(g.owner.value);
+    o.trader = g.trader;
+    o.buy = g.buy;
+    o.memo = g.memo;
+    for (const auto &l : g.legs)
+        o.legs.push_back({ftl::name(l.venue.value), l.qty, l.price});
+    if (g.ref) {
+        o.ref.emplace();
+        memcpy(o.ref->hash, g.ref->data(), 32);
+    }
+    for (const auto &t : g.tags)
+        o.tags[t.key] = t.value;
+    o.extra = std::make_tuple(g.extra.field_0, g.extra.field_1, g.extra.field_2);
+    o.delta = g.delta;
+    o.payload = g.payload;
+    o.seq = g.seq.value;
+    o.amount = ftl::fixed<int64_t, 4>::from_raw(g.amount);
+    return o;
+}
+
+template<typename F>
+static double seconds(F &&f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    size_t records = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    std::mt19937_64 rng(42);
+
+    std::vector<codec_test::order> generated;
+    std::vector<contract::order> reference;
+    size_t total_bytes = 0;
+    for (size_t i = 0; i < records; i++) {
+        generated.push_back(random_order(rng));
+        reference.push_back(to_contract(generated.back()));
+
+        std::vector<char> expected = ftl::pack(reference.back());
+        std::vector<char> got = ftl_abi2cpp::pack(generated.back());
+        if (got != expected) {
+            printf("record %zu: encoding differs from ftl::pack\n", i);
+            return 1;
+        }
+        if (ftl_abi2cpp::pack(ftl_abi2cpp::unpack<codec_test::order>(expected)) != expected ||
+            ftl::pack(ftl::unpack<contract::order>(got)) != got) {
+            printf("record %zu: round trip differs\n", i);
+            return 1;
+        }
+        bool threw = false;
+        try {
+            ftl_abi2cpp::unpack<codec_test::order>(expected.data(), expected.size() - 1);
+        } catch (std::out_of_range &) {
+            threw = true;
+        }
+        if (!threw) {
+            printf("record %zu: truncated input decoded\n", i);
+            return 1;
+        }
+        total_bytes += expected.size();
+    }
+    printf("%zu records, %zu bytes: identical to ftl::pack\n", records, total_bytes);
+
+    std::vector<char> buffer;
+    buffer.reserve(total_bytes);
+    auto report = [&](const char *what, double s) {
+        printf("%-28s %8.1f ms %10.0f records/s %8.1f MB/s\n", what, s * 1e3, records / s, total_bytes / s / 1e6);
+    };
+
+    report("ftl::pack", seconds([&] {
+        buffer.clear();
+        for (const auto &o : reference) {
+            auto packed = ftl::pack(o);
+            buffer.insert(buffer.end(), packed.begin(), packed.end());
+        }
+    }));
+    report("ftl_abi2cpp::pack", seconds([&] {
+        buffer.clear();
+        for (const auto &o : generated)
+            ftl_abi2cpp::pack(buffer, o);
+    }));
+
+    size_t sink = 0;
+    report("ftl::unpack", seconds([&] {
+        ftl::datastream<const char *> ds(buffer.data(), buffer.size());
+        contract::order o;
+        for (size_t i = 0; i < records; i++) {
+            ds >> o;
+            sink += o.memo.size();
+        }
+    }));
+    report("ftl_abi2cpp::unpack", seconds([&] {
+        ftl_abi2cpp::reader r(buffer.data(), buffer.size());
+        codec_test::order o;
+        for (size_t i = 0; i < records; i++) {
+            ftl_abi2cpp::codec<codec_test::order>::decode(r, o);
+            sink += o.memo.size();
+        }
+    }));
+    return sink == 0;
+}
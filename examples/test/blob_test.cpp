@@ -0,0 +1,58 @@
+#include <ftllib/dispatcher.hpp>
+#include <ftllib/map.hpp>
+#include <ftllib/print.hpp>
+
+using namespace ftl;
+
+DEF_BLOB_TABLE(uint64_t, std::string, docs, docs_table)
+
+// whether chunk i of the blob under key is stored, see blob.hpp for the chunk keys
+static bool has_chunk(uint64_t key, uint32_t i) {
+    MapKey pk(key);
+    for (size_t b = 0; b < sizeof(i); ++b)
+        pk.bytes[pk.length + b] = uint8_t(i >> (8 * (sizeof(i) - 1 - b)));
+    return internal_use_do_not_use::db_has_key(ftl::name("docs").value | 1, pk.bytes, pk.length + sizeof(i));
+}
+
+class [[ftl::contract("test")]] test {
+public:
+    // a writer that grows the blob then truncates it below its old size removes every chunk it stored
+    [[ftl::action]]
+    void test1() {
+        docs_table t;
+        t.put(1, std::string(498, 'a'));
+        check(t.size(1) == 500, "size");
+        {
+            auto ds = t.writer(1);
+            std::string b(5000, 'b');
+            ds.write(b.data(), b.size());
+            ds.seekp(100);
+            ds.truncate();
+        }
+        check(t.size(1) == 100, "size after truncate");
+        check(has_chunk(1, 0), "chunk 0 removed");
+        for (uint32_t i = 1; i < 5; ++i)
+            check(!has_chunk(1, i), "chunk past the end kept");
+
+        t.erase(1);
+        check(!t.has_key(1) && !has_chunk(1, 0), "blob kept after erase");
+        print("ok");
+    }
+
+    // patches a few bytes of a large blob in place
+    [[ftl::action]]
+    void test2() {
+        docs_table t;
+        t.put(2, std::string(100000, 'a'));
+        {
+            auto ds = t.writer(2, 50000);
+            ds.write("patch", 5);
+        }
+        std::string doc = t.get(2);
+        check(doc.size() == 100000 && doc.compare(50000 - 3, 5, "patch") == 0, "patch");
+        t.erase(2);
+        print("ok");
+    }
+};
+
+FTL_DISPATCH(test, (test1)(test2))
@@ -0,0 +1,43 @@
+#include <ftllib/dispatcher.hpp>
+#include <ftllib/print.hpp>
+
+using namespace ftl;
+
+// long double is binary128 on wasm32, every operation on it is a __*tf* call into
+// ftl_builtins instead of the host.
+class [[ftl::contract("test")]] test {
+public:
+    // int128_test's compound interest in floating point, one __multf3 per period
+    [[ftl::action]]
+    void test1(uint64_t principal, uint32_t rate_ppm, uint32_t periods) {
+        const long double factor = 1 + rate_ppm / 1e6L;
+
+        long double balance = principal;
+        for (uint32_t i = 0; i < periods; i++) {
+            balance = balance * factor;
+        }
+        print(balance);
+    }
+
+    // exact results of each family of builtins, volatile keeps the compiler from folding them
+    [[ftl::action]]
+    void test2() {
+        volatile long double a = 1.5L, b = 0.25L, third = 1.0L / 3;
+        check(a + b == 1.75L && a - b == 1.25L && a * b == 0.375L && a / b == 6.0L, "arithmetic");
+        check(a > b && b < a && a >= a && b <= a && a != b && -a < 0, "compare");
+
+        volatile int64_t i = -7;
+        volatile uint64_t big = 9007199254740993ULL;  // 2^53 + 1, exact in a long double but not a double
+        check(i / 2.0L == -3.5L && (long double) big - 9007199254740992ULL == 1, "from integer");
+        check((int64_t) (i / 2.0L) == -3 && (uint64_t) (a * 2e18L) == 3000000000000000000ULL, "to integer");
+        check(uint128_t(a * 1e30L) == uint128_t(1500000000000000ULL) * 1000000000000000ULL, "to uint128");
+
+        volatile double d = 0.1;
+        volatile float f = 0.1f;
+        check((double) (long double) d == d && (float) (long double) f == f, "extend");
+        check((double) third == 1.0 / 3 && (float) third == 1.0f / 3, "truncate");
+        print("ok");
+    }
+};
+
+FTL_DISPATCH(test, (test1)(test2))
@@ -0,0 +1,61 @@
+#include <ftllib/dispatcher.hpp>
+#include <ftllib/print.hpp>
+
+#include <vector>
+
+using namespace ftl;
+
+namespace market {
+    struct quote {
+        uint64_t price;
+        uint64_t amount;
+    };
+}
+
+// Counts the writes made to it. The serializer fractal-cpp generates for market::quote copies
+// price and amount with one write, the reflection based operator of datastream.hpp writes each
+// field. The tag is in a namespace of its own so it adds nothing to argument dependent lookup.
+namespace counting {
+    struct write_counter {};
+}
+
+namespace ftl {
+    template<>
+    class datastream<counting::write_counter> {
+    public:
+        inline bool write(const char *, size_t s) {
+            ++writes;
+            _size += s;
+            return true;
+        }
+
+        inline bool put(char c) { return write(&c, 1); }
+
+        inline bool valid() const { return true; }
+
+        inline size_t tellp() const { return _size; }
+
+        inline size_t remaining() const { return 0; }
+
+        int writes = 0;
+
+    private:
+        size_t _size = 0;
+    };
+}
+
+class [[ftl::contract("test")]] test {
+public:
+    // the quotes are written by the vector operator in ftl, where unqualified lookup stops at
+    // ftl::operator<< and only the namespace of market::quote can add the generated one
+    [[ftl::action]]
+    void test1(market::quote q) {
+        datastream<counting::write_counter> ds;
+        ds << std::vector<market::quote>(2, q);
+        // one for the length, one per quote
+        check(ds.writes == 3, "the generated serializer of market::quote was not selected");
+        print(q.price * q.amount);
+    }
+};
+
+FTL_DISPATCH(test, (test1))
@@ -14,6 +14,17 @@ public:
         //hash.hash[0] = 0;
         ftl::assert_sha256(test, sizeof(test), &hash);
     }
+
+    [[ftl::action]]
+    void test2(std::vector<std::string> items) {
+        // hash the serialized vector without packing it into a buffer, then check the
+        // in-contract digest against the host one computed over the packed bytes
+        checksum256 hash = ftl::pack_hash(items);
+        printhex(hash.hash, 32);
+
+        std::vector<char> packed = ftl::pack(items);
+        ftl::assert_sha256(packed.data(), packed.size(), &hash);
+    }
 };
 
-FTL_DISPATCH(test, (test1))
+FTL_DISPATCH(test, (test1)(test2))
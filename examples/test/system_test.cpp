@@ -6,19 +6,19 @@ using namespace ftl;
 
 class [[ftl::contract("test")]] test {
 public:
-    [[ftl::action]]
+    [[ftl::action(readonly)]]
     void test1() {
         uint64_t t = current_block_time();
         print(t);
     }
 
-    [[ftl::action]]
+    [[ftl::action(readonly)]]
     void test2() {
         uint64_t h = current_block_height();
         print(h);
     }
 
-    [[ftl::action]]
+    [[ftl::action(readonly)]]
     void test3() {
         checksum256 simple_hash;
         checksum256 full_hash;
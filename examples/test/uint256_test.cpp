@@ -0,0 +1,99 @@
+#include <ftllib/dispatcher.hpp>
+#include <ftllib/fixed.hpp>
+#include <ftllib/print.hpp>
+
+using namespace ftl;
+
+// Naive 256-bit integer on a little-endian byte array, the way contracts usually
+// rolled their own before uint256 existed, used by test2.
+struct bytes256 {
+    uint8_t b[32] = {};
+
+    static bytes256 from(uint64_t v) {
+        bytes256 r;
+        for (int i = 0; i < 8; i++)
+            r.b[i] = uint8_t(v >> (8 * i));
+        return r;
+    }
+
+    bool less(const bytes256 &o) const {
+        for (int i = 31; i >= 0; i--)
+            if (b[i] != o.b[i])
+                return b[i] < o.b[i];
+        return false;
+    }
+
+    bytes256 sub(const bytes256 &o) const {
+        bytes256 r;
+        int borrow = 0;
+        for (int i = 0; i < 32; i++) {
+            int d = int(b[i]) - o.b[i] - borrow;
+            borrow = d < 0;
+            r.b[i] = uint8_t(d + (borrow << 8));
+        }
+        return r;
+    }
+
+    bytes256 mul(const bytes256 &o) const {
+        bytes256 r;
+        for (int i = 0; i < 32; i++) {
+            uint32_t carry = 0;
+            for (int j = 0; i + j < 32; j++) {
+                uint32_t t = r.b[i + j] + uint32_t(b[i]) * o.b[j] + carry;
+                r.b[i + j] = uint8_t(t);
+                carry = t >> 8;
+            }
+        }
+        return r;
+    }
+
+    bytes256 div(const bytes256 &o) const {
+        bytes256 q, rem;
+        for (int bit = 255; bit >= 0; bit--) {
+            for (int i = 31; i > 0; i--)
+                rem.b[i] = uint8_t((rem.b[i] << 1) | (rem.b[i - 1] >> 7));
+            rem.b[0] = uint8_t((rem.b[0] << 1) | ((b[bit / 8] >> (bit % 8)) & 1));
+            if (!rem.less(o)) {
+                rem = rem.sub(o);
+                q.b[bit / 8] |= uint8_t(1 << (bit % 8));
+            }
+        }
+        return q;
+    }
+};
+
+// Compound interest on an 18 decimals balance, test1 uses ftl::fixed<uint256, 18>,
+// test2 the byte array version above. Their instruction counts haven't been measured.
+class [[ftl::contract("test")]] test {
+public:
+    using amount = fixed<uint256, 18>;
+
+    [[ftl::action]]
+    void test1(uint64_t principal, uint32_t rate_ppm, uint32_t periods) {
+        const amount factor = amount(uint256(1)) + amount::from_raw(uint256(rate_ppm) * uint256(1000000000000ULL));
+
+        amount balance = amount(uint256(principal));
+        for (uint32_t i = 0; i < periods; i++) {
+            balance = balance * factor;
+        }
+        print(balance);
+    }
+
+    [[ftl::action]]
+    void test2(uint64_t principal, uint32_t rate_ppm, uint32_t periods) {
+        const bytes256 one = bytes256::from(1000000000000000000ULL);
+        const bytes256 factor = bytes256::from(1000000000000000000ULL + uint64_t(rate_ppm) * 1000000000000ULL);
+
+        bytes256 balance = bytes256::from(principal).mul(one);
+        for (uint32_t i = 0; i < periods; i++) {
+            balance = balance.mul(factor).div(one);
+        }
+        uint64_t whole = 0;
+        bytes256 integer = balance.div(one);
+        for (int i = 7; i >= 0; i--)
+            whole = (whole << 8) | integer.b[i];
+        print(whole);
+    }
+};
+
+FTL_DISPATCH(test, (test1)(test2))
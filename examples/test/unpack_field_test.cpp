@@ -0,0 +1,41 @@
+#include <ftllib/dispatcher.hpp>
+#include <ftllib/map.hpp>
+#include <ftllib/print.hpp>
+
+using namespace ftl;
+
+namespace ledger {
+    // packed amount first, unlike its fields
+    struct entry {
+        std::string memo;
+        uint64_t amount;
+    };
+
+    template<typename Stream>
+    datastream<Stream> &operator<<(datastream<Stream> &ds, const entry &v) {
+        return ds << v.amount << v.memo;
+    }
+
+    template<typename Stream>
+    datastream<Stream> &operator>>(datastream<Stream> &ds, entry &v) {
+        return ds >> v.amount >> v.memo;
+    }
+}
+
+DEF_TABLE(uint64_t, ledger::entry, entries, entries_table)
+
+class [[ftl::contract("test")]] test {
+public:
+    // a member of a struct with its own operator>> is read by unpacking the whole struct with it
+    [[ftl::action]]
+    void test1() {
+        entries_table t;
+        t.put(1, ledger::entry{"rent", 1200});
+        check(t.get_field<&ledger::entry::amount>(1) == 1200, "amount");
+        check(t.get_field<&ledger::entry::memo>(1) == "rent", "memo");
+        check(t.get_lazy(1).get<&ledger::entry::memo>() == "rent", "lazy memo");
+        print("ok");
+    }
+};
+
+FTL_DISPATCH(test, (test1))
@@ -0,0 +1,70 @@
+#include <ftllib/dispatcher.hpp>
+#include <ftllib/map.hpp>
+#include <ftllib/print.hpp>
+
+using namespace ftl;
+
+struct trade {
+    uint64_t price;
+    std::string side;
+};
+
+DEF_VECTOR_TABLE(trade, trades, trades_table)
+
+// whether element index is stored, see vector_table for the keys
+static bool has_element(uint64_t index) {
+    MapKey pk(index);
+    return internal_use_do_not_use::db_has_key(ftl::name("trades").value, pk.bytes, pk.length);
+}
+
+class [[ftl::contract("test")]] test {
+public:
+    // push_back appends at the end and get reads back what each push stored
+    [[ftl::action]]
+    void test1() {
+        trades_table t;
+        check(t.empty(), "not empty");
+        for (uint64_t i = 0; i < 10; ++i)
+            check(t.push_back(trade{100 + i, i % 2 ? "sell" : "buy"}) == i, "push_back index");
+        check(t.size() == 10, "size");
+        for (uint64_t i = 0; i < 10; ++i) {
+            trade tr = t.get(i);
+            check(tr.price == 100 + i && tr.side == (i % 2 ? "sell" : "buy"), "get");
+        }
+        check(t.back().price == 109, "back");
+
+        std::vector<trade> range = t.get_range(3, 4);
+        check(range.size() == 4 && range[0].price == 103 && range[3].price == 106, "get_range");
+
+        t.set(5, trade{1, "buy"});
+        check(t.get(5).price == 1 && t.get(6).price == 106, "set");
+        print("ok");
+    }
+
+    // truncate removes the elements past the new size, later pushes reuse their indexes
+    [[ftl::action]]
+    void test2() {
+        trades_table t;
+        t.truncate(0);
+        for (uint64_t i = 0; i < 8; ++i)
+            t.push_back(trade{i, "buy"});
+
+        t.truncate(3);
+        check(t.size() == 3 && t.back().price == 2, "size after truncate");
+        check(has_element(2), "element before size removed");
+        for (uint64_t i = 3; i < 8; ++i)
+            check(!has_element(i), "element past size kept");
+
+        t.pop_back();
+        check(t.size() == 2 && !has_element(2), "pop_back");
+
+        check(t.push_back(trade{42, "sell"}) == 2, "push_back after truncate");
+        check(t.get(2).price == 42 && t.size() == 3, "get after truncate");
+
+        t.truncate(0);
+        check(t.empty() && !has_element(0), "truncate to empty");
+        print("ok");
+    }
+};
+
+FTL_DISPATCH(test, (test1)(test2))
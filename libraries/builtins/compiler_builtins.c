@@ -0,0 +1,196 @@
+/**
+ *  128-bit integer builtins for wasm32.
+ *
+ *  clang lowers multiplication, division and shifts of __int128 to calls into these
+ *  functions. They are implemented on 64-bit halves only, so none of them calls back
+ *  into another builtin, and a contract linked against this library does not import
+ *  them from the host.
+ */
+
+#include "u128.h"
+
+static u128 udivmod(u128 a, u128 b, u128 *rem) {
+    u128 q = {0, 0};
+    if (b.high == 0 && b.low == 0)
+        __builtin_trap();
+
+    // both operands fit the native i64 division
+    if (a.high == 0 && b.high == 0) {
+        q.low = a.low / b.low;
+        if (rem) {
+            rem->low = a.low % b.low;
+            rem->high = 0;
+        }
+        return q;
+    }
+    if (less(a, b)) {
+        if (rem)
+            *rem = a;
+        return q;
+    }
+
+    // shift-subtract, starting at the highest bit the quotient can have
+    unsigned shift = clz(b) - clz(a);
+    b = shl(b, shift);
+    for (unsigned i = 0; i <= shift; i++) {
+        q = shl(q, 1);
+        if (!less(a, b)) {
+            a = sub(a, b);
+            q.low |= 1;
+        }
+        b = lshr(b, 1);
+    }
+    if (rem)
+        *rem = a;
+    return q;
+}
+
+ti_int __ashlti3(ti_int a, int b) {
+    return (ti_int) from_u128(shl(make_u128((tu_int) a), b));
+}
+
+ti_int __lshlti3(ti_int a, int b) {
+    return (ti_int) from_u128(shl(make_u128((tu_int) a), b));
+}
+
+tu_int __lshrti3(tu_int a, int b) {
+    return from_u128(lshr(make_u128(a), b));
+}
+
+ti_int __ashrti3(ti_int a, int b) {
+    u128 x = make_u128((tu_int) a);
+    u128 r;
+    if (b == 0) {
+        r = x;
+    } else if (b < 64) {
+        r.low = (x.low >> b) | (x.high << (64 - b));
+        r.high = (uint64_t) ((int64_t) x.high >> b);
+    } else {
+        r.low = (uint64_t) ((int64_t) x.high >> (b - 64));
+        r.high = (uint64_t) ((int64_t) x.high >> 63);
+    }
+    return (ti_int) from_u128(r);
+}
+
+ti_int __multi3(ti_int a, ti_int b) {
+    u128 x = make_u128((tu_int) a);
+    u128 y = make_u128((tu_int) b);
+
+    // the cross terms only land in the high word
+    u128 r = mul_64x64(x.low, y.low);
+    r.high += x.high * y.low + x.low * y.high;
+    return (ti_int) from_u128(r);
+}
+
+tu_int __udivti3(tu_int a, tu_int b) {
+    return from_u128(udivmod(make_u128(a), make_u128(b), 0));
+}
+
+tu_int __umodti3(tu_int a, tu_int b) {
+    u128 r;
+    udivmod(make_u128(a), make_u128(b), &r);
+    return from_u128(r);
+}
+
+ti_int __divti3(ti_int a, ti_int b) {
+    u128 x = make_u128((tu_int) a);
+    u128 y = make_u128((tu_int) b);
+    int negative = is_negative(x) != is_negative(y);
+    if (is_negative(x))
+        x = neg(x);
+    if (is_negative(y))
+        y = neg(y);
+    u128 q = udivmod(x, y, 0);
+    return (ti_int) from_u128(negative ? neg(q) : q);
+}
+
+ti_int __modti3(ti_int a, ti_int b) {
+    u128 x = make_u128((tu_int) a);
+    u128 y = make_u128((tu_int) b);
+    int negative = is_negative(x);
+    u128 r;
+    if (negative)
+        x = neg(x);
+    if (is_negative(y))
+        y = neg(y);
+    udivmod(x, y, &r);
+    return (ti_int) from_u128(negative ? neg(r) : r);
+}
+
+static double u128_to_double(u128 a) {
+    if (a.high == 0)
+        return (double) a.low;
+
+    // keep the top 64 bits and fold everything shifted out into a sticky bit, the native
+    // u64 -> f64 conversion then rounds exactly like a full 128-bit conversion would
+    unsigned shift = 64 - clz(a);
+    u128 dropped = shl(a, 128 - shift);
+    uint64_t top = lshr(a, shift).low | ((dropped.low | dropped.high) != 0);
+
+    double_bits scale;
+    scale.u = (uint64_t) (1023 + shift) << 52;
+    return (double) top * scale.f;
+}
+
+double __floatuntidf(tu_int a) {
+    return u128_to_double(make_u128(a));
+}
+
+double __floattidf(ti_int a) {
+    u128 x = make_u128((tu_int) a);
+    if (is_negative(x))
+        return -u128_to_double(neg(x));
+    return u128_to_double(x);
+}
+
+// truncates toward zero, out of range values saturate
+static u128 double_to_u128(double a, int is_signed, int *negative) {
+    double_bits bits;
+    bits.f = a;
+    int exponent = (int) ((bits.u >> 52) & 0x7ff) - 1023;
+    uint64_t significand = (bits.u & ((1ULL << 52) - 1)) | (1ULL << 52);
+    u128 r = {0, 0};
+
+    *negative = (int) (bits.u >> 63);
+    if (exponent < 0)
+        return r;
+    if (exponent >= (is_signed ? 127 : 128)) {
+        r.low = ~0ULL;
+        r.high = is_signed ? ~0ULL >> 1 : ~0ULL;
+        return r;
+    }
+    r.low = significand;
+    return exponent > 52 ? shl(r, exponent - 52) : lshr(r, 52 - exponent);
+}
+
+ti_int __fixdfti(double a) {
+    int negative;
+    u128 r = double_to_u128(a, 1, &negative);
+    if (negative) {
+        if (r.high == ~0ULL >> 1 && r.low == ~0ULL) {
+            r.low = 0;
+            r.high = 1ULL << 63;
+            return (ti_int) from_u128(r);
+        }
+        r = neg(r);
+    }
+    return (ti_int) from_u128(r);
+}
+
+tu_int __fixunsdfti(double a) {
+    int negative;
+    u128 r = double_to_u128(a, 0, &negative);
+    if (negative) {
+        r.low = 0;
+        r.high = 0;
+    }
+    return from_u128(r);
+}
+
+ti_int __fixsfti(float a) {
+    return __fixdfti((double) a);
+}
+
+tu_int __fixunssfti(float a) {
+    return __fixunsdfti((double) a);
+}
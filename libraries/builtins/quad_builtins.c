@@ -0,0 +1,548 @@
+/**
+ *  Quadruple precision (long double) builtins for wasm32.
+ *
+ *  long double is IEEE binary128 on wasm32 and clang lowers every operation on it to a call
+ *  into these functions. They work on the bits of the value with 64-bit integer arithmetic
+ *  only, round to nearest even and raise no exceptions, the way the default floating point
+ *  environment of wasm does.
+ */
+
+#include "u128.h"
+
+typedef long double tf_float;
+
+typedef union {
+    tf_float f;
+    u128 u;
+} quad_bits;
+
+typedef union {
+    float f;
+    uint32_t u;
+} float_bits;
+
+// layout of the high word: sign, 15 bits of exponent and the top 48 of the 112 fraction bits
+#define SIGN_BIT (1ULL << 63)
+#define EXP_SHIFT 48
+#define EXP_MAX 0x7fff
+#define EXP_BIAS 16383
+#define FRAC_BITS 112
+#define FRAC_HIGH_MASK ((1ULL << EXP_SHIFT) - 1)
+#define IMPLICIT_HIGH (1ULL << EXP_SHIFT)
+#define QUIET_HIGH (1ULL << (EXP_SHIFT - 1))
+
+// significands carry 3 bits below the last fraction bit while rounding: guard, round and sticky
+#define GUARD_BITS 3
+
+static inline u128 to_bits(tf_float a) {
+    quad_bits b;
+    b.f = a;
+    return b.u;
+}
+
+static inline tf_float from_bits(u128 a) {
+    quad_bits b;
+    b.u = a;
+    return b.f;
+}
+
+static inline u128 make_quad(uint64_t sign, uint64_t exponent, uint64_t frac_high, uint64_t frac_low) {
+    u128 r;
+    r.low = frac_low;
+    r.high = sign | (exponent << EXP_SHIFT) | frac_high;
+    return r;
+}
+
+static inline u128 abs_bits(u128 a) {
+    a.high &= ~SIGN_BIT;
+    return a;
+}
+
+static inline int exponent_of(u128 a) {
+    return (int) ((a.high >> EXP_SHIFT) & EXP_MAX);
+}
+
+static inline u128 frac_of(u128 a) {
+    a.high &= FRAC_HIGH_MASK;
+    return a;
+}
+
+static inline int is_nan(u128 abs) {
+    return abs.high > ((uint64_t) EXP_MAX << EXP_SHIFT) ||
+           (abs.high == ((uint64_t) EXP_MAX << EXP_SHIFT) && abs.low);
+}
+
+static inline int is_inf(u128 abs) {
+    return abs.high == ((uint64_t) EXP_MAX << EXP_SHIFT) && !abs.low;
+}
+
+static inline u128 quiet_nan(void) {
+    return make_quad(0, EXP_MAX, QUIET_HIGH, 0);
+}
+
+// the significand of a finite nonzero value with the implicit bit at FRAC_BITS, subnormals are
+// shifted up to it and their exponent lowered to match
+static inline u128 significand_of(u128 abs, int *exponent) {
+    u128 sig = frac_of(abs);
+    *exponent = exponent_of(abs);
+    if (*exponent) {
+        sig.high |= IMPLICIT_HIGH;
+    } else {
+        unsigned shift = clz(sig) - (127 - FRAC_BITS);
+        sig = shl(sig, shift);
+        *exponent = 1 - (int) shift;
+    }
+    return sig;
+}
+
+// rounds sig, whose implicit bit is at FRAC_BITS + GUARD_BITS, to a value with the biased exponent
+static tf_float round_pack(uint64_t sign, int exponent, u128 sig) {
+    if (exponent >= EXP_MAX)
+        return from_bits(make_quad(sign, EXP_MAX, 0, 0));
+    if (exponent <= 0) {
+        sig = lshr_sticky(sig, 1 - exponent);
+        exponent = 0;
+    }
+    unsigned round = sig.low & 7;
+    u128 r = lshr(sig, GUARD_BITS);
+    // a normal value drops its implicit bit, a subnormal one that rounds up to it becomes normal
+    r = make_quad(sign, exponent, r.high & FRAC_HIGH_MASK, r.low);
+    if (round > 4 || (round == 4 && (r.low & 1))) {
+        u128 one = {1, 0};
+        r = add(r, one);
+    }
+    return from_bits(r);
+}
+
+// converts a magnitude exactly or rounded when it has more bits than the significand
+static tf_float from_integer(uint64_t sign, u128 a) {
+    if (is_zero(a))
+        return from_bits(make_quad(sign, 0, 0, 0));
+    int top = 127 - (int) clz(a);
+    const int lead = FRAC_BITS + GUARD_BITS;
+    u128 sig = top > lead ? lshr_sticky(a, top - lead) : shl(a, lead - top);
+    return round_pack(sign, EXP_BIAS + top, sig);
+}
+
+tf_float __addtf3(tf_float x, tf_float y) {
+    u128 a = to_bits(x), b = to_bits(y);
+    u128 a_abs = abs_bits(a), b_abs = abs_bits(b);
+
+    if (is_nan(a_abs)) {
+        a.high |= QUIET_HIGH;
+        return from_bits(a);
+    }
+    if (is_nan(b_abs)) {
+        b.high |= QUIET_HIGH;
+        return from_bits(b);
+    }
+    if (is_inf(a_abs))
+        return is_inf(b_abs) && (a.high ^ b.high) & SIGN_BIT ? from_bits(quiet_nan()) : x;
+    if (is_inf(b_abs))
+        return y;
+    if (is_zero(a_abs)) {
+        // -0 + -0 is -0, any other sum of zeros +0
+        if (is_zero(b_abs)) {
+            a.high &= b.high;
+            return from_bits(a);
+        }
+        return y;
+    }
+    if (is_zero(b_abs))
+        return x;
+
+    // a has the larger magnitude and gives the sign
+    if (less(a_abs, b_abs)) {
+        u128 t = a;
+        a = b;
+        b = t;
+        t = a_abs;
+        a_abs = b_abs;
+        b_abs = t;
+    }
+    uint64_t sign = a.high & SIGN_BIT;
+    int subtract = ((a.high ^ b.high) & SIGN_BIT) != 0;
+    int a_exp, b_exp;
+    u128 a_sig = shl(significand_of(a_abs, &a_exp), GUARD_BITS);
+    u128 b_sig = shl(significand_of(b_abs, &b_exp), GUARD_BITS);
+    b_sig = lshr_sticky(b_sig, a_exp - b_exp);
+
+    const unsigned lead = FRAC_BITS + GUARD_BITS;
+    if (subtract) {
+        a_sig = sub(a_sig, b_sig);
+        if (is_zero(a_sig))
+            return from_bits(make_quad(0, 0, 0, 0));
+        unsigned shift = clz(a_sig) - (127 - lead);
+        a_sig = shl(a_sig, shift);
+        a_exp -= shift;
+    } else {
+        a_sig = add(a_sig, b_sig);
+        if (clz(a_sig) < 127 - lead) {
+            a_sig = lshr_sticky(a_sig, 1);
+            a_exp += 1;
+        }
+    }
+    return round_pack(sign, a_exp, a_sig);
+}
+
+tf_float __subtf3(tf_float x, tf_float y) {
+    u128 b = to_bits(y);
+    b.high ^= SIGN_BIT;
+    return __addtf3(x, from_bits(b));
+}
+
+tf_float __negtf2(tf_float x) {
+    u128 a = to_bits(x);
+    a.high ^= SIGN_BIT;
+    return from_bits(a);
+}
+
+tf_float __multf3(tf_float x, tf_float y) {
+    u128 a = to_bits(x), b = to_bits(y);
+    u128 a_abs = abs_bits(a), b_abs = abs_bits(b);
+    uint64_t sign = (a.high ^ b.high) & SIGN_BIT;
+
+    if (is_nan(a_abs)) {
+        a.high |= QUIET_HIGH;
+        return from_bits(a);
+    }
+    if (is_nan(b_abs)) {
+        b.high |= QUIET_HIGH;
+        return from_bits(b);
+    }
+    if (is_inf(a_abs) || is_inf(b_abs)) {
+        if (is_zero(a_abs) || is_zero(b_abs))
+            return from_bits(quiet_nan());
+        return from_bits(make_quad(sign, EXP_MAX, 0, 0));
+    }
+    if (is_zero(a_abs) || is_zero(b_abs))
+        return from_bits(make_quad(sign, 0, 0, 0));
+
+    int a_exp, b_exp;
+    u128 a_sig = significand_of(a_abs, &a_exp);
+    u128 b_sig = significand_of(b_abs, &b_exp);
+
+    // 113 x 113 bits, the product has its leading bit at 224 or 225
+    u128 p00 = mul_64x64(a_sig.low, b_sig.low);
+    u128 p01 = mul_64x64(a_sig.low, b_sig.high);
+    u128 p10 = mul_64x64(a_sig.high, b_sig.low);
+    u128 p11 = mul_64x64(a_sig.high, b_sig.high);
+    u128 mid = {p00.high, 0};
+    u128 t = {p01.low, 0};
+    mid = add(mid, t);
+    t.low = p10.low;
+    mid = add(mid, t);
+    u128 lo = {p00.low, mid.low};
+    u128 hi = p11;
+    t.low = p01.high;
+    hi = add(hi, t);
+    t.low = p10.high;
+    hi = add(hi, t);
+    t.low = mid.high;
+    hi = add(hi, t);
+
+    // keep the leading bit at FRAC_BITS + GUARD_BITS of sig, everything below it is sticky
+    int exponent = a_exp + b_exp - EXP_BIAS;
+    int top = hi.high >> (225 - 128 - 64) ? 225 : 224;
+    if (top == 225)
+        exponent += 1;
+    unsigned shift = top - (FRAC_BITS + GUARD_BITS);
+    u128 sig = add(shl(hi, 128 - shift), lshr(lo, shift));
+    sig.low |= !is_zero(shl(lo, 128 - shift));
+    return round_pack(sign, exponent, sig);
+}
+
+tf_float __divtf3(tf_float x, tf_float y) {
+    u128 a = to_bits(x), b = to_bits(y);
+    u128 a_abs = abs_bits(a), b_abs = abs_bits(b);
+    uint64_t sign = (a.high ^ b.high) & SIGN_BIT;
+
+    if (is_nan(a_abs)) {
+        a.high |= QUIET_HIGH;
+        return from_bits(a);
+    }
+    if (is_nan(b_abs)) {
+        b.high |= QUIET_HIGH;
+        return from_bits(b);
+    }
+    if (is_inf(a_abs))
+        return from_bits(is_inf(b_abs) ? quiet_nan() : make_quad(sign, EXP_MAX, 0, 0));
+    if (is_inf(b_abs))
+        return from_bits(make_quad(sign, 0, 0, 0));
+    if (is_zero(a_abs))
+        return from_bits(is_zero(b_abs) ? quiet_nan() : make_quad(sign, 0, 0, 0));
+    if (is_zero(b_abs))
+        return from_bits(make_quad(sign, EXP_MAX, 0, 0));
+
+    int a_exp, b_exp;
+    u128 rem = significand_of(a_abs, &a_exp);
+    u128 b_sig = significand_of(b_abs, &b_exp);
+    int exponent = a_exp - b_exp + EXP_BIAS;
+    if (less(rem, b_sig)) {
+        rem = shl(rem, 1);
+        exponent -= 1;
+    }
+
+    // one quotient bit per step, the first is always 1, the remainder becomes the sticky bit
+    u128 q = {0, 0};
+    for (int i = 0; i <= FRAC_BITS + GUARD_BITS; i++) {
+        q = shl(q, 1);
+        if (!less(rem, b_sig)) {
+            rem = sub(rem, b_sig);
+            q.low |= 1;
+        }
+        rem = shl(rem, 1);
+    }
+    q.low |= !is_zero(rem);
+    return round_pack(sign, exponent, q);
+}
+
+// -1, 0 or 1 as a is less than, equal to or greater than b, unordered if either is NaN
+static int compare(tf_float x, tf_float y, int unordered) {
+    u128 a = to_bits(x), b = to_bits(y);
+    u128 a_abs = abs_bits(a), b_abs = abs_bits(b);
+    if (is_nan(a_abs) || is_nan(b_abs))
+        return unordered;
+    if (is_zero(a_abs) && is_zero(b_abs))
+        return 0;
+
+    // ordered as sign and magnitude, both negative reverses the order of their magnitudes
+    int a_neg = (a.high & SIGN_BIT) != 0, b_neg = (b.high & SIGN_BIT) != 0;
+    if (a_neg != b_neg)
+        return a_neg ? -1 : 1;
+    if (a_abs.high == b_abs.high && a_abs.low == b_abs.low)
+        return 0;
+    return less(a_abs, b_abs) != a_neg ? -1 : 1;
+}
+
+int __letf2(tf_float a, tf_float b) {
+    return compare(a, b, 1);
+}
+
+int __getf2(tf_float a, tf_float b) {
+    return compare(a, b, -1);
+}
+
+int __unordtf2(tf_float a, tf_float b) {
+    return is_nan(abs_bits(to_bits(a))) || is_nan(abs_bits(to_bits(b)));
+}
+
+int __eqtf2(tf_float a, tf_float b) {
+    return __letf2(a, b);
+}
+
+int __lttf2(tf_float a, tf_float b) {
+    return __letf2(a, b);
+}
+
+int __netf2(tf_float a, tf_float b) {
+    return __letf2(a, b);
+}
+
+int __cmptf2(tf_float a, tf_float b) {
+    return __letf2(a, b);
+}
+
+int __gttf2(tf_float a, tf_float b) {
+    return __getf2(a, b);
+}
+
+tf_float __floatsitf(int a) {
+    u128 m = {a < 0 ? -(uint64_t) a : (uint64_t) a, 0};
+    return from_integer(a < 0 ? SIGN_BIT : 0, m);
+}
+
+tf_float __floatunsitf(unsigned a) {
+    u128 m = {a, 0};
+    return from_integer(0, m);
+}
+
+tf_float __floatditf(int64_t a) {
+    u128 m = {a < 0 ? -(uint64_t) a : (uint64_t) a, 0};
+    return from_integer(a < 0 ? SIGN_BIT : 0, m);
+}
+
+tf_float __floatunditf(uint64_t a) {
+    u128 m = {a, 0};
+    return from_integer(0, m);
+}
+
+tf_float __floattitf(ti_int a) {
+    u128 m = make_u128((tu_int) a);
+    uint64_t sign = is_negative(m) ? SIGN_BIT : 0;
+    return from_integer(sign, sign ? neg(m) : m);
+}
+
+tf_float __floatuntitf(tu_int a) {
+    return from_integer(0, make_u128(a));
+}
+
+// wasm converts i32 to f64 natively, the import list named it
+double __floatsidf(int a) {
+    return (double) a;
+}
+
+tf_float __extenddftf2(double a) {
+    double_bits bits;
+    bits.f = a;
+    uint64_t sign = bits.u & SIGN_BIT;
+    int exponent = (int) ((bits.u >> 52) & 0x7ff);
+    u128 frac = {bits.u & ((1ULL << 52) - 1), 0};
+
+    if (exponent == 0x7ff) {
+        // infinity or NaN, the payload keeps its top bits and the quiet bit stays the quiet bit
+        frac = shl(frac, FRAC_BITS - 52);
+        return from_bits(make_quad(sign, EXP_MAX, frac.high, frac.low));
+    }
+    if (exponent == 0) {
+        if (is_zero(frac))
+            return from_bits(make_quad(sign, 0, 0, 0));
+        // subnormal doubles are normal long doubles
+        unsigned shift = clz(frac) - (127 - 52);
+        frac = shl(frac, shift);
+        exponent = 1 - (int) shift;
+        frac.low &= (1ULL << 52) - 1;
+    }
+    frac = shl(frac, FRAC_BITS - 52);
+    return from_bits(make_quad(sign, exponent - 1023 + EXP_BIAS, frac.high, frac.low));
+}
+
+tf_float __extendsftf2(float a) {
+    // float to double is exact, NaN payloads included
+    return __extenddftf2((double) a);
+}
+
+// the bits of a rounded to a narrower format with frac_bits of fraction and exp_bits of exponent
+static uint64_t truncate_quad(tf_float x, int frac_bits, int exp_bits) {
+    u128 a = to_bits(x);
+    u128 a_abs = abs_bits(a);
+    int bias = (1 << (exp_bits - 1)) - 1;
+    int exp_max = (1 << exp_bits) - 1;
+    uint64_t sign_bit = (a.high & SIGN_BIT) ? 1ULL << (frac_bits + exp_bits) : 0;
+    uint64_t frac_mask = (1ULL << frac_bits) - 1;
+    int drop = FRAC_BITS - frac_bits;
+
+    if (is_nan(a_abs))
+        return sign_bit | ((uint64_t) exp_max << frac_bits) | (1ULL << (frac_bits - 1)) |
+               (lshr(frac_of(a_abs), drop).low & frac_mask);
+    if (is_inf(a_abs))
+        return sign_bit | ((uint64_t) exp_max << frac_bits);
+    if (is_zero(a_abs))
+        return sign_bit;
+
+    int exponent;
+    u128 sig = significand_of(a_abs, &exponent);
+    exponent = exponent - EXP_BIAS + bias;
+    if (exponent >= exp_max)
+        return sign_bit | ((uint64_t) exp_max << frac_bits);
+
+    // same rounding as round_pack, subnormal results shift further
+    unsigned shift = drop - GUARD_BITS;
+    if (exponent <= 0) {
+        shift += 1 - exponent;
+        exponent = 0;
+    }
+    uint64_t m = lshr_sticky(sig, shift).low;
+    unsigned round = m & 7;
+    m >>= GUARD_BITS;
+    uint64_t r = ((uint64_t) exponent << frac_bits) + (m & frac_mask);
+    if (exponent == 0)
+        r = m;
+    if (round > 4 || (round == 4 && (r & 1)))
+        r += 1;
+    return sign_bit | r;
+}
+
+double __trunctfdf2(tf_float a) {
+    double_bits bits;
+    bits.u = truncate_quad(a, 52, 11);
+    return bits.f;
+}
+
+float __trunctfsf2(tf_float a) {
+    float_bits bits;
+    bits.u = (uint32_t) truncate_quad(a, 23, 8);
+    return bits.f;
+}
+
+// truncates toward zero into a magnitude, returns 0 when it doesn't fit max_bits
+static int quad_to_u128(tf_float x, unsigned max_bits, u128 *magnitude, int *negative) {
+    u128 a = to_bits(x);
+    u128 a_abs = abs_bits(a);
+    u128 zero = {0, 0};
+    *negative = (a.high & SIGN_BIT) != 0;
+    *magnitude = zero;
+    if (is_nan(a_abs) || is_inf(a_abs))
+        return 0;
+    if (exponent_of(a_abs) < EXP_BIAS)
+        return 1;
+
+    int exponent;
+    u128 sig = significand_of(a_abs, &exponent);
+    unsigned top = exponent - EXP_BIAS;
+    if (top >= max_bits)
+        return 0;
+    *magnitude = top > FRAC_BITS ? shl(sig, top - FRAC_BITS) : lshr(sig, FRAC_BITS - top);
+    return 1;
+}
+
+// truncates toward zero, out of range values and NaN saturate
+static u128 fix_signed(tf_float a, unsigned bits) {
+    u128 m, limit = {0, 0}, one = {1, 0};
+    int negative;
+    int fits = quad_to_u128(a, bits, &m, &negative);
+    // 2^(bits - 1), the magnitude of the minimum
+    if (bits > 64)
+        limit.high = 1ULL << (bits - 65);
+    else
+        limit.low = 1ULL << (bits - 1);
+    if (negative) {
+        if (!fits || less(limit, m))
+            m = limit;
+        return neg(m);
+    }
+    if (!fits || !less(m, limit))
+        m = sub(limit, one);
+    return m;
+}
+
+static u128 fix_unsigned(tf_float a, unsigned bits) {
+    u128 m;
+    int negative;
+    int fits = quad_to_u128(a, bits, &m, &negative);
+    if (negative) {
+        u128 zero = {0, 0};
+        return zero;
+    }
+    if (!fits) {
+        u128 max = {~0ULL, bits > 64 ? ~0ULL : 0};
+        if (bits < 64)
+            max.low = (1ULL << bits) - 1;
+        return max;
+    }
+    return m;
+}
+
+ti_int __fixtfti(tf_float a) {
+    return (ti_int) from_u128(fix_signed(a, 128));
+}
+
+int64_t __fixtfdi(tf_float a) {
+    return (int64_t) fix_signed(a, 64).low;
+}
+
+int __fixtfsi(tf_float a) {
+    return (int) (int64_t) fix_signed(a, 32).low;
+}
+
+tu_int __fixunstfti(tf_float a) {
+    return from_u128(fix_unsigned(a, 128));
+}
+
+uint64_t __fixunstfdi(tf_float a) {
+    return fix_unsigned(a, 64).low;
+}
+
+unsigned __fixunstfsi(tf_float a) {
+    return (unsigned) fix_unsigned(a, 32).low;
+}
@@ -0,0 +1,143 @@
+/**
+ *  Unsigned 128-bit arithmetic on 64-bit halves for the builtins of this library. Nothing here
+ *  lowers to a call to another builtin.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef __int128 ti_int;
+typedef unsigned __int128 tu_int;
+
+typedef union {
+    tu_int all;
+    struct {
+        uint64_t low;
+        uint64_t high;
+    } s;
+} utwords;
+
+typedef union {
+    double f;
+    uint64_t u;
+} double_bits;
+
+typedef struct {
+    uint64_t low;
+    uint64_t high;
+} u128;
+
+static inline u128 make_u128(tu_int a) {
+    utwords w;
+    w.all = a;
+    u128 r = {w.s.low, w.s.high};
+    return r;
+}
+
+static inline tu_int from_u128(u128 a) {
+    utwords w;
+    w.s.low = a.low;
+    w.s.high = a.high;
+    return w.all;
+}
+
+static inline u128 shl(u128 a, unsigned b) {
+    u128 r;
+    if (b == 0) {
+        r = a;
+    } else if (b < 64) {
+        r.high = (a.high << b) | (a.low >> (64 - b));
+        r.low = a.low << b;
+    } else {
+        r.high = a.low << (b - 64);
+        r.low = 0;
+    }
+    return r;
+}
+
+static inline u128 lshr(u128 a, unsigned b) {
+    u128 r;
+    if (b == 0) {
+        r = a;
+    } else if (b < 64) {
+        r.low = (a.low >> b) | (a.high << (64 - b));
+        r.high = a.high >> b;
+    } else {
+        r.low = a.high >> (b - 64);
+        r.high = 0;
+    }
+    return r;
+}
+
+static inline u128 neg(u128 a) {
+    u128 r;
+    r.low = ~a.low + 1;
+    r.high = ~a.high + (r.low == 0);
+    return r;
+}
+
+static inline u128 sub(u128 a, u128 b) {
+    u128 r;
+    r.low = a.low - b.low;
+    r.high = a.high - b.high - (a.low < b.low);
+    return r;
+}
+
+static inline int less(u128 a, u128 b) {
+    return a.high < b.high || (a.high == b.high && a.low < b.low);
+}
+
+static inline unsigned clz(u128 a) {
+    if (a.high)
+        return __builtin_clzll(a.high);
+    if (a.low)
+        return 64 + __builtin_clzll(a.low);
+    return 128;
+}
+
+static inline int is_negative(u128 a) {
+    return (int64_t) a.high < 0;
+}
+
+static inline u128 add(u128 a, u128 b) {
+    u128 r;
+    r.low = a.low + b.low;
+    r.high = a.high + b.high + (r.low < a.low);
+    return r;
+}
+
+static inline int is_zero(u128 a) {
+    return (a.low | a.high) == 0;
+}
+
+// shifts right by any amount, ORing every bit shifted out into bit 0
+static inline u128 lshr_sticky(u128 a, unsigned b) {
+    u128 r = {0, 0};
+    if (b == 0)
+        return a;
+    if (b >= 128) {
+        r.low = !is_zero(a);
+        return r;
+    }
+    r = lshr(a, b);
+    r.low |= !is_zero(shl(a, 128 - b));
+    return r;
+}
+
+// 64x64 -> 128 on 32-bit digits
+static inline u128 mul_64x64(uint64_t a, uint64_t b) {
+    const uint64_t lower_mask = 0xffffffffULL;
+    uint64_t a0 = a & lower_mask, a1 = a >> 32;
+    uint64_t b0 = b & lower_mask, b1 = b >> 32;
+    uint64_t p00 = a0 * b0;
+    uint64_t p01 = a0 * b1;
+    uint64_t p10 = a1 * b0;
+    uint64_t p11 = a1 * b1;
+    uint64_t mid = (p00 >> 32) + (p01 & lower_mask) + (p10 & lower_mask);
+
+    u128 r;
+    r.low = (p00 & lower_mask) | (mid << 32);
+    r.high = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+    return r;
+}
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <cstdlib>
+#include <vector>
 
 #include "base.hpp"
 #include "datastream.hpp"
 #include "address.hpp"
 #include "name.hpp"
+#include "runtime.hpp"
 
 namespace ftl {
     /**
@@ -56,56 +58,110 @@ namespace ftl {
         return internal_use_do_not_use::get_amount();
     }
 
+#ifdef FTL_CALL_RESULT
+    /**
+     * Several inter-contract calls made in a single host call, for contracts that fan out to many others
+     *
+     * Calls are added with the BATCH_CALL macros and made in order by send(), which then unpacks all results.
+     * The args are packed as they are added, the results must outlive send().
+     *
+     * Only defined with FTL_CALL_RESULT (fractal-cpp --call-result), which also makes CALL get the result back
+     * with the call. Both need a host providing the call_action_result and multi_call imports.
+     *
+     * @code
+     * ftl::multi_call batch;
+     * uint64_t a, b;
+     * BATCH_CALL(batch, &a, pool_a, "balance", pool::balance, 0, owner);
+     * BATCH_CALL(batch, &b, pool_b, "balance", pool::balance, 0, owner);
+     * ftl::check(batch.send() == 0, "balance failed");
+     * @endcode
+     */
+    class multi_call {
+    public:
+        void add(address contract, name act, uint64_t amount, int storage_delegate, int user_delegate,
+                 const void *args, runtime::pack_fn pack, void *result, runtime::unpack_fn unpack) {
+            runtime::pack_call(_calls, contract.addr, ADDR_LEN, act.value, amount, storage_delegate, user_delegate,
+                               args, pack);
+            _slots.push_back({result, unpack, 0});
+        }
+
+        /**
+         * Makes the calls added so far and unpacks their results
+         *
+         * @return 0 when every call returned 0, else the status of the first one that didn't
+         */
+        int send() {
+            return runtime::multi_call(_calls, _slots.data(), _slots.size());
+        }
+
+        /**
+         * The status the i-th call returned in the last send()
+         */
+        int status(size_t i) const { return _slots[i].status; }
+
+        size_t size() const { return _slots.size(); }
+
+        void clear() {
+            _calls.clear();
+            _slots.clear();
+        }
+
+    private:
+        std::vector<char> _calls;
+        std::vector<runtime::call_slot> _slots;
+    };
+#endif
+
     template<typename>
     struct action;
 
+    // the args are packed where they are, through a tuple of references
     template<typename T, typename ...Args>
     struct action<T (*)(Args...)> {
-        static int call(T *result, address contract, name act, uint64_t amount, int storage_delegate, int user_delegate, Args... args) {
-            std::tuple<Args...> t = std::tuple<Args...>(args...);
-            size_t size = pack_size(act) + pack_size(t);
-            void *buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
-            ftl::datastream<char *> ds((char *) buffer, size);
-            ds << act;
-            ds << t;
-
-            int ret = internal_use_do_not_use::call_action(contract.addr, ADDR_LEN, buffer, size, amount, storage_delegate, user_delegate);
-            size_t result_size = internal_use_do_not_use::call_result(NULL, 0);
-            if (result_size > 0) {
-                void *result_buffer = max_stack_buffer_size < result_size ? malloc(result_size) : alloca(result_size);
-                internal_use_do_not_use::call_result(result_buffer, result_size);
-                ftl::datastream<char *> result_ds((char *) result_buffer, result_size);
-                result_ds >> *result;
-
-                if (max_stack_buffer_size < result_size) {
-                    free(result_buffer);
-                }
-            }
-
-            if(max_stack_buffer_size < size) {
-                free(buffer);
-            }
-            return ret;
+        typedef std::tuple<const std::decay_t<Args> &...> args_type;
+
+        static int call(T *result, address contract, name act, uint64_t amount, int storage_delegate, int user_delegate,
+                        const std::decay_t<Args> &... args) {
+            args_type t(args...);
+#ifdef FTL_CALL_RESULT
+            return runtime::call_action_result(contract.addr, ADDR_LEN, act.value, amount, storage_delegate,
+                                               user_delegate, &t, runtime::pack_thunk<args_type>, result,
+                                               runtime::unpack_thunk<T>);
+#else
+            return runtime::call_action(contract.addr, ADDR_LEN, act.value, amount, storage_delegate, user_delegate,
+                                        &t, runtime::pack_thunk<args_type>, result, runtime::unpack_thunk<T>);
+#endif
         }
+
+#ifdef FTL_CALL_RESULT
+        static void add(multi_call &batch, T *result, address contract, name act, uint64_t amount, int storage_delegate,
+                        int user_delegate, const std::decay_t<Args> &... args) {
+            args_type t(args...);
+            batch.add(contract, act, amount, storage_delegate, user_delegate, &t, runtime::pack_thunk<args_type>,
+                      result, runtime::unpack_thunk<T>);
+        }
+#endif
     };
 
     template<typename ...Args>
     struct action<void (*)(Args...)> {
-        static int call(void *result, address contract, name act, uint64_t amount, int storage_delegate, int user_delegate, Args... args) {
-            std::tuple<Args...> t = std::tuple<Args...>(args...);
-            size_t size = pack_size(act) + pack_size(t);
-            void *buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
-            ftl::datastream<char *> ds((char *) buffer, size);
-            ds << act;
-            ds << t;
-
-            int ret = internal_use_do_not_use::call_action(contract.addr, ADDR_LEN, buffer, size, amount, storage_delegate, user_delegate);
-
-            if(max_stack_buffer_size < size) {
-                free(buffer);
-            }
-            return ret;
+        typedef std::tuple<const std::decay_t<Args> &...> args_type;
+
+        static int call(void *result, address contract, name act, uint64_t amount, int storage_delegate, int user_delegate,
+                        const std::decay_t<Args> &... args) {
+            args_type t(args...);
+            return runtime::call_action(contract.addr, ADDR_LEN, act.value, amount, storage_delegate, user_delegate,
+                                        &t, runtime::pack_thunk<args_type>, nullptr, nullptr);
+        }
+
+#ifdef FTL_CALL_RESULT
+        static void add(multi_call &batch, void *result, address contract, name act, uint64_t amount, int storage_delegate,
+                        int user_delegate, const std::decay_t<Args> &... args) {
+            args_type t(args...);
+            batch.add(contract, act, amount, storage_delegate, user_delegate, &t, runtime::pack_thunk<args_type>,
+                      nullptr, nullptr);
         }
+#endif
     };
 
     #define CALL(presult, contract, act, func, amount, ...) ftl::action<decltype(&func)>::call(presult, contract, ftl::name(act), amount, 0, 0, __VA_ARGS__)
@@ -114,4 +170,12 @@ namespace ftl {
     #define CALL_NOARGS(presult, contract, act, func, amount) ftl::action<decltype(&func)>::call(presult, contract, ftl::name(act), amount, 0, 0)
     #define DELEGATE_CALL_NOARGS(presult, contract, act, func, amount) ftl::action<decltype(&func)>::call(presult, contract, ftl::name(act), amount, 1, 0)
     #define CONTRACT_CALL_NOARGS(presult, contract, act, func, amount) ftl::action<decltype(&func)>::call(presult, contract, ftl::name(act), amount, 0, 1)
+#ifdef FTL_CALL_RESULT
+    #define BATCH_CALL(batch, presult, contract, act, func, amount, ...) ftl::action<decltype(&func)>::add(batch, presult, contract, ftl::name(act), amount, 0, 0, __VA_ARGS__)
+    #define BATCH_DELEGATE_CALL(batch, presult, contract, act, func, amount, ...) ftl::action<decltype(&func)>::add(batch, presult, contract, ftl::name(act), amount, 1, 0, __VA_ARGS__)
+    #define BATCH_CONTRACT_CALL(batch, presult, contract, act, func, amount, ...) ftl::action<decltype(&func)>::add(batch, presult, contract, ftl::name(act), amount, 0, 1, __VA_ARGS__)
+    #define BATCH_CALL_NOARGS(batch, presult, contract, act, func, amount) ftl::action<decltype(&func)>::add(batch, presult, contract, ftl::name(act), amount, 0, 0)
+    #define BATCH_DELEGATE_CALL_NOARGS(batch, presult, contract, act, func, amount) ftl::action<decltype(&func)>::add(batch, presult, contract, ftl::name(act), amount, 1, 0)
+    #define BATCH_CONTRACT_CALL_NOARGS(batch, presult, contract, act, func, amount) ftl::action<decltype(&func)>::add(batch, presult, contract, ftl::name(act), amount, 0, 1)
+#endif
 }
@@ -31,23 +31,28 @@ namespace ftl {
     }
 
     namespace internal_use_do_not_use {
+        /**
+         * Imports whose result is fixed for the whole action are marked pure (or argmemonly when they
+         * write to a buffer) so the optimizer can merge and hoist them. Anything reading state another
+         * import can change, such as the db and call functions, must stay unmarked.
+         */
         extern "C" {
         __attribute__((ftl_wasm_import))
         void assert_sha256(const char *data, uint32_t length, const checksum256 *hash);
 
-        __attribute__((ftl_wasm_import))
+        __attribute__((ftl_wasm_import(argmemonly)))
         void sha256(const char *data, uint32_t length, checksum256 *hash);
 
-        __attribute__((ftl_wasm_import))
+        __attribute__((ftl_wasm_import(argmemonly)))
         uint32_t read_action_data(void *msg, uint32_t len);
 
-        __attribute__((ftl_wasm_import))
+        __attribute__((ftl_wasm_import(pure)))
         uint32_t action_data_size();
 
         __attribute__((ftl_wasm_import))
         void transfer(void *addr, size_t addr_size, uint64_t amount);
 
-        __attribute__((ftl_wasm_import))
+        __attribute__((ftl_wasm_import(pure)))
         uint64_t get_amount();
 
         __attribute__((ftl_wasm_import))
@@ -57,13 +62,27 @@ namespace ftl {
         __attribute__((ftl_wasm_import))
         size_t call_result(void *result, size_t result_size);
 
+        // call_action that copies up to result_capacity bytes of the result to result and its full size to
+        // result_size, call_result still returns all of it. Not every host provides this and multi_call,
+        // contracts only import them when built with FTL_CALL_RESULT
         __attribute__((ftl_wasm_import))
-        void get_from(void *buffer, size_t buffer_size);
+        int call_action_result(void *addr, size_t addr_size, void *action, size_t action_size,
+                               uint64_t amount, int storage_delegate, int user_delegate,
+                               void *result, size_t result_capacity, size_t *result_size);
 
+        // count calls packed by runtime::pack_call in one host call, the results are packed as status (i32)
+        // and length prefixed result per call and returned like those of call_action_result
         __attribute__((ftl_wasm_import))
+        int multi_call(uint32_t count, const void *calls, size_t calls_size,
+                       void *results, size_t results_capacity, size_t *results_size);
+
+        __attribute__((ftl_wasm_import(argmemonly)))
+        void get_from(void *buffer, size_t buffer_size);
+
+        __attribute__((ftl_wasm_import(argmemonly)))
         void get_to(void *buffer, size_t buffer_size);
 
-        __attribute__((ftl_wasm_import))
+        __attribute__((ftl_wasm_import(argmemonly)))
         void get_owner(void *buffer, size_t buffer_size);
 
         __attribute__((ftl_wasm_import))
@@ -145,13 +164,13 @@ namespace ftl {
         __attribute__((ftl_wasm_import, noreturn))
         void ftl_exit(int32_t code);
 
-        __attribute__((ftl_wasm_import))
+        __attribute__((ftl_wasm_import(pure)))
         uint64_t current_time();
 
-        __attribute__((ftl_wasm_import))
+        __attribute__((ftl_wasm_import(pure)))
         uint64_t current_height();
 
-        __attribute__((ftl_wasm_import))
+        __attribute__((ftl_wasm_import(argmemonly)))
         void current_hash(checksum256 *simple_hash, checksum256 *full_hash);
         }
     };
@@ -0,0 +1,204 @@
+#pragma once
+
+#include "base.hpp"
+#include "datastream.hpp"
+
+namespace ftl {
+    /**
+     * @defgroup blob Chunked Values
+     * @ingroup core
+     * @brief Values stored across several keys and read and written as a stream, see ftl::blob_table
+     *
+     * The value under key in table is a header, its packed uint64 size and uint32 chunk size. Its bytes are
+     * split into chunks of blob_chunk_size stored in table | 1 (the last 4 bits of a table name are free, see
+     * ftl::table) under key followed by the big-endian uint32 index of the chunk.
+     *
+     * The streams buffer one chunk, so their memory does not depend on the size of the value, and a write
+     * only stores the chunks it changed.
+     */
+
+    /**
+     * Bytes per chunk of a blob, the last chunk of a value can be shorter
+     */
+    constexpr static uint32_t blob_chunk_size = 1024;
+
+    /**
+     * Longest key of a blob, the chunk index follows it in the keys of the chunks
+     */
+    constexpr static size_t blob_max_key_size = 28;
+
+    /**
+     * Tag type for a datastream reading a blob
+     */
+    struct blob_source {};
+
+    /**
+     * Tag type for a datastream writing a blob
+     */
+    struct blob_sink {};
+
+    /// @cond INTERNAL
+    namespace _blob_detail {
+        /**
+         * The table and key of a blob, the position of a stream in it and the chunk it holds
+         */
+        struct chunk_buffer {
+            chunk_buffer(uint64_t table, const void *key, size_t key_size);
+
+            chunk_buffer(const chunk_buffer &) = delete;
+
+            chunk_buffer &operator=(const chunk_buffer &) = delete;
+
+            /**
+             * Loads the header, returns false when there is no value under the key
+             */
+            bool load_header();
+
+            void store_header();
+
+            /**
+             * Loads chunk i into out, returns its length
+             */
+            uint32_t read(uint32_t i, char *out);
+
+            /**
+             * Loads chunk i into buffer, or makes it empty when it starts past the end
+             */
+            void load(uint32_t i);
+
+            void store();
+
+            void remove(uint32_t i);
+
+            uint64_t table;
+            // the chunk index goes after the key
+            uint8_t key[blob_max_key_size + sizeof(uint32_t)];
+            size_t key_size;
+            uint64_t size = 0;
+            uint64_t pos = 0;
+            // -1 when no chunk is in buffer
+            uint32_t index = uint32_t(-1);
+            uint32_t length = 0;
+            char buffer[blob_chunk_size];
+        };
+    }
+    /// @endcond
+
+/**
+ * Specialization of datastream that reads a blob chunk by chunk, fails the action when there is no value under
+ * the key
+ *
+ * @ingroup blob
+ */
+    template<>
+    class datastream<blob_source> {
+    public:
+        datastream(uint64_t table, const void *key, size_t key_size, uint64_t offset = 0);
+
+        /**
+         *  Reads s bytes of the blob, a whole chunk is loaded straight into d
+         *
+         *  @param d - The pointer to the destination buffer
+         *  @param s - the number of bytes to read
+         *  @return true
+         */
+        bool read(char *d, size_t s);
+
+        inline bool get(unsigned char &c) { return get(*(char *) &c); }
+
+        inline bool get(char &c) { return read(&c, 1); }
+
+        inline void skip(size_t s) {
+            ftl::check(s <= remaining(), "skip");
+            _chunks.pos += s;
+        }
+
+        inline bool valid() const { return _chunks.pos <= _chunks.size; }
+
+        inline bool seekp(size_t p) {
+            _chunks.pos = p;
+            return valid();
+        }
+
+        inline size_t tellp() const { return size_t(_chunks.pos); }
+
+        inline size_t remaining() const { return size_t(_chunks.size - _chunks.pos); }
+
+        /**
+         * Size of the blob
+         */
+        inline uint64_t size() const { return _chunks.size; }
+
+    private:
+        _blob_detail::chunk_buffer _chunks;
+    };
+
+/**
+ * Specialization of datastream that writes a blob, starting at offset of the value under the key or of a new
+ * empty one. The changed chunks and the header are stored by flush or when the stream is destroyed.
+ *
+ * @ingroup blob
+ */
+    template<>
+    class datastream<blob_sink> {
+    public:
+        datastream(uint64_t table, const void *key, size_t key_size, uint64_t offset = 0);
+
+        ~datastream() { flush(); }
+
+        /**
+         *  Writes s bytes to the blob, a chunk only partly overwritten is loaded first
+         *
+         *  @param d - The pointer to the source buffer
+         *  @param s - The number of bytes to write
+         *  @return true
+         */
+        bool write(const char *d, size_t s);
+
+        inline bool put(char c) { return write(&c, 1); }
+
+        inline bool valid() const { return _chunks.pos <= _chunks.size; }
+
+        inline bool seekp(size_t p) {
+            _chunks.pos = p;
+            return valid();
+        }
+
+        inline size_t tellp() const { return size_t(_chunks.pos); }
+
+        inline size_t remaining() const { return 0; }
+
+        /**
+         * Size of the blob
+         */
+        inline uint64_t size() const { return _chunks.size; }
+
+        /**
+         * Ends the blob at the current position
+         */
+        void truncate();
+
+        /**
+         * Stores the chunk being written, removes the chunks past the end, then stores the header if the size
+         * changed
+         */
+        void flush();
+
+    private:
+        void store_chunk();
+
+        _blob_detail::chunk_buffer _chunks;
+        bool _dirty = false;
+        // size in the stored header, -1 when there is none
+        uint64_t _stored_size;
+        // one past the last chunk stored, before the stream or by it
+        uint32_t _chunk_end;
+    };
+
+/**
+ * Removes the blob under key, its header and chunks
+ *
+ * @ingroup blob
+ */
+    void blob_remove(uint64_t table, const void *key, size_t key_size);
+}
@@ -2,9 +2,22 @@
 
 #include <alloca.h>
 #include <string>
+#include <utility>
 
 #include "base.hpp"
 
+/**
+ * With fractal-cpp --error-codes the constant messages reaching ftl_assert are replaced by codes, listed in
+ * the error_messages of the abi. Inlining the checks exposes the literal to that pass even at -O0, messages
+ * built at runtime (the std::string overloads) are still passed as strings. Passing a function that builds
+ * the message instead of the message defers building it to the failure path.
+ */
+#ifdef FTL_ERROR_CODES
+#define FTL_CHECK_INLINE inline __attribute__((always_inline))
+#else
+#define FTL_CHECK_INLINE inline
+#endif
+
 namespace ftl {
     /**
      *  Assert if the predicate fails and use the supplied message.
@@ -16,7 +29,7 @@ namespace ftl {
      *  ftl::check(a == b, "a does not equal b");
      *  @endcode
      */
-    inline void check(bool pred, const char *msg) {
+    FTL_CHECK_INLINE void check(bool pred, const char *msg) {
         if (!pred) {
             internal_use_do_not_use::ftl_assert(false, msg);
         }
@@ -54,6 +67,25 @@ namespace ftl {
         }
     }
 
+    /**
+     *  Assert if the predicate fails and use the message returned by the supplied function, which only
+     *  runs when the predicate fails.
+     *
+     *  @ingroup system
+     *
+     *  Example:
+     *  @code
+     *  ftl::check(a == b, [&] { return "a is " + std::to_string(a); });
+     *  @endcode
+     */
+    template<typename F, typename = decltype(std::string(std::declval<F &>()()))>
+    inline void check(bool pred, F &&make_msg) {
+        if (!pred) {
+            std::string msg = make_msg();
+            internal_use_do_not_use::ftl_assert(false, msg.c_str());
+        }
+    }
+
     /**
      *  Assert if the predicate fails and use a subset of the supplied message.
      *
@@ -65,7 +97,7 @@ namespace ftl {
      *  ftl::check(a == b, "a does not equal b", 18);
      *  @endcode
      */
-    inline void check(bool pred, const char *msg, size_t n) {
+    FTL_CHECK_INLINE void check(bool pred, const char *msg, size_t n) {
         if (!pred) {
             internal_use_do_not_use::ftl_assert_message(false, msg, n);
         }
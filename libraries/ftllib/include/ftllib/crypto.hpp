@@ -24,6 +24,241 @@ namespace ftl {
     inline void sha256(const char *data, uint32_t length, checksum256 *hash) {
         internal_use_do_not_use::sha256(data, length, hash);
     }
+
+    /// @cond INTERNAL
+    namespace _sha256_detail {
+        inline uint32_t rotr(uint32_t x, int n) {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        /**
+         * Runs the SHA-256 compression function over one 64 byte block
+         */
+        inline void compress(uint32_t *state, const uint8_t *block) {
+            static const uint32_t k[64] = {
+                    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+            uint32_t w[64];
+            for (int i = 0; i < 16; i++)
+                w[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16) |
+                       (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+            for (int i = 16; i < 64; i++) {
+                uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; i++) {
+                uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+                uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    }
+    /// @endcond
+
+    /**
+     * Incremental SHA-256, computed inside the contract.
+     *
+     * Unlike ftl::sha256 the input doesn't have to be in one contiguous buffer, it can be fed
+     * in pieces of any size. The digest is identical to the one returned by ftl::sha256.
+     *
+     * Example:
+     * @code
+     * ftl::sha256_hasher hasher;
+     * hasher.update(header, sizeof(header));
+     * hasher.update(body, body_size);
+     * checksum256 hash = hasher.final();
+     * @endcode
+     */
+    class sha256_hasher {
+    public:
+        sha256_hasher() {
+            reset();
+        }
+
+        /**
+         * Discard everything hashed so far
+         */
+        void reset() {
+            static const uint32_t initial_state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                                      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            memcpy(_state, initial_state, sizeof(_state));
+            _length = 0;
+        }
+
+        /**
+         * @brief Hash more data.
+         * @param data - The source data.
+         * @param length - The length of the data.
+         */
+        void update(const char *data, size_t length) {
+            size_t used = _length % 64;
+            _length += length;
+            if (used) {
+                size_t n = 64 - used < length ? 64 - used : length;
+                memcpy(_block + used, data, n);
+                data += n;
+                length -= n;
+                if (used + n < 64)
+                    return;
+                _sha256_detail::compress(_state, _block);
+            }
+            for (; length >= 64; data += 64, length -= 64)
+                _sha256_detail::compress(_state, (const uint8_t *) data);
+            memcpy(_block, data, length);
+        }
+
+        /**
+         * @brief Get the hash of everything passed to update().
+         * @return checksum256 - The hash result.
+         * @post The hasher is reset and can be reused.
+         */
+        checksum256 final() {
+            uint64_t bit_length = _length * 8;
+            size_t used = _length % 64;
+            _block[used++] = 0x80;
+            if (used > 56) {
+                memset(_block + used, 0, 64 - used);
+                _sha256_detail::compress(_state, _block);
+                used = 0;
+            }
+            memset(_block + used, 0, 56 - used);
+            for (int i = 0; i < 8; i++)
+                _block[63 - i] = uint8_t(bit_length >> (8 * i));
+            _sha256_detail::compress(_state, _block);
+
+            checksum256 hash;
+            for (int i = 0; i < 8; i++) {
+                hash.hash[4 * i] = uint8_t(_state[i] >> 24);
+                hash.hash[4 * i + 1] = uint8_t(_state[i] >> 16);
+                hash.hash[4 * i + 2] = uint8_t(_state[i] >> 8);
+                hash.hash[4 * i + 3] = uint8_t(_state[i]);
+            }
+            reset();
+            return hash;
+        }
+
+        /**
+         * Total number of bytes hashed since the last reset
+         */
+        uint64_t length() const { return _length; }
+
+    private:
+        uint32_t _state[8];
+        uint64_t _length;
+        uint8_t _block[64];
+    };
+
+    /**
+     * Tag type for a datastream that hashes everything written to it
+     */
+    struct hash_sink {};
+
+    /**
+     * Specialization of datastream that feeds the serialized bytes into a sha256_hasher instead
+     * of storing them, so an object can be hashed without packing it into a buffer first
+     *
+     * Example:
+     * @code
+     * ftl::datastream<ftl::hash_sink> ds;
+     * ds << key << value;
+     * checksum256 hash = ds.hash();
+     * @endcode
+     */
+    template<>
+    class datastream<hash_sink> {
+    public:
+        /**
+         *  Hash s bytes
+         *
+         *  @param d - Pointer to the source data
+         *  @param s - The amount of data to hash
+         *  @return true
+         */
+        inline bool write(const char *d, size_t s) {
+            _hasher.update(d, s);
+            return true;
+        }
+
+        /**
+         *  Hash one byte
+         *
+         *  @param c - The byte to hash
+         *  @return true
+         */
+        inline bool put(char c) {
+            _hasher.update(&c, 1);
+            return true;
+        }
+
+        /**
+         *  Check validity. It's always valid
+         *
+         *  @return true
+         */
+        inline bool valid() const { return true; }
+
+        /**
+         * Get the number of bytes hashed so far
+         *
+         * @return size_t - The number of bytes
+         */
+        inline size_t tellp() const { return _hasher.length(); }
+
+        /**
+         * Always returns 0
+         *
+         * @return size_t - 0
+         */
+        inline size_t remaining() const { return 0; }
+
+        /**
+         * Get the hash of everything written and start over
+         *
+         * @return checksum256 - The hash result
+         */
+        checksum256 hash() { return _hasher.final(); }
+
+    private:
+        sha256_hasher _hasher;
+    };
+
+    /**
+     * @brief Get the hash of the serialized form of a value, without an intermediate buffer.
+     * @param v - The value to hash.
+     * @return checksum256 - Same as packing v and calling ftl::sha256 on the result.
+     */
+    template<typename T>
+    checksum256 pack_hash(const T &v) {
+        datastream<hash_sink> ds;
+        ds << v;
+        return ds.hash();
+    }
 } // namespace ftl
 
 
@@ -884,6 +884,8 @@ namespace ftl {
  *  Serialize a class
  *
  *  @brief Serialize a class
+ *  @note fractal-cpp generates more specialized operators for the structs used by actions and tables,
+ *  this reflection based version is the fallback for every other class type
  *  @param ds - The stream to write
  *  @param v - The value to serialize
  *  @tparam DataStream - Type of datastream
@@ -1014,4 +1016,228 @@ namespace ftl {
         ds << value;
         return result;
     }
+
+    struct address;
+    struct name;
+    struct checksum256;
+    struct uint256;
+    struct int256;
+    template<typename Int, uint8_t Scale>
+    struct fixed;
+
+/**
+ * Number of bytes every value of T packs to, 0 when it depends on the value
+ *
+ * @ingroup datastream
+ * @tparam T - Type of the packed data
+ */
+    template<typename T, typename = void>
+    struct fixed_pack_size : std::integral_constant<size_t, 0> {};
+
+    template<typename T>
+    struct fixed_pack_size<T, std::enable_if_t<_datastream_detail::is_primitive<T>()>>
+            : std::integral_constant<size_t, sizeof(T)> {};
+
+    template<>
+    struct fixed_pack_size<address> : std::integral_constant<size_t, 20> {};
+
+    template<>
+    struct fixed_pack_size<name> : std::integral_constant<size_t, 8> {};
+
+    template<>
+    struct fixed_pack_size<checksum256> : std::integral_constant<size_t, 32> {};
+
+    template<>
+    struct fixed_pack_size<uint256> : std::integral_constant<size_t, 32> {};
+
+    template<>
+    struct fixed_pack_size<int256> : std::integral_constant<size_t, 32> {};
+
+    template<typename Int, uint8_t Scale>
+    struct fixed_pack_size<fixed<Int, Scale>> : fixed_pack_size<Int> {};
+
+    template<typename T, std::size_t N>
+    struct fixed_pack_size<std::array<T, N>> : std::integral_constant<size_t, N * fixed_pack_size<T>::value> {};
+
+    template<typename T1, typename T2>
+    struct fixed_pack_size<std::pair<T1, T2>>
+            : std::integral_constant<size_t, fixed_pack_size<T1>::value && fixed_pack_size<T2>::value
+                                             ? fixed_pack_size<T1>::value + fixed_pack_size<T2>::value : 0> {};
+
+    template<typename T>
+    void skip(datastream<const char *> &ds);
+
+    namespace _datastream_detail {
+        inline void skip_bytes(datastream<const char *> &ds, uint64_t size) {
+            ftl::check(size <= ds.remaining(), "skip");
+            ds.skip(size);
+        }
+
+        // types without a skipper of their own are decoded into a temporary
+        template<typename T>
+        struct skipper {
+            static void skip(datastream<const char *> &ds) {
+                T tmp;
+                ds >> tmp;
+            }
+        };
+
+        template<>
+        struct skipper<std::string> {
+            static void skip(datastream<const char *> &ds) {
+                unsigned_int s;
+                ds >> s;
+                skip_bytes(ds, s.value);
+            }
+        };
+
+        template<typename T>
+        struct skipper<std::vector<T>> {
+            static void skip(datastream<const char *> &ds) {
+                unsigned_int s;
+                ds >> s;
+                if constexpr (fixed_pack_size<T>::value > 0) {
+                    skip_bytes(ds, uint64_t(s.value) * fixed_pack_size<T>::value);
+                } else {
+                    for (uint32_t i = 0; i < s.value; ++i)
+                        ftl::skip<T>(ds);
+                }
+            }
+        };
+
+        template<typename T>
+        struct skipper<std::set<T>> {
+            static void skip(datastream<const char *> &ds) {
+                unsigned_int s;
+                ds >> s;
+                for (uint32_t i = 0; i < s.value; ++i)
+                    ftl::skip<T>(ds);
+            }
+        };
+
+        template<typename K, typename V>
+        struct skipper<std::map<K, V>> {
+            static void skip(datastream<const char *> &ds) {
+                unsigned_int s;
+                ds >> s;
+                for (uint32_t i = 0; i < s.value; ++i) {
+                    ftl::skip<K>(ds);
+                    ftl::skip<V>(ds);
+                }
+            }
+        };
+
+        template<typename T1, typename T2>
+        struct skipper<std::pair<T1, T2>> {
+            static void skip(datastream<const char *> &ds) {
+                ftl::skip<T1>(ds);
+                ftl::skip<T2>(ds);
+            }
+        };
+
+        template<typename T, std::size_t N>
+        struct skipper<std::array<T, N>> {
+            static void skip(datastream<const char *> &ds) {
+                for (std::size_t i = 0; i < N; ++i)
+                    ftl::skip<T>(ds);
+            }
+        };
+
+        template<typename>
+        struct member_pointer;
+
+        template<typename C, typename F>
+        struct member_pointer<F C::*> {
+            typedef C class_type;
+            typedef F field_type;
+        };
+
+        namespace _custom_unpack {
+            // the class operator>> of ftl again, the two are ambiguous unless an operator>> for T is more
+            // specialized than both, only declared as it is never selected
+            template<typename DataStream, typename T, std::enable_if_t<std::is_class<T>::value> * = nullptr>
+            void operator>>(DataStream &ds, T &v);
+
+            // fractal-cpp declares one returning std::true_type next to the operators it generates, they read
+            // the fields in order like the class operator
+            std::false_type ftl_field_by_field(...);
+
+            template<typename T>
+            constexpr bool is_generated() {
+                return decltype(ftl_field_by_field(std::declval<const T *>()))::value;
+            }
+
+            template<typename T, typename = void>
+            struct has_operator : std::false_type {};
+
+            template<typename T>
+            struct has_operator<T, std::void_t<decltype(std::declval<datastream<const char *> &>() >>
+                                                         std::declval<T &>())>>
+                    : std::true_type {};
+        }
+
+        /**
+         * Whether T is unpacked by an operator>> of its own instead of field by field
+         */
+        template<typename T>
+        struct has_custom_unpack
+                : std::integral_constant<bool, _custom_unpack::has_operator<T>::value &&
+                                               !_custom_unpack::is_generated<T>()> {};
+    }
+
+/**
+ * Moves the stream past a packed T without decoding it when its format allows: fixed size types are skipped
+ * arithmetically, strings and vectors of fixed size types by their length. Other types are decoded into a
+ * temporary.
+ *
+ * @ingroup datastream
+ * @tparam T - Type of the packed data
+ * @param ds - The stream to read
+ */
+    template<typename T>
+    void skip(datastream<const char *> &ds) {
+        if constexpr (fixed_pack_size<T>::value > 0)
+            _datastream_detail::skip_bytes(ds, fixed_pack_size<T>::value);
+        else
+            _datastream_detail::skipper<T>::skip(ds);
+    }
+
+/**
+ * Unpacks a single member of a packed struct, skipping the fields before it and ignoring the ones after. A
+ * struct with an operator>> of its own is unpacked whole by it, its fields may not be packed in order.
+ *
+ * @ingroup datastream
+ * @tparam Member - Pointer to the member, e.g. &record::balance
+ * @param buffer - Pointer to the buffer holding the packed struct
+ * @param len - Length of the buffer
+ * @return The unpacked member
+ */
+    template<auto Member>
+    auto unpack_field(const char *buffer, size_t len) {
+        typedef typename _datastream_detail::member_pointer<decltype(Member)>::class_type T;
+        typedef typename _datastream_detail::member_pointer<decltype(Member)>::field_type F;
+        static_assert(std::is_aggregate<T>::value, "unpack_field needs an aggregate packed field by field");
+
+        datastream<const char *> ds(buffer, len);
+        if constexpr (_datastream_detail::has_custom_unpack<T>::value) {
+            T v;
+            ds >> v;
+            return F(std::move(v.*Member));
+        }
+        F result;
+        bool found = false;
+        // an empty T tells the member apart from the other fields of the same type
+        T layout;
+        boost::pfr::for_each_field(layout, [&](const auto &field) {
+            if (found)
+                return;
+            if ((const void *) &field == (const void *) &(layout.*Member)) {
+                ds >> result;
+                found = true;
+            } else {
+                skip<std::decay_t<decltype(field)>>(ds);
+            }
+        });
+        return result;
+    }
 } // namespace ftl
@@ -2,6 +2,7 @@
 
 #include "action.hpp"
 #include "name.hpp"
+#include "runtime.hpp"
 
 #include <boost/fusion/adapted/std_tuple.hpp>
 #include <boost/fusion/include/std_tuple.hpp>
@@ -19,6 +20,9 @@ namespace ftl {
     /**
      * Unpack the received action and execute the correponding action handler
      *
+     * Reading the action data and setting the result go through the shared runtime, only the
+     * unpacking of the arguments and the packing of the result are instantiated per signature.
+     *
      * @ingroup dispatcher
      * @tparam T - The contract class that has the correponding action handler, this contract should be derived from ftl::contract
      * @tparam RT - The type that the action handler returns
@@ -28,64 +32,28 @@ namespace ftl {
      */
     template<typename T, typename RT, typename... Args>
     bool execute_action(RT (T::*func)(Args...)) {
-        size_t size = action_data_size();
-
-        //using malloc/free here potentially is not exception-safe, although WASM doesn't support exceptions
-        constexpr size_t max_stack_buffer_size = 512;
-        void *buffer = nullptr;
-        if (size > 0) {
-            buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
-            read_action_data(buffer, size);
-        }
-
         std::tuple < std::decay_t < Args >...> args;
-        datastream<const char *> ds((char *) buffer, size);
-        ds >> args;
+        runtime::read_action(&args, runtime::unpack_thunk<decltype(args)>);
 
         T inst;
         auto f2 = [&](auto... a) {
             return ((&inst)->*func)(a...);
         };
         RT rt = std::apply(f2, args);
-        size_t result_size = pack_size(rt);
-        if (result_size > 0) {
-            void *result_buffer = max_stack_buffer_size < result_size ? malloc(result_size) : alloca(result_size);
-            ftl::datastream<char *> result_ds((char *) result_buffer, result_size);
-            result_ds << rt;
-            internal_use_do_not_use::set_result(result_buffer, result_size);
-        }
-
-        if (max_stack_buffer_size < size) {
-            free(buffer);
-        }
+        runtime::set_result(&rt, runtime::pack_thunk<RT>);
         return true;
     }
 
     template<typename T, typename... Args>
     bool execute_action(void (T::*func)(Args...)) {
-        size_t size = action_data_size();
-
-        //using malloc/free here potentially is not exception-safe, although WASM doesn't support exceptions
-        constexpr size_t max_stack_buffer_size = 512;
-        void *buffer = nullptr;
-        if (size > 0) {
-            buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
-            read_action_data(buffer, size);
-        }
-
         std::tuple < std::decay_t < Args >...> args;
-        datastream<const char *> ds((char *) buffer, size);
-        ds >> args;
+        runtime::read_action(&args, runtime::unpack_thunk<decltype(args)>);
 
         T inst;
         auto f2 = [&](auto... a) {
             ((&inst)->*func)(a...);
         };
         std::apply(f2, args);
-
-        if (max_stack_buffer_size < size) {
-            free(buffer);
-        }
         return true;
     }
 
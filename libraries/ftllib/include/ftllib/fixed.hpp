@@ -0,0 +1,249 @@
+#pragma once
+
+#include "uint256.hpp"
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace ftl {
+    /**
+     * @defgroup fixed Fixed-Point Decimal
+     * @ingroup core
+     * @ingroup types
+     * @brief Defines a fixed-point decimal type with a compile-time number of decimals
+     */
+
+    /// @cond INTERNAL
+    namespace _fixed_detail {
+        template<typename Int>
+        struct wider {};
+
+        template<> struct wider<int32_t> { using type = int64_t; };
+        template<> struct wider<uint32_t> { using type = uint64_t; };
+        template<> struct wider<int64_t> { using type = int128_t; };
+        template<> struct wider<uint64_t> { using type = uint128_t; };
+        template<> struct wider<int128_t> { using type = int256; };
+        template<> struct wider<uint128_t> { using type = uint256; };
+
+        template<typename Int, typename = void>
+        struct has_wider : std::false_type {};
+
+        template<typename Int>
+        struct has_wider<Int, std::void_t<typename wider<Int>::type>> : std::true_type {};
+
+        /**
+         * a * b / c without overflowing the intermediate product
+         */
+        template<typename Int>
+        Int mul_div(const Int &a, const Int &b, const Int &c) {
+            if constexpr (has_wider<Int>::value) {
+                using Wide = typename wider<Int>::type;
+                ftl::check(c != Int(0), "fixed division by zero");
+                return static_cast<Int>(Wide(a) * Wide(b) / Wide(c));
+            } else {
+                return muldiv(a, b, c);
+            }
+        }
+
+        template<typename Int>
+        bool is_negative(const Int &v) {
+            if constexpr (std::is_same<Int, int256>::value)
+                return v.is_negative();
+            else if constexpr (std::is_same<Int, uint256>::value || std::is_unsigned<Int>::value)
+                return false;
+            else
+                return v < 0;
+        }
+
+        template<typename Int>
+        std::string to_string(const Int &v) {
+            if constexpr (std::is_same<Int, uint256>::value || std::is_same<Int, int256>::value) {
+                return v.to_string();
+            } else {
+                // digits of the magnitude, taken unsigned so the minimum value doesn't overflow
+                using Unsigned = std::make_unsigned_t<Int>;
+                Unsigned u = is_negative(v) ? Unsigned(0) - Unsigned(v) : Unsigned(v);
+                char buffer[48];
+                int pos = sizeof(buffer);
+                do {
+                    buffer[--pos] = char('0' + uint32_t(u % 10));
+                    u /= 10;
+                } while (u);
+                if (is_negative(v))
+                    buffer[--pos] = '-';
+                return std::string(buffer + pos, sizeof(buffer) - pos);
+            }
+        }
+    }
+    /// @endcond
+
+    /**
+     * Fixed-point decimal number, stored as a scaled integer.
+     *
+     * The value represented is `value / 10^Scale`. Multiplication and division widen to the
+     * next integer size (int64 -> int128 -> int256) or go through a 512-bit muldiv for the
+     * 256-bit types, so intermediate products don't overflow. Results are truncated toward zero.
+     *
+     * @ingroup fixed
+     * @tparam Int - Underlying integer: int32_t, uint32_t, int64_t, uint64_t, int128_t, uint128_t, int256 or uint256
+     * @tparam Scale - Number of decimals
+     *
+     * Example:
+     * @code
+     * using amount = ftl::fixed<int64_t, 4>;
+     * amount price = amount::from_raw(12345);   // 1.2345
+     * amount total = price * amount(3);         // 3.7035
+     * ftl::print(total);
+     * @endcode
+     */
+    template<typename Int, uint8_t Scale>
+    struct fixed {
+        /**
+         * The scaled integer
+         */
+        Int value;
+
+        /**
+         * 10^Scale
+         */
+        static constexpr Int one() {
+            Int r = Int(1);
+            for (int i = 0; i < Scale; i++)
+                r = r * Int(10);
+            return r;
+        }
+
+        /**
+         * Construct a new fixed object with a value of 0
+         */
+        constexpr fixed() : value() {}
+
+        /**
+         * Construct a new fixed object from a whole number
+         *
+         * @param integer - The whole number
+         */
+        explicit constexpr fixed(const Int &integer) : value(integer * one()) {}
+
+        /**
+         * Construct a new fixed object from its scaled integer
+         *
+         * @param raw - The value multiplied by 10^Scale
+         * @return fixed - The fixed-point number
+         */
+        static constexpr fixed from_raw(const Int &raw) {
+            fixed r;
+            r.value = raw;
+            return r;
+        }
+
+        /**
+         * Change the number of decimals, truncating when the scale decreases
+         *
+         * @tparam NewScale - Number of decimals of the result
+         * @return fixed<Int, NewScale> - The rescaled number
+         */
+        template<uint8_t NewScale>
+        fixed<Int, NewScale> rescale() const {
+            if constexpr (NewScale >= Scale)
+                return fixed<Int, NewScale>::from_raw(value * fixed<Int, NewScale - Scale>::one());
+            else
+                return fixed<Int, NewScale>::from_raw(value / fixed<Int, Scale - NewScale>::one());
+        }
+
+        /**
+         * Whole part, truncated toward zero
+         */
+        Int integer_part() const { return value / one(); }
+
+        friend constexpr bool operator==(const fixed &a, const fixed &b) { return a.value == b.value; }
+
+        friend constexpr bool operator!=(const fixed &a, const fixed &b) { return a.value != b.value; }
+
+        friend constexpr bool operator<(const fixed &a, const fixed &b) { return a.value < b.value; }
+
+        friend constexpr bool operator>(const fixed &a, const fixed &b) { return a.value > b.value; }
+
+        friend constexpr bool operator<=(const fixed &a, const fixed &b) { return a.value <= b.value; }
+
+        friend constexpr bool operator>=(const fixed &a, const fixed &b) { return a.value >= b.value; }
+
+        friend constexpr fixed operator+(const fixed &a, const fixed &b) { return from_raw(a.value + b.value); }
+
+        friend constexpr fixed operator-(const fixed &a, const fixed &b) { return from_raw(a.value - b.value); }
+
+        friend fixed operator*(const fixed &a, const fixed &b) {
+            return from_raw(_fixed_detail::mul_div(a.value, b.value, one()));
+        }
+
+        friend fixed operator/(const fixed &a, const fixed &b) {
+            return from_raw(_fixed_detail::mul_div(a.value, one(), b.value));
+        }
+
+        constexpr fixed operator-() const { return from_raw(-value); }
+
+        constexpr fixed &operator+=(const fixed &b) { return *this = *this + b; }
+
+        constexpr fixed &operator-=(const fixed &b) { return *this = *this - b; }
+
+        fixed &operator*=(const fixed &b) { return *this = *this * b; }
+
+        fixed &operator/=(const fixed &b) { return *this = *this / b; }
+
+        /**
+         * Decimal representation with exactly Scale decimals
+         *
+         * @return std::string - e.g. "-12.0500" for fixed<int64_t, 4>
+         */
+        std::string to_string() const {
+            std::string digits = _fixed_detail::to_string(value);
+            bool negative = !digits.empty() && digits[0] == '-';
+            if (negative)
+                digits.erase(0, 1);
+            if (digits.size() <= Scale)
+                digits.insert(0, Scale + 1 - digits.size(), '0');
+            if (Scale)
+                digits.insert(digits.size() - Scale, 1, '.');
+            return negative ? "-" + digits : digits;
+        }
+
+        /**
+         * Prints the value in decimal
+         */
+        void print() const {
+            std::string s = to_string();
+            internal_use_do_not_use::prints_l(s.c_str(), s.size());
+        }
+    };
+
+    /**
+     *  Serialize a fixed as its underlying integer
+     *
+     *  @ingroup fixed
+     *  @param ds - The stream to write
+     *  @param v - The value to serialize
+     *  @tparam DataStream - Type of datastream
+     *  @return DataStream& - Reference to the datastream
+     */
+    template<typename DataStream, typename Int, uint8_t Scale>
+    DataStream &operator<<(DataStream &ds, const fixed<Int, Scale> &v) {
+        ds << v.value;
+        return ds;
+    }
+
+    /**
+     *  Deserialize a fixed from its underlying integer
+     *
+     *  @ingroup fixed
+     *  @param ds - The stream to read
+     *  @param v - The destination for deserialized value
+     *  @tparam DataStream - Type of datastream
+     *  @return DataStream& - Reference to the datastream
+     */
+    template<typename DataStream, typename Int, uint8_t Scale>
+    DataStream &operator>>(DataStream &ds, fixed<Int, Scale> &v) {
+        ds >> v.value;
+        return ds;
+    }
+} // namespace ftl
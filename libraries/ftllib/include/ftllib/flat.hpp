@@ -0,0 +1,321 @@
+#pragma once
+
+#include "datastream.hpp"
+
+#include <array>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ftl {
+    /**
+     * @defgroup flat Flat Encoding
+     * @ingroup core
+     * @brief A value format whose members are read in place, without decoding the value
+     *
+     * A flat value starts with one slot per member of the aggregate, in declaration order. Members of a fixed
+     * packed size (see ftl::fixed_pack_size) are packed in their slot. The slot of any other member holds the
+     * uint32 offset and size of its bytes in the rest of the value. std::string and std::vector<char> are stored
+     * raw and read as a std::string_view, other types are packed with the datastream.
+     *
+     * @code
+     * [slot 0][slot 1]...[slot n - 1][variable members]
+     * @endcode
+     *
+     * So a member is found from its index alone, and a fixed one is changed by overwriting its slot.
+     */
+
+    /// @cond INTERNAL
+    namespace _flat_detail {
+        template<typename T>
+        constexpr bool is_inline() { return fixed_pack_size<T>::value > 0; }
+
+        template<typename T>
+        constexpr bool is_raw() { return std::is_same<T, std::string>::value || std::is_same<T, std::vector<char>>::value; }
+
+        template<typename T>
+        constexpr uint32_t slot_size() { return is_inline<T>() ? fixed_pack_size<T>::value : 2 * sizeof(uint32_t); }
+
+        template<typename T, size_t... I>
+        constexpr std::array<uint32_t, sizeof...(I) + 1> slot_offsets(std::index_sequence<I...>) {
+            constexpr uint32_t sizes[] = {slot_size<boost::pfr::tuple_element_t<I, T>>()..., 0};
+            std::array<uint32_t, sizeof...(I) + 1> offsets{};
+            for (size_t i = 0; i < sizeof...(I); ++i)
+                offsets[i + 1] = offsets[i] + sizes[i];
+            return offsets;
+        }
+
+        template<typename T, size_t... I>
+        constexpr std::array<bool, sizeof...(I) + 1> inline_fields(std::index_sequence<I...>) {
+            return {{is_inline<boost::pfr::tuple_element_t<I, T>>()..., true}};
+        }
+
+        template<typename T>
+        struct layout {
+            static_assert(std::is_aggregate<T>::value, "flat values need an aggregate");
+
+            static constexpr size_t fields = boost::pfr::tuple_size_v<T>;
+            static constexpr std::array<uint32_t, fields + 1> offsets =
+                    slot_offsets<T>(std::make_index_sequence<fields>());
+            static constexpr std::array<bool, fields + 1> inlined =
+                    inline_fields<T>(std::make_index_sequence<fields>());
+            // bytes before the variable members
+            static constexpr uint32_t header_size = offsets[fields];
+        };
+
+        /**
+         * Index of Member among the fields of its class
+         */
+        template<auto Member>
+        size_t field_index() {
+            typedef typename _datastream_detail::member_pointer<decltype(Member)>::class_type T;
+            // an empty T tells the member apart from the other fields of the same type
+            T layout;
+            size_t index = 0, i = 0;
+            boost::pfr::for_each_field(layout, [&](const auto &field) {
+                if ((const void *) &field == (const void *) &(layout.*Member))
+                    index = i;
+                ++i;
+            });
+            return index;
+        }
+
+        inline void read_slot(const char *buffer, size_t size, uint32_t slot, uint32_t &offset, uint32_t &length) {
+            memcpy(&offset, buffer + slot, sizeof(offset));
+            memcpy(&length, buffer + slot + sizeof(offset), sizeof(length));
+            check(offset <= size && length <= size - offset, "flat value out of range");
+        }
+
+        inline void write_slot(char *buffer, uint32_t slot, uint32_t offset, uint32_t length) {
+            memcpy(buffer + slot, &offset, sizeof(offset));
+            memcpy(buffer + slot + sizeof(offset), &length, sizeof(length));
+        }
+
+        template<typename F>
+        size_t variable_size(const F &field) {
+            if constexpr (is_raw<F>())
+                return field.size();
+            else
+                return pack_size(field);
+        }
+
+        template<typename F>
+        void write_variable(char *buffer, const F &field) {
+            if constexpr (is_raw<F>()) {
+                if (!field.empty())
+                    memcpy(buffer, field.data(), field.size());
+            } else {
+                datastream<char *> ds(buffer, pack_size(field));
+                ds << field;
+            }
+        }
+
+        /**
+         * Reads the field in the given slot, raw members as a view of the buffer
+         */
+        template<typename F>
+        auto read_field(const char *buffer, size_t size, uint32_t slot) {
+            if constexpr (is_inline<F>()) {
+                F field;
+                datastream<const char *> ds(buffer + slot, fixed_pack_size<F>::value);
+                ds >> field;
+                return field;
+            } else {
+                uint32_t offset, length;
+                read_slot(buffer, size, slot, offset, length);
+                if constexpr (is_raw<F>()) {
+                    return std::string_view(buffer + offset, length);
+                } else {
+                    F field;
+                    datastream<const char *> ds(buffer + offset, length);
+                    ds >> field;
+                    return field;
+                }
+            }
+        }
+    }
+    /// @endcond
+
+/**
+ * Size of v in the flat encoding
+ *
+ * @ingroup flat
+ */
+    template<typename T>
+    size_t flat_pack_size(const T &v) {
+        size_t size = _flat_detail::layout<T>::header_size;
+        boost::pfr::for_each_field(v, [&](const auto &field) {
+            typedef std::decay_t<decltype(field)> F;
+            if constexpr (!_flat_detail::is_inline<F>())
+                size += _flat_detail::variable_size(field);
+        });
+        return size;
+    }
+
+/**
+ * Writes v in the flat encoding to a buffer of flat_pack_size(v) bytes
+ *
+ * @ingroup flat
+ */
+    template<typename T>
+    void flat_pack(const T &v, char *buffer, size_t size) {
+        typedef _flat_detail::layout<T> layout;
+        check(size >= layout::header_size, "flat value out of range");
+        uint32_t offset = layout::header_size;
+        size_t i = 0;
+        boost::pfr::for_each_field(v, [&](const auto &field) {
+            typedef std::decay_t<decltype(field)> F;
+            uint32_t slot = layout::offsets[i++];
+            if constexpr (_flat_detail::is_inline<F>()) {
+                datastream<char *> ds(buffer + slot, fixed_pack_size<F>::value);
+                ds << field;
+            } else {
+                uint32_t length = _flat_detail::variable_size(field);
+                check(length <= size - offset, "flat value out of range");
+                _flat_detail::write_variable(buffer + offset, field);
+                _flat_detail::write_slot(buffer, slot, offset, length);
+                offset += length;
+            }
+        });
+    }
+
+/**
+ * Reads a value in the flat encoding into v
+ *
+ * @ingroup flat
+ */
+    template<typename T>
+    void flat_unpack(const char *buffer, size_t size, T &v) {
+        typedef _flat_detail::layout<T> layout;
+        check(size >= layout::header_size, "flat value out of range");
+        size_t i = 0;
+        boost::pfr::for_each_field(v, [&](auto &field) {
+            typedef std::decay_t<decltype(field)> F;
+            auto read = _flat_detail::read_field<F>(buffer, size, layout::offsets[i++]);
+            if constexpr (_flat_detail::is_raw<F>())
+                field.assign(read.begin(), read.end());
+            else
+                field = std::move(read);
+        });
+    }
+
+/**
+ * A value in the flat encoding read where it is, e.g. in the buffer db_load filled
+ *
+ * @ingroup flat
+ * @tparam T - Type of the value, an aggregate
+ */
+    template<typename T>
+    class flat_view {
+    public:
+        flat_view(const char *buffer, size_t size) : _buffer(buffer), _size(size) {
+            check(size >= _flat_detail::layout<T>::header_size, "flat value out of range");
+        }
+
+        /**
+         * Reads Member, std::string and std::vector<char> members as a std::string_view of the buffer
+         */
+        template<auto Member>
+        auto get() const {
+            typedef typename _datastream_detail::member_pointer<decltype(Member)>::class_type C;
+            typedef typename _datastream_detail::member_pointer<decltype(Member)>::field_type F;
+            static_assert(std::is_same<C, T>::value, "get needs a member of the flat value");
+            return _flat_detail::read_field<F>(_buffer, _size,
+                                               _flat_detail::layout<T>::offsets[_flat_detail::field_index<Member>()]);
+        }
+
+        /**
+         * Decodes the whole value
+         */
+        T value() const {
+            T v;
+            flat_unpack(_buffer, _size, v);
+            return v;
+        }
+
+        const char *data() const { return _buffer; }
+
+        size_t size() const { return _size; }
+
+    private:
+        const char *_buffer;
+        size_t _size;
+    };
+
+/**
+ * A value in the flat encoding, its members are read in place and set by patching the bytes
+ *
+ * @ingroup flat
+ * @tparam T - Type of the value, an aggregate
+ */
+    template<typename T>
+    class flat_value {
+    public:
+        flat_value() {}
+
+        explicit flat_value(const T &v) : bytes(flat_pack_size(v)) {
+            flat_pack(v, bytes.data(), bytes.size());
+        }
+
+        flat_view<T> view() const { return flat_view<T>(bytes.data(), bytes.size()); }
+
+        /**
+         * Reads Member, see flat_view::get, views are valid until the value is next set
+         */
+        template<auto Member>
+        auto get() const {
+            return view().template get<Member>();
+        }
+
+        /**
+         * Sets Member, a fixed size member is overwritten in its slot, a variable one is spliced into the
+         * variable members
+         */
+        template<auto Member>
+        void set(const typename _datastream_detail::member_pointer<decltype(Member)>::field_type &field) {
+            typedef typename _datastream_detail::member_pointer<decltype(Member)>::class_type C;
+            typedef typename _datastream_detail::member_pointer<decltype(Member)>::field_type F;
+            typedef _flat_detail::layout<T> layout;
+            static_assert(std::is_same<C, T>::value, "set needs a member of the flat value");
+            check(bytes.size() >= layout::header_size, "flat value out of range");
+
+            size_t index = _flat_detail::field_index<Member>();
+            uint32_t slot = layout::offsets[index];
+            if constexpr (_flat_detail::is_inline<F>()) {
+                datastream<char *> ds(bytes.data() + slot, fixed_pack_size<F>::value);
+                ds << field;
+            } else {
+                uint32_t offset, length;
+                _flat_detail::read_slot(bytes.data(), bytes.size(), slot, offset, length);
+                size_t old_size = bytes.size();
+                uint32_t new_length = _flat_detail::variable_size(field);
+                if (new_length > length)
+                    bytes.insert(bytes.begin() + offset + length, new_length - length, 0);
+                else
+                    bytes.erase(bytes.begin() + offset + new_length, bytes.begin() + offset + length);
+                _flat_detail::write_variable(bytes.data() + offset, field);
+                _flat_detail::write_slot(bytes.data(), slot, offset, new_length);
+                if (new_length == length)
+                    return;
+                // the variable members after this one moved
+                for (size_t i = 0; i < layout::fields; ++i) {
+                    if (layout::inlined[i] || i == index)
+                        continue;
+                    uint32_t o, l;
+                    _flat_detail::read_slot(bytes.data(), old_size, layout::offsets[i], o, l);
+                    if (o >= offset + length)
+                        _flat_detail::write_slot(bytes.data(), layout::offsets[i], o + new_length - length, l);
+                }
+            }
+        }
+
+        /**
+         * Decodes the whole value
+         */
+        T value() const { return view().value(); }
+
+        std::vector<char> bytes;
+    };
+}
@@ -5,18 +5,24 @@
 
 namespace ftl {
 
+    /**
+     * Values up to max_stack_buffer_size bytes are hashed in the contract as they are packed, larger ones
+     * are packed to the heap and hashed by the host, which is faster on long inputs
+     */
     template<typename T>
     checksum256 *log_hash(T arg) {
+        checksum256 *hash = (checksum256 *) malloc(sizeof(checksum256));
         size_t size = ftl::pack_size(arg);
-        void *buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
+        if (size <= max_stack_buffer_size) {
+            *hash = pack_hash(arg);
+            return hash;
+        }
+
+        void *buffer = malloc(size);
         ftl::datastream<char *> ds((char *) buffer, size);
         ds << arg;
-
-        checksum256 *hash = (checksum256 *) malloc(sizeof(checksum256));
         sha256((char *) buffer, size, hash);
-        if(max_stack_buffer_size < size) {
-            free(buffer);
-        }
+        free(buffer);
         return hash;
     }
 
@@ -1,7 +1,10 @@
 #pragma once
 
 #include "name.hpp"
+#include "blob.hpp"
 #include "datastream.hpp"
+#include "flat.hpp"
+#include "runtime.hpp"
 
 #include <vector>
 #include <tuple>
@@ -21,6 +24,33 @@ namespace ftl {
     }; \
     typedef table<ftl::name(#tbl_name), tbl_key, tbl_value> tbl_typename;
 
+// a table whose values are stored in the flat encoding, see ftl::flat_table
+#define DEF_FLAT_TABLE(tbl_key, tbl_value, tbl_name, tbl_typename) \
+    struct [[ftl::table]] tbl_name { \
+        tbl_key key; \
+        tbl_value value; \
+        static constexpr bool flat = true; \
+    }; \
+    typedef flat_table<ftl::name(#tbl_name), tbl_key, tbl_value> tbl_typename;
+
+// a table whose values are split into chunks, see ftl::blob_table
+#define DEF_BLOB_TABLE(tbl_key, tbl_value, tbl_name, tbl_typename) \
+    struct [[ftl::table]] tbl_name { \
+        tbl_key key; \
+        tbl_value value; \
+        static constexpr bool chunked = true; \
+    }; \
+    typedef blob_table<ftl::name(#tbl_name), tbl_key, tbl_value> tbl_typename;
+
+// an append-only list of values keyed by their index, see ftl::vector_table
+#define DEF_VECTOR_TABLE(tbl_value, tbl_name, tbl_typename) \
+    struct [[ftl::table]] tbl_name { \
+        uint64_t key; \
+        tbl_value value; \
+        static constexpr bool vector = true; \
+    }; \
+    typedef vector_table<ftl::name(#tbl_name), tbl_value> tbl_typename;
+
 #define MAX_KEY_LENGTH 32
 
     class MapKey {
@@ -79,6 +109,32 @@ namespace ftl {
         return internal_use_do_not_use::db_remove_key(table, key.bytes, key.length);
     }
 
+    /**
+     * A table value kept packed, its members are decoded one at a time when read
+     *
+     * @tparam VT - Type of the value, an aggregate for get
+     */
+    template<typename VT>
+    class lazy_value {
+    public:
+        /**
+         * Decodes Member, skipping the fields packed before it
+         */
+        template<auto Member>
+        auto get() const {
+            return unpack_field<Member>(bytes.data(), bytes.size());
+        }
+
+        /**
+         * Decodes the whole value
+         */
+        VT value() const {
+            return unpack<VT>(bytes);
+        }
+
+        std::vector<char> bytes;
+    };
+
     template<ftl::name::raw TableName, typename KT, typename VT>
     class table {
     private:
@@ -88,8 +144,6 @@ namespace ftl {
             return n.length() < 13; //(n & 0x000000000000000FULL) == 0;
         }
 
-        constexpr static size_t max_stack_buffer_size = 512;
-
         static_assert(validate_table_name(ftl::name(TableName)),
                       "table does not support table names with a length greater than 12");
 
@@ -97,39 +151,237 @@ namespace ftl {
         table() {}
 
         void put(const KT &key, const VT &value) {
-            size_t size = ftl::pack_size(value);
+            MapKey pk(key);
+            runtime::table_store(static_cast<uint64_t>(TableName), pk.bytes, pk.length, &value,
+                                 runtime::pack_thunk<VT>);
+        }
 
-            //using malloc/free here potentially is not exception-safe, although WASM doesn't support exceptions
-            void *buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
-            ftl::datastream<char *> ds((char *) buffer, size);
-            ds << value;
+        const VT get(const KT &key) const {
+            MapKey primary(key);
+            VT obj;
+            runtime::table_load(static_cast<uint64_t>(TableName), primary.bytes, primary.length, &obj,
+                                runtime::unpack_thunk<VT>);
+            return static_cast<const VT>(obj);
+        }
 
-            auto pk = MapKey(key);
-            db_store(static_cast<uint64_t>(TableName), pk, buffer, size);
+        /**
+         * Gets the member Member of the value under key without decoding the rest of it, e.g.
+         * t.get_field<&record::active>(key)
+         */
+        template<auto Member>
+        auto get_field(const KT &key) const {
+            static_assert(std::is_same<typename _datastream_detail::member_pointer<decltype(Member)>::class_type,
+                                       VT>::value, "get_field needs a member of the table value");
+            MapKey primary(key);
+            typename _datastream_detail::member_pointer<decltype(Member)>::field_type field;
+            runtime::table_load(static_cast<uint64_t>(TableName), primary.bytes, primary.length, &field,
+                                runtime::unpack_field_thunk<Member>);
+            return field;
+        }
 
-            if (max_stack_buffer_size < size) {
-                free(buffer);
-            }
+        /**
+         * Gets the value under key still packed, to read several members of it with lazy_value::get
+         */
+        lazy_value<VT> get_lazy(const KT &key) const {
+            MapKey primary(key);
+            lazy_value<VT> value;
+            runtime::table_load(static_cast<uint64_t>(TableName), primary.bytes, primary.length, &value.bytes,
+                                runtime::unpack_bytes);
+            return value;
+        }
+
+        bool has_key(const KT &key) const {
+            return db_has_key(static_cast<uint64_t>(TableName), MapKey(key));
+        }
+
+        void erase(const KT &key) {
+            db_remove_key(static_cast<uint64_t>(TableName), MapKey(key));
+        }
+
+    };
+
+    /**
+     * A table whose values are stored in the flat encoding (see @ref flat), for values read more often than
+     * written. A fixed size member is read by loading only the slots of the value, other members straight
+     * from the loaded buffer, and setting a member patches the stored bytes instead of packing the value.
+     *
+     * @code
+     * DEF_FLAT_TABLE(address, account, accounts, accounts_table)
+     * accounts_table t;
+     * uint64_t balance = t.get_field<&account::balance>(owner);
+     * t.read(owner, [&](const ftl::flat_view<account> &a) { print(a.get<&account::memo>()); });
+     * @endcode
+     *
+     * @tparam VT - Type of the value, an aggregate
+     */
+    template<ftl::name::raw TableName, typename KT, typename VT>
+    class flat_table {
+    private:
+
+        constexpr static bool validate_table_name(ftl::name n) {
+            return n.length() < 13;
+        }
+
+        static_assert(validate_table_name(ftl::name(TableName)),
+                      "table does not support table names with a length greater than 12");
+
+    public:
+        flat_table() {}
+
+        void put(const KT &key, const VT &value) {
+            MapKey pk(key);
+            runtime::table_store(static_cast<uint64_t>(TableName), pk.bytes, pk.length, &value,
+                                 runtime::flat_pack_thunk<VT>);
         }
 
         const VT get(const KT &key) const {
             MapKey primary(key);
-            auto size = db_load(static_cast<uint64_t>(TableName), primary, nullptr, 0);
-            ftl::check(size >= 0, "error get from primary key");
+            VT obj;
+            runtime::table_load(static_cast<uint64_t>(TableName), primary.bytes, primary.length, &obj,
+                                runtime::flat_unpack_thunk<VT>);
+            return static_cast<const VT>(obj);
+        }
 
-            //using malloc/free here potentially is not exception-safe, although WASM doesn't support exceptions
-            void *buffer = max_stack_buffer_size < size_t(size) ? malloc(size_t(size)) : alloca(size_t(size));
-            db_load(static_cast<uint64_t>(TableName), primary, buffer, uint32_t(size));
+        /**
+         * Gets the member Member of the value under key, e.g. t.get_field<&record::active>(key)
+         */
+        template<auto Member>
+        auto get_field(const KT &key) const {
+            typedef typename _datastream_detail::member_pointer<decltype(Member)>::field_type F;
+            typedef _flat_detail::layout<VT> layout;
+            static_assert(std::is_same<typename _datastream_detail::member_pointer<decltype(Member)>::class_type,
+                                       VT>::value, "get_field needs a member of the table value");
+            MapKey primary(key);
+            F field;
+            if constexpr (_flat_detail::is_inline<F>()) {
+                // the member is in the slots, the variable members are not loaded
+                char slots[layout::header_size];
+                int loaded = db_load(static_cast<uint64_t>(TableName), primary, slots, sizeof(slots));
+                check(loaded >= 0, "error get from primary key");
+                check(size_t(loaded) >= sizeof(slots), "flat value out of range");
+                field = _flat_detail::read_field<F>(slots, sizeof(slots),
+                                                    layout::offsets[_flat_detail::field_index<Member>()]);
+            } else {
+                runtime::table_load(static_cast<uint64_t>(TableName), primary.bytes, primary.length, &field,
+                                    runtime::flat_field_thunk<Member>);
+            }
+            return field;
+        }
+
+        /**
+         * Calls visitor with a flat_view of the value under key, while it is in the loaded buffer
+         */
+        template<typename Visitor>
+        void read(const KT &key, Visitor visitor) const {
+            MapKey primary(key);
+            runtime::table_load(static_cast<uint64_t>(TableName), primary.bytes, primary.length, &visitor,
+                                runtime::flat_visit_thunk<VT, Visitor>);
+        }
+
+        /**
+         * Gets the value under key as it is stored, to read or set several members of it
+         */
+        flat_value<VT> get_flat(const KT &key) const {
+            MapKey primary(key);
+            flat_value<VT> value;
+            runtime::table_load(static_cast<uint64_t>(TableName), primary.bytes, primary.length, &value.bytes,
+                                runtime::unpack_bytes);
+            return value;
+        }
 
+        void put_flat(const KT &key, const flat_value<VT> &value) {
+            db_store(static_cast<uint64_t>(TableName), MapKey(key), value.bytes.data(), value.bytes.size());
+        }
+
+        /**
+         * Sets the member Member of the value under key by patching the stored value
+         */
+        template<auto Member>
+        void set_field(const KT &key,
+                       const typename _datastream_detail::member_pointer<decltype(Member)>::field_type &field) {
+            flat_value<VT> value = get_flat(key);
+            value.template set<Member>(field);
+            put_flat(key, value);
+        }
+
+        bool has_key(const KT &key) const {
+            return db_has_key(static_cast<uint64_t>(TableName), MapKey(key));
+        }
+
+        void erase(const KT &key) {
+            db_remove_key(static_cast<uint64_t>(TableName), MapKey(key));
+        }
+
+    };
+
+    /**
+     * A table for large values, hundreds of KB, each split into chunks under keys of its own (see @ref blob).
+     * put and get stream the value through one chunk instead of packing it into a single buffer, and reader
+     * and writer give datastreams over the packed bytes. A writer at an offset only loads and stores the
+     * chunks it changes.
+     *
+     * @code
+     * DEF_BLOB_TABLE(uint64_t, std::vector<order>, books, books_table)
+     * books_table t;
+     * t.put(market, orders);
+     * auto ds = t.writer(market, offset);  // patches bytes from offset on, stored when ds goes out of scope
+     * ds << fill;
+     * @endcode
+     *
+     * @tparam KT - Type of the key, packed to at most blob_max_key_size bytes
+     */
+    template<ftl::name::raw TableName, typename KT, typename VT>
+    class blob_table {
+    private:
+
+        constexpr static bool validate_table_name(ftl::name n) {
+            return n.length() < 13;
+        }
+
+        static_assert(validate_table_name(ftl::name(TableName)),
+                      "table does not support table names with a length greater than 12");
+        static_assert(fixed_pack_size<KT>::value <= blob_max_key_size, "blob key size must be smaller than 28");
+
+    public:
+        blob_table() {}
+
+        void put(const KT &key, const VT &value) {
+            MapKey pk(key);
+            datastream<blob_sink> ds(static_cast<uint64_t>(TableName), pk.bytes, pk.length);
+            // the old value is not read back, only its extra chunks removed
+            ds.truncate();
+            ds << value;
+        }
+
+        const VT get(const KT &key) const {
             VT obj;
-            ftl::datastream<const char *> ds((char *) buffer, uint32_t(size));
+            auto ds = reader(key);
             ds >> obj;
+            return static_cast<const VT>(obj);
+        }
 
-            if (max_stack_buffer_size < size_t(size)) {
-                free(buffer);
-            }
+        /**
+         * A datastream reading the packed value under key from offset
+         */
+        datastream<blob_source> reader(const KT &key, uint64_t offset = 0) const {
+            MapKey pk(key);
+            return datastream<blob_source>(static_cast<uint64_t>(TableName), pk.bytes, pk.length, offset);
+        }
 
-            return static_cast<const VT>(obj);
+        /**
+         * A datastream writing the packed value under key from offset, offset 0 of a new value when there
+         * is none. The changes are stored by flush or when the datastream is destroyed.
+         */
+        datastream<blob_sink> writer(const KT &key, uint64_t offset = 0) {
+            MapKey pk(key);
+            return datastream<blob_sink>(static_cast<uint64_t>(TableName), pk.bytes, pk.length, offset);
+        }
+
+        /**
+         * Packed size of the value under key
+         */
+        uint64_t size(const KT &key) const {
+            return reader(key).size();
         }
 
         bool has_key(const KT &key) const {
@@ -137,7 +389,122 @@ namespace ftl {
         }
 
         void erase(const KT &key) {
-            db_remove_key(static_cast<uint64_t>(TableName), MapKey(key));
+            MapKey pk(key);
+            blob_remove(static_cast<uint64_t>(TableName), pk.bytes, pk.length);
+        }
+
+    };
+
+    /**
+     * A list of values for histories such as trades, votes or events, each element stored under its uint64
+     * index and the length in table | 1. Appending or reading an element costs the same however long the list
+     * is, unlike a std::vector in a table value, which is loaded and stored whole on every append.
+     *
+     * @code
+     * DEF_VECTOR_TABLE(trade, trades, trades_table)
+     * trades_table t;
+     * t.push_back(tr);
+     * std::vector<trade> last = t.get_range(t.size() - 10, 10);
+     * @endcode
+     */
+    template<ftl::name::raw TableName, typename T>
+    class vector_table {
+    private:
+
+        constexpr static bool validate_table_name(ftl::name n) {
+            return n.length() < 13;
+        }
+
+        static_assert(validate_table_name(ftl::name(TableName)),
+                      "table does not support table names with a length greater than 12");
+
+        void set_size(uint64_t size) {
+            char buffer[sizeof(size)];
+            datastream<char *> ds(buffer, sizeof(buffer));
+            ds << size;
+            db_store(static_cast<uint64_t>(TableName) | 1, MapKey(uint64_t(0)), buffer, sizeof(buffer));
+        }
+
+    public:
+        vector_table() {}
+
+        uint64_t size() const {
+            char buffer[sizeof(uint64_t)];
+            int loaded = db_load(static_cast<uint64_t>(TableName) | 1, MapKey(uint64_t(0)), buffer, sizeof(buffer));
+            if (loaded < 0)
+                return 0;
+            check(size_t(loaded) == sizeof(buffer), "vector size");
+            uint64_t size;
+            datastream<const char *> ds(buffer, sizeof(buffer));
+            ds >> size;
+            return size;
+        }
+
+        bool empty() const { return size() == 0; }
+
+        /**
+         * Appends value, returns its index
+         */
+        uint64_t push_back(const T &value) {
+            uint64_t index = size();
+            MapKey pk(index);
+            runtime::table_store(static_cast<uint64_t>(TableName), pk.bytes, pk.length, &value,
+                                 runtime::pack_thunk<T>);
+            set_size(index + 1);
+            return index;
+        }
+
+        const T get(uint64_t index) const {
+            MapKey pk(index);
+            T obj;
+            runtime::table_load(static_cast<uint64_t>(TableName), pk.bytes, pk.length, &obj,
+                                runtime::unpack_thunk<T>);
+            return static_cast<const T>(obj);
+        }
+
+        const T back() const {
+            uint64_t n = size();
+            check(n > 0, "vector is empty");
+            return get(n - 1);
+        }
+
+        /**
+         * Gets the count elements from first on
+         */
+        std::vector<T> get_range(uint64_t first, uint64_t count) const {
+            uint64_t n = size();
+            check(first <= n && count <= n - first, "vector range out of bounds");
+            std::vector<T> values(count);
+            for (uint64_t i = 0; i < count; ++i) {
+                MapKey pk(first + i);
+                runtime::table_load(static_cast<uint64_t>(TableName), pk.bytes, pk.length, &values[i],
+                                    runtime::unpack_thunk<T>);
+            }
+            return values;
+        }
+
+        void set(uint64_t index, const T &value) {
+            check(index < size(), "vector index out of bounds");
+            MapKey pk(index);
+            runtime::table_store(static_cast<uint64_t>(TableName), pk.bytes, pk.length, &value,
+                                 runtime::pack_thunk<T>);
+        }
+
+        void pop_back() {
+            uint64_t n = size();
+            check(n > 0, "vector is empty");
+            truncate(n - 1);
+        }
+
+        /**
+         * Removes the elements from size on, the cost is in the number removed
+         */
+        void truncate(uint64_t size) {
+            uint64_t n = this->size();
+            check(size <= n, "vector index out of bounds");
+            for (uint64_t i = size; i < n; ++i)
+                db_remove_key(static_cast<uint64_t>(TableName), MapKey(i));
+            set_size(size);
         }
 
     };
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "base.hpp"
+#include "datastream.hpp"
+#include "flat.hpp"
+
+#include <vector>
+
+namespace ftl {
+
+    /**
+     * @defgroup runtime Runtime
+     * @ingroup core
+     * @brief Shared non-template core of the dispatcher, ftl::table and ftl::action
+     *
+     * The templates only instantiate a pack and an unpack thunk per serialized type. Buffering, the host
+     * calls and freeing the buffers live in the ftl_rt library, so a contract carries one copy of them
+     * instead of one per action, table or called signature.
+     *
+     * The thunks are extra functions and the calls into ftl_rt go through function pointers, so whether a
+     * given contract gets smaller depends on how many actions and tables share the same code. The saving
+     * hasn't been measured on examples/, compare two builds with fractal-size new.wasm --diff old.wasm.
+     */
+    namespace runtime {
+
+        /**
+         * Packs the value into buffer, or returns its packed size when buffer is null
+         */
+        typedef size_t (*pack_fn)(const void *value, char *buffer, size_t size);
+
+        /**
+         * Unpacks size bytes of buffer into the value
+         */
+        typedef void (*unpack_fn)(void *value, const char *buffer, size_t size);
+
+        template<typename T>
+        size_t pack_thunk(const void *value, char *buffer, size_t size) {
+            const T &v = *static_cast<const T *>(value);
+            if (!buffer)
+                return pack_size(v);
+            datastream<char *> ds(buffer, size);
+            ds << v;
+            return size;
+        }
+
+        template<typename T>
+        void unpack_thunk(void *value, const char *buffer, size_t size) {
+            datastream<const char *> ds(buffer, size);
+            ds >> *static_cast<T *>(value);
+        }
+
+        /**
+         * Unpacks only the member Member of the struct packed in buffer, see ftl::unpack_field
+         */
+        template<auto Member>
+        void unpack_field_thunk(void *value, const char *buffer, size_t size) {
+            typedef typename _datastream_detail::member_pointer<decltype(Member)>::field_type F;
+            *static_cast<F *>(value) = unpack_field<Member>(buffer, size);
+        }
+
+        template<typename T>
+        size_t flat_pack_thunk(const void *value, char *buffer, size_t size) {
+            const T &v = *static_cast<const T *>(value);
+            if (!buffer)
+                return flat_pack_size(v);
+            flat_pack(v, buffer, size);
+            return size;
+        }
+
+        template<typename T>
+        void flat_unpack_thunk(void *value, const char *buffer, size_t size) {
+            flat_unpack(buffer, size, *static_cast<T *>(value));
+        }
+
+        /**
+         * Reads only the member Member of the flat value in buffer, see ftl::flat_view
+         */
+        template<auto Member>
+        void flat_field_thunk(void *value, const char *buffer, size_t size) {
+            typedef typename _datastream_detail::member_pointer<decltype(Member)>::class_type T;
+            typedef typename _datastream_detail::member_pointer<decltype(Member)>::field_type F;
+            F &field = *static_cast<F *>(value);
+            auto read = flat_view<T>(buffer, size).template get<Member>();
+            if constexpr (_flat_detail::is_raw<F>())
+                field.assign(read.begin(), read.end());
+            else
+                field = std::move(read);
+        }
+
+        /**
+         * Calls the visitor with a view of the flat value in buffer
+         */
+        template<typename T, typename Visitor>
+        void flat_visit_thunk(void *visitor, const char *buffer, size_t size) {
+            (*static_cast<Visitor *>(visitor))(flat_view<T>(buffer, size));
+        }
+
+        /**
+         * Copies the packed bytes into the std::vector<char> value
+         */
+        void unpack_bytes(void *value, const char *buffer, size_t size);
+
+        /**
+         * Reads the data of the current action into args
+         */
+        void read_action(void *args, unpack_fn unpack);
+
+        /**
+         * Sets the packed result as the result of the current action, nothing is set when it packs to 0 bytes
+         */
+        void set_result(const void *result, pack_fn pack);
+
+        /**
+         * Stores the packed value under key in table
+         */
+        void table_store(uint64_t table, const void *key, size_t key_size, const void *value, pack_fn pack);
+
+        /**
+         * Loads the value under key in table, fails the action when there is none
+         */
+        void table_load(uint64_t table, const void *key, size_t key_size, void *value, unpack_fn unpack);
+
+        /**
+         * Calls act of contract with the packed args, then unpacks its result into result unless unpack is null
+         *
+         * @return the status returned by the call
+         */
+        int call_action(const void *contract, size_t contract_size, uint64_t act, uint64_t amount,
+                        int storage_delegate, int user_delegate, const void *args, pack_fn pack,
+                        void *result, unpack_fn unpack);
+
+        /**
+         * call_action that gets a result of up to max_stack_buffer_size bytes back with the call, larger ones
+         * take another host call. Needs the call_action_result import, see FTL_CALL_RESULT.
+         *
+         * @return the status returned by the call
+         */
+        int call_action_result(const void *contract, size_t contract_size, uint64_t act, uint64_t amount,
+                               int storage_delegate, int user_delegate, const void *args, pack_fn pack,
+                               void *result, unpack_fn unpack);
+
+        /**
+         * Where multi_call unpacks the result of a call, and its status once done
+         */
+        struct call_slot {
+            void *result;
+            unpack_fn unpack;
+            int status;
+        };
+
+        /**
+         * Appends a call of act of contract with the packed args to the calls of a multi_call
+         */
+        void pack_call(std::vector<char> &calls, const void *contract, size_t contract_size, uint64_t act,
+                       uint64_t amount, int storage_delegate, int user_delegate, const void *args, pack_fn pack);
+
+        /**
+         * Makes the count packed calls in a single host call, then sets the status of each slot and unpacks
+         * the results of those with an unpack function. Needs the multi_call import, see FTL_CALL_RESULT.
+         *
+         * @return 0 when every call returned 0, else the status of the first one that didn't
+         */
+        int multi_call(const std::vector<char> &calls, call_slot *slots, size_t count);
+    }
+}
@@ -0,0 +1,682 @@
+#pragma once
+
+#include "check.hpp"
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace ftl {
+    /**
+     * @defgroup uint256 256-bit Integer Types
+     * @ingroup core
+     * @ingroup types
+     * @brief Defines fixed width 256-bit unsigned and signed integers
+     *
+     * @details Both types store four 64-bit limbs, least significant first, which is also
+     * their 32 bytes little-endian datastream encoding. Arithmetic only uses native 64-bit
+     * operations: products are built from 32-bit halves and division runs on 32-bit digits,
+     * so nothing goes through the __int128 builtins or floating point.
+     */
+
+    /// @cond INTERNAL
+    namespace _uint256_detail {
+        /**
+         * 64x64 -> 128-bit multiply, returns the low word and stores the high word in high
+         */
+        constexpr uint64_t mul64(uint64_t a, uint64_t b, uint64_t &high) {
+            const uint64_t lower_mask = 0xffffffffULL;
+            uint64_t a0 = a & lower_mask, a1 = a >> 32;
+            uint64_t b0 = b & lower_mask, b1 = b >> 32;
+            uint64_t p00 = a0 * b0;
+            uint64_t p01 = a0 * b1;
+            uint64_t p10 = a1 * b0;
+            uint64_t mid = (p00 >> 32) + (p01 & lower_mask) + (p10 & lower_mask);
+            high = a1 * b1 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+            return (p00 & lower_mask) | (mid << 32);
+        }
+
+        /**
+         * r[0..n) += a * b[0..n), returns the carry out of the top word
+         */
+        constexpr uint64_t mul_add(uint64_t *r, uint64_t a, const uint64_t *b, int n) {
+            uint64_t carry = 0;
+            for (int j = 0; j < n; j++) {
+                uint64_t high = 0;
+                uint64_t low = mul64(a, b[j], high);
+                uint64_t t = r[j] + low;
+                high += t < low;
+                r[j] = t + carry;
+                high += r[j] < carry;
+                carry = high;
+            }
+            return carry;
+        }
+
+        /**
+         * Number of significant 32-bit digits in d[0..n)
+         */
+        inline int digits(const uint32_t *d, int n) {
+            while (n > 0 && d[n - 1] == 0)
+                --n;
+            return n;
+        }
+
+        /**
+         * Knuth algorithm D on 32-bit digits, least significant first.
+         * u has m digits, v has n significant digits, q receives m - n + 1 digits and r receives n digits.
+         */
+        inline void divmod(const uint32_t *u, int m, const uint32_t *v, int n, uint32_t *q, uint32_t *r) {
+            const uint64_t base = 1ULL << 32;
+
+            if (n == 1) {
+                uint64_t rem = 0;
+                for (int j = m - 1; j >= 0; j--) {
+                    uint64_t cur = (rem << 32) | u[j];
+                    q[j] = uint32_t(cur / v[0]);
+                    rem = cur % v[0];
+                }
+                r[0] = uint32_t(rem);
+                return;
+            }
+
+            // normalize so the top divisor digit has its high bit set
+            int s = __builtin_clz(v[n - 1]);
+            uint32_t vn[16];
+            uint32_t un[33];
+            for (int i = n - 1; i > 0; i--)
+                vn[i] = uint32_t((uint64_t(v[i]) << s) | (uint64_t(v[i - 1]) >> (32 - s)));
+            vn[0] = v[0] << s;
+            un[m] = uint32_t(uint64_t(u[m - 1]) >> (32 - s));
+            for (int i = m - 1; i > 0; i--)
+                un[i] = uint32_t((uint64_t(u[i]) << s) | (uint64_t(u[i - 1]) >> (32 - s)));
+            un[0] = u[0] << s;
+
+            for (int j = m - n; j >= 0; j--) {
+                uint64_t num = (uint64_t(un[j + n]) << 32) | un[j + n - 1];
+                uint64_t qhat = num / vn[n - 1];
+                uint64_t rhat = num % vn[n - 1];
+                while (qhat >= base || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+                    --qhat;
+                    rhat += vn[n - 1];
+                    if (rhat >= base)
+                        break;
+                }
+
+                // multiply and subtract
+                int64_t t = 0;
+                uint64_t k = 0;
+                for (int i = 0; i < n; i++) {
+                    uint64_t p = qhat * vn[i];
+                    t = int64_t(un[i + j]) - int64_t(k) - int64_t(p & 0xffffffffULL);
+                    un[i + j] = uint32_t(t);
+                    k = (p >> 32) - (t >> 32);
+                }
+                t = int64_t(un[j + n]) - int64_t(k);
+                un[j + n] = uint32_t(t);
+
+                q[j] = uint32_t(qhat);
+                if (t < 0) {
+                    // qhat was one too large, add the divisor back
+                    --q[j];
+                    k = 0;
+                    for (int i = 0; i < n; i++) {
+                        uint64_t sum = uint64_t(un[i + j]) + vn[i] + k;
+                        un[i + j] = uint32_t(sum);
+                        k = sum >> 32;
+                    }
+                    un[j + n] = uint32_t(uint64_t(un[j + n]) + k);
+                }
+            }
+
+            for (int i = 0; i < n - 1; i++)
+                r[i] = uint32_t((uint64_t(un[i]) >> s) | (uint64_t(un[i + 1]) << (32 - s)));
+            r[n - 1] = uint32_t(uint64_t(un[n - 1]) >> s);
+        }
+
+        inline void to_digits(const uint64_t *limbs, int n, uint32_t *d) {
+            for (int i = 0; i < n; i++) {
+                d[2 * i] = uint32_t(limbs[i]);
+                d[2 * i + 1] = uint32_t(limbs[i] >> 32);
+            }
+        }
+
+        inline void from_digits(const uint32_t *d, int n, uint64_t *limbs, int limb_count) {
+            for (int i = 0; i < limb_count; i++) {
+                uint64_t low = 2 * i < n ? d[2 * i] : 0;
+                uint64_t high = 2 * i + 1 < n ? d[2 * i + 1] : 0;
+                limbs[i] = low | (high << 32);
+            }
+        }
+    }
+    /// @endcond
+
+    /**
+     * 256-bit unsigned integer with wrap-around arithmetic
+     *
+     * @ingroup uint256
+     */
+    struct uint256 {
+        /**
+         * Little-endian 64-bit limbs
+         */
+        uint64_t limbs[4];
+
+        /**
+         * Construct a new uint256 object with a value of 0
+         */
+        constexpr uint256() : limbs{0, 0, 0, 0} {}
+
+        /**
+         * Construct a new uint256 object from a built-in integer, negative values are sign extended
+         *
+         * @param v - Source
+         */
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        constexpr uint256(T v) : limbs{0, 0, 0, 0} {
+            uint64_t fill = std::is_signed<T>::value && v < 0 ? ~0ULL : 0;
+            limbs[0] = uint64_t(v);
+            if constexpr (sizeof(T) > 8)
+                limbs[1] = uint64_t(v >> 64);
+            else
+                limbs[1] = fill;
+            limbs[2] = limbs[3] = fill;
+        }
+
+        /**
+         * Construct a new uint256 object from its limbs
+         */
+        constexpr uint256(uint64_t l0, uint64_t l1, uint64_t l2, uint64_t l3) : limbs{l0, l1, l2, l3} {}
+
+        /**
+         * Truncate to a built-in integer
+         */
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        explicit constexpr operator T() const {
+            if constexpr (sizeof(T) > 8)
+                return T((uint128_t(limbs[1]) << 64) | limbs[0]);
+            else
+                return T(limbs[0]);
+        }
+
+        explicit constexpr operator bool() const {
+            return (limbs[0] | limbs[1] | limbs[2] | limbs[3]) != 0;
+        }
+
+        /**
+         * Number of significant bits, 0 for a value of 0
+         */
+        constexpr int bits() const {
+            for (int i = 3; i >= 0; i--)
+                if (limbs[i])
+                    return 64 * i + 64 - __builtin_clzll(limbs[i]);
+            return 0;
+        }
+
+        friend constexpr bool operator==(const uint256 &a, const uint256 &b) {
+            return a.limbs[0] == b.limbs[0] && a.limbs[1] == b.limbs[1] &&
+                   a.limbs[2] == b.limbs[2] && a.limbs[3] == b.limbs[3];
+        }
+
+        friend constexpr bool operator!=(const uint256 &a, const uint256 &b) { return !(a == b); }
+
+        friend constexpr bool operator<(const uint256 &a, const uint256 &b) {
+            for (int i = 3; i >= 0; i--)
+                if (a.limbs[i] != b.limbs[i])
+                    return a.limbs[i] < b.limbs[i];
+            return false;
+        }
+
+        friend constexpr bool operator>(const uint256 &a, const uint256 &b) { return b < a; }
+
+        friend constexpr bool operator<=(const uint256 &a, const uint256 &b) { return !(b < a); }
+
+        friend constexpr bool operator>=(const uint256 &a, const uint256 &b) { return !(a < b); }
+
+        friend constexpr uint256 operator+(const uint256 &a, const uint256 &b) {
+            uint256 r;
+            uint64_t carry = 0;
+            for (int i = 0; i < 4; i++) {
+                uint64_t t = a.limbs[i] + carry;
+                carry = t < carry;
+                r.limbs[i] = t + b.limbs[i];
+                carry += r.limbs[i] < t;
+            }
+            return r;
+        }
+
+        friend constexpr uint256 operator-(const uint256 &a, const uint256 &b) {
+            uint256 r;
+            uint64_t borrow = 0;
+            for (int i = 0; i < 4; i++) {
+                uint64_t t = a.limbs[i] - b.limbs[i];
+                uint64_t next = a.limbs[i] < b.limbs[i];
+                r.limbs[i] = t - borrow;
+                next += t < borrow;
+                borrow = next;
+            }
+            return r;
+        }
+
+        friend constexpr uint256 operator*(const uint256 &a, const uint256 &b) {
+            uint256 r;
+            for (int i = 0; i < 4; i++) {
+                if (a.limbs[i] == 0)
+                    continue;
+                // products above limb 3 are truncated away
+                _uint256_detail::mul_add(r.limbs + i, a.limbs[i], b.limbs, 4 - i);
+            }
+            return r;
+        }
+
+        /**
+         * Quotient and remainder in one pass
+         *
+         * @param a - Dividend
+         * @param b - Divisor, must not be 0
+         * @param rem - Receives the remainder, may be null
+         * @return uint256 - The quotient
+         */
+        static uint256 divmod(const uint256 &a, const uint256 &b, uint256 *rem) {
+            ftl::check(bool(b), "uint256 division by zero");
+            uint256 q;
+            if (a < b) {
+                if (rem)
+                    *rem = a;
+                return q;
+            }
+            if ((a.limbs[1] | a.limbs[2] | a.limbs[3] | b.limbs[1] | b.limbs[2] | b.limbs[3]) == 0) {
+                q.limbs[0] = a.limbs[0] / b.limbs[0];
+                if (rem)
+                    *rem = uint256(a.limbs[0] % b.limbs[0]);
+                return q;
+            }
+
+            uint32_t u[8], v[8], qd[8] = {0}, rd[8] = {0};
+            _uint256_detail::to_digits(a.limbs, 4, u);
+            _uint256_detail::to_digits(b.limbs, 4, v);
+            int m = _uint256_detail::digits(u, 8);
+            int n = _uint256_detail::digits(v, 8);
+            _uint256_detail::divmod(u, m, v, n, qd, rd);
+            _uint256_detail::from_digits(qd, m - n + 1, q.limbs, 4);
+            if (rem)
+                _uint256_detail::from_digits(rd, n, rem->limbs, 4);
+            return q;
+        }
+
+        friend uint256 operator/(const uint256 &a, const uint256 &b) { return divmod(a, b, nullptr); }
+
+        friend uint256 operator%(const uint256 &a, const uint256 &b) {
+            uint256 r;
+            divmod(a, b, &r);
+            return r;
+        }
+
+        static constexpr uint256 shl(const uint256 &a, unsigned shift) {
+            uint256 r;
+            if (shift >= 256)
+                return r;
+            unsigned limb_shift = shift / 64, bit_shift = shift % 64;
+            for (int i = 3; i >= int(limb_shift); i--) {
+                r.limbs[i] = a.limbs[i - limb_shift] << bit_shift;
+                if (bit_shift && i > int(limb_shift))
+                    r.limbs[i] |= a.limbs[i - limb_shift - 1] >> (64 - bit_shift);
+            }
+            return r;
+        }
+
+        static constexpr uint256 shr(const uint256 &a, unsigned shift) {
+            uint256 r;
+            if (shift >= 256)
+                return r;
+            unsigned limb_shift = shift / 64, bit_shift = shift % 64;
+            for (int i = 0; i + limb_shift < 4; i++) {
+                r.limbs[i] = a.limbs[i + limb_shift] >> bit_shift;
+                if (bit_shift && i + limb_shift + 1 < 4)
+                    r.limbs[i] |= a.limbs[i + limb_shift + 1] << (64 - bit_shift);
+            }
+            return r;
+        }
+
+        // The shift operators take the count as a template so they are preferred over the
+        // datastream operator<< and operator>> templates, which also accept `uint256 << int`
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        friend constexpr uint256 operator<<(const uint256 &a, T shift) { return shl(a, unsigned(shift)); }
+
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        friend constexpr uint256 operator<<(uint256 &a, T shift) { return shl(a, unsigned(shift)); }
+
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        friend constexpr uint256 operator>>(const uint256 &a, T shift) { return shr(a, unsigned(shift)); }
+
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        friend constexpr uint256 operator>>(uint256 &a, T shift) { return shr(a, unsigned(shift)); }
+
+        friend constexpr uint256 operator&(const uint256 &a, const uint256 &b) {
+            return uint256(a.limbs[0] & b.limbs[0], a.limbs[1] & b.limbs[1],
+                           a.limbs[2] & b.limbs[2], a.limbs[3] & b.limbs[3]);
+        }
+
+        friend constexpr uint256 operator|(const uint256 &a, const uint256 &b) {
+            return uint256(a.limbs[0] | b.limbs[0], a.limbs[1] | b.limbs[1],
+                           a.limbs[2] | b.limbs[2], a.limbs[3] | b.limbs[3]);
+        }
+
+        friend constexpr uint256 operator^(const uint256 &a, const uint256 &b) {
+            return uint256(a.limbs[0] ^ b.limbs[0], a.limbs[1] ^ b.limbs[1],
+                           a.limbs[2] ^ b.limbs[2], a.limbs[3] ^ b.limbs[3]);
+        }
+
+        constexpr uint256 operator~() const { return uint256(~limbs[0], ~limbs[1], ~limbs[2], ~limbs[3]); }
+
+        constexpr uint256 operator-() const { return uint256() - *this; }
+
+        constexpr uint256 &operator+=(const uint256 &b) { return *this = *this + b; }
+
+        constexpr uint256 &operator-=(const uint256 &b) { return *this = *this - b; }
+
+        constexpr uint256 &operator*=(const uint256 &b) { return *this = *this * b; }
+
+        uint256 &operator/=(const uint256 &b) { return *this = *this / b; }
+
+        uint256 &operator%=(const uint256 &b) { return *this = *this % b; }
+
+        constexpr uint256 &operator<<=(unsigned shift) { return *this = shl(*this, shift); }
+
+        constexpr uint256 &operator>>=(unsigned shift) { return *this = shr(*this, shift); }
+
+        constexpr uint256 &operator&=(const uint256 &b) { return *this = *this & b; }
+
+        constexpr uint256 &operator|=(const uint256 &b) { return *this = *this | b; }
+
+        constexpr uint256 &operator^=(const uint256 &b) { return *this = *this ^ b; }
+
+        constexpr uint256 &operator++() { return *this += uint256(1); }
+
+        constexpr uint256 &operator--() { return *this -= uint256(1); }
+
+        /**
+         * Decimal representation
+         *
+         * @return std::string - The decimal digits
+         */
+        std::string to_string() const {
+            if (!bool(*this))
+                return "0";
+            // peel off 9 decimal digits per division, the divisor fits a single 32-bit digit
+            char buffer[80];
+            int pos = sizeof(buffer);
+            uint256 v = *this;
+            while (bool(v)) {
+                uint256 chunk;
+                v = divmod(v, uint256(1000000000u), &chunk);
+                uint32_t c = uint32_t(chunk.limbs[0]);
+                for (int i = 0; i < 9 && (bool(v) || c); i++) {
+                    buffer[--pos] = char('0' + c % 10);
+                    c /= 10;
+                }
+            }
+            return std::string(buffer + pos, sizeof(buffer) - pos);
+        }
+
+        /**
+         * Prints the value in decimal
+         */
+        void print() const {
+            std::string s = to_string();
+            internal_use_do_not_use::prints_l(s.c_str(), s.size());
+        }
+    };
+
+    /**
+     * 256-bit two's complement signed integer
+     *
+     * @ingroup uint256
+     */
+    struct int256 {
+        /**
+         * The two's complement bits
+         */
+        uint256 bits;
+
+        /**
+         * Construct a new int256 object with a value of 0
+         */
+        constexpr int256() : bits() {}
+
+        /**
+         * Construct a new int256 object from a built-in integer
+         *
+         * @param v - Source
+         */
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        constexpr int256(T v) : bits(v) {}
+
+        /**
+         * Reinterpret the bits of an unsigned value
+         *
+         * @param v - Source
+         */
+        explicit constexpr int256(const uint256 &v) : bits(v) {}
+
+        /**
+         * Truncate to a built-in integer
+         */
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        explicit constexpr operator T() const { return T(bits); }
+
+        explicit constexpr operator bool() const { return bool(bits); }
+
+        constexpr bool is_negative() const { return int64_t(bits.limbs[3]) < 0; }
+
+        /**
+         * Absolute value as an unsigned integer, well defined for the minimum value too
+         */
+        constexpr uint256 magnitude() const { return is_negative() ? -bits : bits; }
+
+        friend constexpr bool operator==(const int256 &a, const int256 &b) { return a.bits == b.bits; }
+
+        friend constexpr bool operator!=(const int256 &a, const int256 &b) { return a.bits != b.bits; }
+
+        friend constexpr bool operator<(const int256 &a, const int256 &b) {
+            if (a.is_negative() != b.is_negative())
+                return a.is_negative();
+            return a.bits < b.bits;
+        }
+
+        friend constexpr bool operator>(const int256 &a, const int256 &b) { return b < a; }
+
+        friend constexpr bool operator<=(const int256 &a, const int256 &b) { return !(b < a); }
+
+        friend constexpr bool operator>=(const int256 &a, const int256 &b) { return !(a < b); }
+
+        friend constexpr int256 operator+(const int256 &a, const int256 &b) { return int256(a.bits + b.bits); }
+
+        friend constexpr int256 operator-(const int256 &a, const int256 &b) { return int256(a.bits - b.bits); }
+
+        friend constexpr int256 operator*(const int256 &a, const int256 &b) { return int256(a.bits * b.bits); }
+
+        /**
+         * Truncating division, the remainder has the sign of the dividend
+         */
+        static int256 divmod(const int256 &a, const int256 &b, int256 *rem) {
+            uint256 r;
+            uint256 q = uint256::divmod(a.magnitude(), b.magnitude(), &r);
+            if (rem)
+                *rem = int256(a.is_negative() ? -r : r);
+            return int256(a.is_negative() != b.is_negative() ? -q : q);
+        }
+
+        friend int256 operator/(const int256 &a, const int256 &b) { return divmod(a, b, nullptr); }
+
+        friend int256 operator%(const int256 &a, const int256 &b) {
+            int256 r;
+            divmod(a, b, &r);
+            return r;
+        }
+
+        /**
+         * Arithmetic shift right
+         */
+        static constexpr int256 sar(const int256 &a, unsigned shift) {
+            if (!a.is_negative())
+                return int256(uint256::shr(a.bits, shift));
+            return int256(~uint256::shr(~a.bits, shift));
+        }
+
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        friend constexpr int256 operator<<(const int256 &a, T shift) { return int256(uint256::shl(a.bits, unsigned(shift))); }
+
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        friend constexpr int256 operator<<(int256 &a, T shift) { return int256(uint256::shl(a.bits, unsigned(shift))); }
+
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        friend constexpr int256 operator>>(const int256 &a, T shift) { return sar(a, unsigned(shift)); }
+
+        template<typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+        friend constexpr int256 operator>>(int256 &a, T shift) { return sar(a, unsigned(shift)); }
+
+        friend constexpr int256 operator&(const int256 &a, const int256 &b) { return int256(a.bits & b.bits); }
+
+        friend constexpr int256 operator|(const int256 &a, const int256 &b) { return int256(a.bits | b.bits); }
+
+        friend constexpr int256 operator^(const int256 &a, const int256 &b) { return int256(a.bits ^ b.bits); }
+
+        constexpr int256 operator~() const { return int256(~bits); }
+
+        constexpr int256 operator-() const { return int256(-bits); }
+
+        constexpr int256 &operator+=(const int256 &b) { return *this = *this + b; }
+
+        constexpr int256 &operator-=(const int256 &b) { return *this = *this - b; }
+
+        constexpr int256 &operator*=(const int256 &b) { return *this = *this * b; }
+
+        int256 &operator/=(const int256 &b) { return *this = *this / b; }
+
+        int256 &operator%=(const int256 &b) { return *this = *this % b; }
+
+        constexpr int256 &operator++() { return *this += int256(1); }
+
+        constexpr int256 &operator--() { return *this -= int256(1); }
+
+        /**
+         * Decimal representation
+         *
+         * @return std::string - The decimal digits with a leading '-' for negative values
+         */
+        std::string to_string() const {
+            return is_negative() ? "-" + magnitude().to_string() : bits.to_string();
+        }
+
+        /**
+         * Prints the value in decimal
+         */
+        void print() const {
+            std::string s = to_string();
+            internal_use_do_not_use::prints_l(s.c_str(), s.size());
+        }
+    };
+
+    /**
+     * Computes a * b / c with a 512-bit intermediate product, so the multiplication can't overflow
+     *
+     * @ingroup uint256
+     * @param a - Multiplicand
+     * @param b - Multiplier
+     * @param c - Divisor, must not be 0
+     * @return uint256 - The truncated quotient, it must fit in 256 bits
+     */
+    inline uint256 muldiv(const uint256 &a, const uint256 &b, const uint256 &c) {
+        ftl::check(bool(c), "uint256 division by zero");
+        uint64_t product[8] = {0};
+        for (int i = 0; i < 4; i++) {
+            if (a.limbs[i])
+                product[i + 4] = _uint256_detail::mul_add(product + i, a.limbs[i], b.limbs, 4);
+        }
+        if ((product[4] | product[5] | product[6] | product[7]) == 0)
+            return uint256(product[0], product[1], product[2], product[3]) / c;
+
+        uint32_t u[16], v[8], qd[16] = {0}, rd[8] = {0};
+        _uint256_detail::to_digits(product, 8, u);
+        _uint256_detail::to_digits(c.limbs, 4, v);
+        int m = _uint256_detail::digits(u, 16);
+        int n = _uint256_detail::digits(v, 8);
+        _uint256_detail::divmod(u, m, v, n, qd, rd);
+        ftl::check(_uint256_detail::digits(qd, 16) <= 8, "uint256 muldiv overflow");
+        uint256 q;
+        _uint256_detail::from_digits(qd, 8, q.limbs, 4);
+        return q;
+    }
+
+    /**
+     * Computes a * b / c with a 512-bit intermediate product, truncating toward zero
+     *
+     * @ingroup uint256
+     */
+    inline int256 muldiv(const int256 &a, const int256 &b, const int256 &c) {
+        uint256 q = muldiv(a.magnitude(), b.magnitude(), c.magnitude());
+        bool negative = a.is_negative() != b.is_negative() ? !c.is_negative() : c.is_negative();
+        return int256(negative ? -q : q);
+    }
+
+    /**
+     *  Serialize a uint256 as 32 little-endian bytes
+     *
+     *  @ingroup uint256
+     *  @param ds - The stream to write
+     *  @param v - The value to serialize
+     *  @tparam DataStream - Type of datastream
+     *  @return DataStream& - Reference to the datastream
+     */
+    template<typename DataStream>
+    DataStream &operator<<(DataStream &ds, const uint256 &v) {
+        ds.write((const char *) v.limbs, sizeof(v.limbs));
+        return ds;
+    }
+
+    /**
+     *  Deserialize a uint256 from 32 little-endian bytes
+     *
+     *  @ingroup uint256
+     *  @param ds - The stream to read
+     *  @param v - The destination for deserialized value
+     *  @tparam DataStream - Type of datastream
+     *  @return DataStream& - Reference to the datastream
+     */
+    template<typename DataStream>
+    DataStream &operator>>(DataStream &ds, uint256 &v) {
+        ds.read((char *) v.limbs, sizeof(v.limbs));
+        return ds;
+    }
+
+    /**
+     *  Serialize an int256 as 32 little-endian two's complement bytes
+     *
+     *  @ingroup uint256
+     *  @param ds - The stream to write
+     *  @param v - The value to serialize
+     *  @tparam DataStream - Type of datastream
+     *  @return DataStream& - Reference to the datastream
+     */
+    template<typename DataStream>
+    DataStream &operator<<(DataStream &ds, const int256 &v) {
+        ds.write((const char *) v.bits.limbs, sizeof(v.bits.limbs));
+        return ds;
+    }
+
+    /**
+     *  Deserialize an int256 from 32 little-endian two's complement bytes
+     *
+     *  @ingroup uint256
+     *  @param ds - The stream to read
+     *  @param v - The destination for deserialized value
+     *  @tparam DataStream - Type of datastream
+     *  @return DataStream& - Reference to the datastream
+     */
+    template<typename DataStream>
+    DataStream &operator>>(DataStream &ds, int256 &v) {
+        ds.read((char *) v.bits.limbs, sizeof(v.bits.limbs));
+        return ds;
+    }
+} // namespace ftl
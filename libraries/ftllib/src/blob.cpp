@@ -0,0 +1,191 @@
+#include "blob.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+/**
+ * Streams of ftl::blob_table, see blob.hpp.
+ *
+ * A stream holds one chunk in its buffer, whole chunks read or written in a single step skip it.
+ */
+namespace ftl {
+    namespace _blob_detail {
+        static const size_t header_size = sizeof(uint64_t) + sizeof(uint32_t);
+
+        static uint32_t chunk_count(uint64_t size) {
+            return uint32_t((size + blob_chunk_size - 1) / blob_chunk_size);
+        }
+
+        chunk_buffer::chunk_buffer(uint64_t table, const void *key, size_t key_size)
+                : table(table), key_size(key_size) {
+            ftl::check(key_size <= blob_max_key_size, "blob key size must be smaller than 28");
+            memcpy(this->key, key, key_size);
+        }
+
+        bool chunk_buffer::load_header() {
+            char header[header_size];
+            int loaded = internal_use_do_not_use::db_load(table, key, key_size, header, sizeof(header));
+            if (loaded < 0)
+                return false;
+            ftl::check(size_t(loaded) == sizeof(header), "blob header");
+
+            uint32_t chunk_size;
+            datastream<const char *> ds(header, sizeof(header));
+            ds >> size >> chunk_size;
+            ftl::check(chunk_size == blob_chunk_size, "blob chunk size");
+            return true;
+        }
+
+        void chunk_buffer::store_header() {
+            char header[header_size];
+            datastream<char *> ds(header, sizeof(header));
+            ds << size << blob_chunk_size;
+            internal_use_do_not_use::db_store(table, key, key_size, header, sizeof(header));
+        }
+
+        static void set_index(chunk_buffer &c, uint32_t i) {
+            for (size_t b = 0; b < sizeof(i); ++b)
+                c.key[c.key_size + b] = uint8_t(i >> (8 * (sizeof(i) - 1 - b)));
+        }
+
+        uint32_t chunk_buffer::read(uint32_t i, char *out) {
+            // a chunk is full unless it is the last one
+            uint64_t expected = std::min<uint64_t>(blob_chunk_size, size - uint64_t(i) * blob_chunk_size);
+            set_index(*this, i);
+            int loaded = internal_use_do_not_use::db_load(table | 1, key, key_size + sizeof(i), out,
+                                                           blob_chunk_size);
+            ftl::check(loaded >= 0 && uint64_t(loaded) >= expected, "blob chunk");
+            return uint32_t(expected);
+        }
+
+        void chunk_buffer::load(uint32_t i) {
+            index = i;
+            length = uint64_t(i) * blob_chunk_size < size ? read(i, buffer) : 0;
+        }
+
+        void chunk_buffer::store() {
+            set_index(*this, index);
+            internal_use_do_not_use::db_store(table | 1, key, key_size + sizeof(index), buffer, length);
+        }
+
+        void chunk_buffer::remove(uint32_t i) {
+            set_index(*this, i);
+            internal_use_do_not_use::db_remove_key(table | 1, key, key_size + sizeof(i));
+        }
+    }
+
+    datastream<blob_source>::datastream(uint64_t table, const void *key, size_t key_size, uint64_t offset)
+            : _chunks(table, key, key_size) {
+        ftl::check(_chunks.load_header(), "error get from primary key");
+        ftl::check(offset <= _chunks.size, "blob offset");
+        _chunks.pos = offset;
+    }
+
+    bool datastream<blob_source>::read(char *d, size_t s) {
+        ftl::check(s <= remaining(), "read");
+        while (s > 0) {
+            uint32_t i = uint32_t(_chunks.pos / blob_chunk_size);
+            uint32_t offset = uint32_t(_chunks.pos % blob_chunk_size);
+            size_t n = std::min<size_t>(s, blob_chunk_size - offset);
+            if (n == blob_chunk_size && i != _chunks.index) {
+                _chunks.read(i, d);
+            } else {
+                if (i != _chunks.index)
+                    _chunks.load(i);
+                ftl::check(offset + n <= _chunks.length, "blob chunk");
+                memcpy(d, _chunks.buffer + offset, n);
+            }
+            d += n;
+            s -= n;
+            _chunks.pos += n;
+        }
+        return true;
+    }
+
+    datastream<blob_sink>::datastream(uint64_t table, const void *key, size_t key_size, uint64_t offset)
+            : _chunks(table, key, key_size) {
+        _stored_size = _chunks.load_header() ? _chunks.size : uint64_t(-1);
+        _chunk_end = _blob_detail::chunk_count(_chunks.size);
+        ftl::check(offset <= _chunks.size, "blob offset");
+        _chunks.pos = offset;
+    }
+
+    void datastream<blob_sink>::store_chunk() {
+        _chunks.store();
+        _chunk_end = std::max(_chunk_end, _chunks.index + 1);
+        _dirty = false;
+    }
+
+    bool datastream<blob_sink>::write(const char *d, size_t s) {
+        ftl::check(valid(), "write");
+        while (s > 0) {
+            uint32_t i = uint32_t(_chunks.pos / blob_chunk_size);
+            uint32_t offset = uint32_t(_chunks.pos % blob_chunk_size);
+            size_t n = std::min<size_t>(s, blob_chunk_size - offset);
+            if (i != _chunks.index) {
+                if (_dirty)
+                    store_chunk();
+                if (n == blob_chunk_size) {
+                    // overwritten whole, the stored chunk is not needed
+                    _chunks.index = i;
+                    _chunks.length = 0;
+                } else {
+                    _chunks.load(i);
+                }
+            }
+            memcpy(_chunks.buffer + offset, d, n);
+            _chunks.length = std::max<uint32_t>(_chunks.length, offset + n);
+            _dirty = true;
+            d += n;
+            s -= n;
+            _chunks.pos += n;
+            _chunks.size = std::max(_chunks.size, _chunks.pos);
+        }
+        return true;
+    }
+
+    void datastream<blob_sink>::truncate() {
+        uint64_t end = _chunks.pos;
+        uint32_t last = uint32_t(end / blob_chunk_size);
+        // the chunk the blob now ends in is cut short
+        if (end % blob_chunk_size && last != _chunks.index) {
+            if (_dirty)
+                store_chunk();
+            _chunks.load(last);
+        }
+        _chunks.size = end;
+        if (_chunks.index == uint32_t(-1))
+            return;
+        uint64_t start = uint64_t(_chunks.index) * blob_chunk_size;
+        if (start >= end) {
+            _chunks.index = uint32_t(-1);
+            _dirty = false;
+        } else if (start + _chunks.length > end) {
+            _chunks.length = uint32_t(end - start);
+            _dirty = true;
+        }
+    }
+
+    void datastream<blob_sink>::flush() {
+        if (_dirty)
+            store_chunk();
+        // also the chunks this stream stored past an end it then truncated
+        uint32_t end = _blob_detail::chunk_count(_chunks.size);
+        for (uint32_t i = end; i < _chunk_end; ++i)
+            _chunks.remove(i);
+        _chunk_end = std::min(_chunk_end, end);
+        if (_chunks.size == _stored_size)
+            return;
+        _chunks.store_header();
+        _stored_size = _chunks.size;
+    }
+
+    void blob_remove(uint64_t table, const void *key, size_t key_size) {
+        _blob_detail::chunk_buffer chunks(table, key, key_size);
+        if (!chunks.load_header())
+            return;
+        for (uint32_t i = 0; i < _blob_detail::chunk_count(chunks.size); ++i)
+            chunks.remove(i);
+        internal_use_do_not_use::db_remove_key(table, key, key_size);
+    }
+}
@@ -0,0 +1,96 @@
+#include "runtime.hpp"
+
+#include <cstdlib>
+
+/**
+ * Calls through the call_action_result and multi_call imports, see FTL_CALL_RESULT in action.hpp.
+ *
+ * These are apart from runtime.cpp so a contract built without FTL_CALL_RESULT links none of them and
+ * imports neither function. Results up to max_stack_buffer_size bytes come back in a stack buffer with the
+ * call, larger ones are fetched with call_result.
+ */
+namespace ftl {
+    namespace runtime {
+
+        int call_action_result(const void *contract, size_t contract_size, uint64_t act, uint64_t amount,
+                               int storage_delegate, int user_delegate, const void *args, pack_fn pack,
+                               void *result, unpack_fn unpack) {
+            if (!unpack)
+                return call_action(contract, contract_size, act, amount, storage_delegate, user_delegate, args,
+                                   pack, result, unpack);
+
+            size_t size = sizeof(act) + pack(args, nullptr, 0);
+            void *buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
+            ftl::datastream<char *> ds((char *) buffer, size);
+            ds << act;
+            pack(args, (char *) buffer + sizeof(act), size - sizeof(act));
+
+            char result_buffer[max_stack_buffer_size];
+            size_t result_size = 0;
+            int ret = internal_use_do_not_use::call_action_result((void *) contract, contract_size, buffer, size,
+                                                                  amount, storage_delegate, user_delegate,
+                                                                  result_buffer, sizeof(result_buffer), &result_size);
+            if (max_stack_buffer_size < size) {
+                free(buffer);
+            }
+
+            if (result_size > sizeof(result_buffer)) {
+                void *large_buffer = malloc(result_size);
+                internal_use_do_not_use::call_result(large_buffer, result_size);
+                unpack(result, (const char *) large_buffer, result_size);
+                free(large_buffer);
+            } else if (result_size > 0) {
+                unpack(result, result_buffer, result_size);
+            }
+            return ret;
+        }
+
+        void pack_call(std::vector<char> &calls, const void *contract, size_t contract_size, uint64_t act,
+                       uint64_t amount, int storage_delegate, int user_delegate, const void *args, pack_fn pack) {
+            size_t action_size = sizeof(act) + pack(args, nullptr, 0);
+            datastream<size_t> ps;
+            ps << unsigned_int(contract_size);
+            ps.skip(contract_size);
+            ps << amount << uint8_t(storage_delegate) << uint8_t(user_delegate) << unsigned_int(action_size);
+            ps.skip(action_size);
+
+            size_t offset = calls.size();
+            calls.resize(offset + ps.tellp());
+            datastream<char *> ds(calls.data() + offset, ps.tellp());
+            ds << unsigned_int(contract_size);
+            ds.write((const char *) contract, contract_size);
+            ds << amount << uint8_t(storage_delegate) << uint8_t(user_delegate) << unsigned_int(action_size) << act;
+            pack(args, ds.pos(), action_size - sizeof(act));
+        }
+
+        int multi_call(const std::vector<char> &calls, call_slot *slots, size_t count) {
+            if (count == 0)
+                return 0;
+
+            char result_buffer[max_stack_buffer_size];
+            size_t size = 0;
+            int ret = internal_use_do_not_use::multi_call(count, calls.data(), calls.size(),
+                                                          result_buffer, sizeof(result_buffer), &size);
+            char *results = result_buffer;
+            if (size > sizeof(result_buffer)) {
+                results = (char *) malloc(size);
+                internal_use_do_not_use::call_result(results, size);
+            }
+
+            datastream<const char *> ds(results, size);
+            for (size_t i = 0; i < count; i++) {
+                unsigned_int result_size;
+                ds >> slots[i].status >> result_size;
+                ftl::check(result_size.value <= ds.remaining(), "malformed multi_call results");
+                if (slots[i].unpack && result_size.value > 0)
+                    slots[i].unpack(slots[i].result, ds.pos(), result_size.value);
+                ds.skip(result_size.value);
+            }
+
+            if (results != result_buffer) {
+                free(results);
+            }
+            return ret;
+        }
+    }
+}
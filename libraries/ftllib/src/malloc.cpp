@@ -7,6 +7,14 @@
 #define CURRENT_MEMORY __builtin_wasm_current_memory()
 #define GROW_MEMORY(X) __builtin_wasm_grow_memory(X)
 
+#ifdef FTL_MALLOC_PROFILE
+// ftl_malloc_prof, reports every allocation to the ftl_prof runtime of fractal-cpp --profile
+extern "C" void __ftl_prof_alloc(size_t bytes, size_t pages);
+#endif
+
+// end of the data and stack, set by wasm-ld
+extern "C" char __heap_base;
+
 namespace ftl {
     struct dsmalloc {
         inline char *align(char *ptr, uint8_t align_amt) {
@@ -20,8 +28,7 @@ namespace ftl {
         static constexpr uint32_t wasm_page_size = 64 * 1024;
 
         dsmalloc() {
-            volatile uintptr_t heap_base = 0; // linker places this at address 0
-            heap = align(*(char **) heap_base, 8);
+            heap = align(&__heap_base, 8);
             last_ptr = heap;
 
             next_page = CURRENT_MEMORY;
@@ -32,15 +39,21 @@ namespace ftl {
                 return NULL;
 
             char *ret = last_ptr;
+            ftl::check(sz <= (size_t) -1 - (size_t) last_ptr - align_amt, "failed to allocate pages");
             last_ptr = align(last_ptr + sz, align_amt);
 
-            size_t pages_to_alloc = sz >> 16;
-            next_page += pages_to_alloc;
-            if ((next_page << 16) <= (size_t) last_ptr) {
-                next_page++;
-                pages_to_alloc++;
+            // the initial memory of fractal-ld --heap-reserve usually covers the heap, its end is 4 GiB at
+            // 65536 pages, past a 32 bit size_t
+            size_t pages_to_alloc = 0;
+            uint64_t memory_end = uint64_t(next_page) << 16;
+            if ((size_t) last_ptr > memory_end) {
+                pages_to_alloc = ((size_t) last_ptr - memory_end + wasm_page_size - 1) >> 16;
+                ftl::check(GROW_MEMORY(pages_to_alloc) != -1, "failed to allocate pages");
+                next_page += pages_to_alloc;
             }
-            ftl::check(GROW_MEMORY(pages_to_alloc) != -1, "failed to allocate pages");
+#ifdef FTL_MALLOC_PROFILE
+            __ftl_prof_alloc(sz, pages_to_alloc);
+#endif
             return ret;
         }
 
@@ -0,0 +1,251 @@
+#include "check.hpp"
+
+#include <cstdlib>
+
+/**
+ * Runtime of contracts built with fractal-cpp --profile.
+ *
+ * Every instrumented object registers its counter array from a constructor, apply flushes them
+ * before returning as a "ftl_prof" log whose data is
+ *
+ *   "FPRF" version(u8), then for each module: id(u64) count(u32) and count (index(u32), value(u64))
+ *
+ * little endian, only counters that are not zero are written. Counters are reset after the flush so
+ * a reused instance reports each call on its own. fractal-prof maps them back with the .prof file
+ * fractal-ld writes next to the contract.
+ *
+ * ftl_malloc_prof reports every allocation to __ftl_prof_alloc, which groups them by allocation site
+ * and shadow stack (both counter addresses, see the pass) and flushes a second log:
+ *
+ *   "FPRA" version(u8), pages(u32) allocations(u64) bytes(u64) grows(u32) grown(u32) dropped(u64),
+ *   modules(u32) and an id(u64) each, contexts(u32) and for each: allocations(u64) bytes(u64)
+ *   grown(u32) site frames(u32) truncated(u8) and frames times a frame
+ *
+ * where site and frames are (module(u32), index(u32)) pairs, module indexing the module ids and
+ * 0xffffffff for allocations made outside instrumented code.
+ */
+extern "C" {
+struct __ftl_prof_module {
+    uint64_t id;
+    uint64_t *counters;
+    uint32_t count;
+    __ftl_prof_module *next;
+};
+
+static __ftl_prof_module *__ftl_prof_modules = nullptr;
+
+// set by the instrumented allocation calls, consumed by the next allocation
+uint64_t *__ftl_prof_site = nullptr;
+
+static constexpr uint32_t __ftl_prof_max_depth = 32;
+static constexpr uint32_t __ftl_prof_max_contexts = 128;
+
+static uint64_t *__ftl_prof_stack[__ftl_prof_max_depth];
+static uint32_t __ftl_prof_depth = 0;
+
+struct __ftl_prof_context {
+    uint32_t hash;
+    uint64_t allocations;
+    uint64_t bytes;
+    uint32_t grown;
+    uint64_t *site;
+    uint32_t depth;
+    uint64_t *frames[__ftl_prof_max_depth];
+};
+
+static __ftl_prof_context __ftl_prof_contexts[__ftl_prof_max_contexts];
+static uint32_t __ftl_prof_used = 0;
+static uint64_t __ftl_prof_allocations = 0;
+static uint64_t __ftl_prof_bytes = 0;
+static uint32_t __ftl_prof_grows = 0;
+static uint32_t __ftl_prof_grown = 0;
+static uint64_t __ftl_prof_dropped = 0;
+static bool __ftl_prof_flushing = false;
+
+void __ftl_prof_register(__ftl_prof_module *mod) {
+    // constructors run again on every apply
+    for (auto m = __ftl_prof_modules; m; m = m->next) {
+        if (m == mod)
+            return;
+    }
+    mod->next = __ftl_prof_modules;
+    __ftl_prof_modules = mod;
+}
+
+void __ftl_prof_enter(uint64_t *frame) {
+    if (__ftl_prof_depth < __ftl_prof_max_depth)
+        __ftl_prof_stack[__ftl_prof_depth] = frame;
+    __ftl_prof_depth++;
+}
+
+void __ftl_prof_leave() {
+    if (__ftl_prof_depth)
+        __ftl_prof_depth--;
+}
+
+void __ftl_prof_alloc(size_t bytes, size_t pages) {
+    uint64_t *site = __ftl_prof_site;
+    __ftl_prof_site = nullptr;
+    if (__ftl_prof_flushing)
+        return;
+
+    __ftl_prof_allocations++;
+    __ftl_prof_bytes += bytes;
+    if (pages) {
+        __ftl_prof_grows++;
+        __ftl_prof_grown += pages;
+    }
+
+    uint32_t depth = __ftl_prof_depth < __ftl_prof_max_depth ? __ftl_prof_depth : __ftl_prof_max_depth;
+    uint32_t hash = 2166136261u ^ (uint32_t) (uintptr_t) site;
+    for (uint32_t i = 0; i < depth; i++)
+        hash = (hash ^ (uint32_t) (uintptr_t) __ftl_prof_stack[i]) * 16777619u;
+
+    // open addressing, the table is never rehashed
+    for (uint32_t n = 0; n < __ftl_prof_max_contexts; n++) {
+        auto &c = __ftl_prof_contexts[(hash + n) % __ftl_prof_max_contexts];
+        if (!c.allocations) {
+            // a slot flushed before still holds the sums of its last context
+            c.hash = hash;
+            c.bytes = 0;
+            c.grown = 0;
+            c.site = site;
+            c.depth = __ftl_prof_depth;
+            memcpy(c.frames, __ftl_prof_stack, depth * sizeof(uint64_t *));
+            __ftl_prof_used++;
+        } else if (c.hash != hash || c.site != site || c.depth != __ftl_prof_depth ||
+                   memcmp(c.frames, __ftl_prof_stack, depth * sizeof(uint64_t *)) != 0) {
+            continue;
+        }
+        c.allocations++;
+        c.bytes += bytes;
+        c.grown += pages;
+        return;
+    }
+    __ftl_prof_dropped++;
+}
+
+static uint32_t __ftl_prof_module_count() {
+    uint32_t n = 0;
+    for (auto m = __ftl_prof_modules; m; m = m->next)
+        n++;
+    return n;
+}
+
+// writes the (module, index) pair of a counter address
+static char *__ftl_prof_frame(char *p, uint64_t *counter) {
+    uint32_t mod = 0, index = 0xffffffff;
+    for (auto m = __ftl_prof_modules; m; m = m->next, mod++) {
+        if (counter >= m->counters && counter < m->counters + m->count) {
+            index = counter - m->counters;
+            break;
+        }
+    }
+    if (index == 0xffffffff)
+        mod = 0xffffffff;
+    memcpy(p, &mod, 4);
+    memcpy(p + 4, &index, 4);
+    return p + 8;
+}
+
+static void __ftl_prof_log(const char *buffer, size_t size) {
+    // the topic ftl::log uses for the name "ftl_prof"
+    ftl::checksum256 topic;
+    ftl::internal_use_do_not_use::sha256("\x08" "ftl_prof", 9, &topic);
+    ftl::internal_use_do_not_use::log_0(buffer, size, &topic);
+}
+
+static void __ftl_prof_flush_alloc() {
+    if (!__ftl_prof_allocations)
+        return;
+    uint32_t pages = __builtin_wasm_current_memory();
+    uint32_t modules = __ftl_prof_module_count();
+    size_t size = 5 + 32 + 4 + modules * 8 + 4;
+    for (uint32_t i = 0; i < __ftl_prof_max_contexts; i++) {
+        const auto &c = __ftl_prof_contexts[i];
+        if (c.allocations)
+            size += 20 + 8 + 5 + 8 * (c.depth < __ftl_prof_max_depth ? c.depth : __ftl_prof_max_depth);
+    }
+
+    char *buffer = (char *) malloc(size);
+    char *p = buffer;
+    memcpy(p, "FPRA\1", 5);
+    memcpy(p + 5, &pages, 4);
+    memcpy(p + 9, &__ftl_prof_allocations, 8);
+    memcpy(p + 17, &__ftl_prof_bytes, 8);
+    memcpy(p + 25, &__ftl_prof_grows, 4);
+    memcpy(p + 29, &__ftl_prof_grown, 4);
+    memcpy(p + 33, &__ftl_prof_dropped, 8);
+    memcpy(p + 41, &modules, 4);
+    p += 45;
+    for (auto m = __ftl_prof_modules; m; m = m->next, p += 8)
+        memcpy(p, &m->id, 8);
+    memcpy(p, &__ftl_prof_used, 4);
+    p += 4;
+    for (uint32_t i = 0; i < __ftl_prof_max_contexts; i++) {
+        auto &c = __ftl_prof_contexts[i];
+        if (!c.allocations)
+            continue;
+        uint32_t depth = c.depth < __ftl_prof_max_depth ? c.depth : __ftl_prof_max_depth;
+        uint8_t truncated = c.depth > depth;
+        memcpy(p, &c.allocations, 8);
+        memcpy(p + 8, &c.bytes, 8);
+        memcpy(p + 16, &c.grown, 4);
+        p = __ftl_prof_frame(p + 20, c.site);
+        memcpy(p, &depth, 4);
+        memcpy(p + 4, &truncated, 1);
+        p += 5;
+        for (uint32_t d = 0; d < depth; d++)
+            p = __ftl_prof_frame(p, c.frames[d]);
+        c.allocations = 0;
+    }
+
+    __ftl_prof_log(buffer, size);
+    free(buffer);
+    __ftl_prof_used = 0;
+    __ftl_prof_allocations = 0;
+    __ftl_prof_bytes = 0;
+    __ftl_prof_grows = 0;
+    __ftl_prof_grown = 0;
+    __ftl_prof_dropped = 0;
+}
+
+void __ftl_prof_flush() {
+    // the buffers below are not part of the profile
+    __ftl_prof_flushing = true;
+    __ftl_prof_flush_alloc();
+
+    size_t size = 5;
+    for (auto m = __ftl_prof_modules; m; m = m->next) {
+        size += 12;
+        for (uint32_t i = 0; i < m->count; i++)
+            size += m->counters[i] ? 12 : 0;
+    }
+
+    char *buffer = (char *) malloc(size);
+    char *p = buffer;
+    memcpy(p, "FPRF\1", 5);
+    p += 5;
+    for (auto m = __ftl_prof_modules; m; m = m->next) {
+        memcpy(p, &m->id, 8);
+        char *count = p + 8;
+        p += 12;
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < m->count; i++) {
+            if (!m->counters[i])
+                continue;
+            memcpy(p, &i, 4);
+            memcpy(p + 4, &m->counters[i], 8);
+            p += 12;
+            m->counters[i] = 0;
+            n++;
+        }
+        memcpy(count, &n, 4);
+    }
+
+    __ftl_prof_log(buffer, size);
+    free(buffer);
+    __ftl_prof_depth = 0;
+    __ftl_prof_flushing = false;
+}
+}
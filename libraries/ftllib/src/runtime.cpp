@@ -0,0 +1,105 @@
+#include "runtime.hpp"
+
+#include <cstdlib>
+
+/**
+ * Non-template core of execute_action, ftl::table and ftl::action, see runtime.hpp.
+ *
+ * Buffers up to max_stack_buffer_size bytes live on the stack, larger ones are allocated and freed
+ * before returning. Using malloc/free here potentially is not exception-safe, although WASM doesn't
+ * support exceptions.
+ */
+namespace ftl {
+    namespace runtime {
+
+        void unpack_bytes(void *value, const char *buffer, size_t size) {
+            static_cast<std::vector<char> *>(value)->assign(buffer, buffer + size);
+        }
+
+        void read_action(void *args, unpack_fn unpack) {
+            size_t size = internal_use_do_not_use::action_data_size();
+            void *buffer = nullptr;
+            if (size > 0) {
+                buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
+                internal_use_do_not_use::read_action_data(buffer, size);
+            }
+
+            unpack(args, (const char *) buffer, size);
+
+            if (max_stack_buffer_size < size) {
+                free(buffer);
+            }
+        }
+
+        void set_result(const void *result, pack_fn pack) {
+            size_t size = pack(result, nullptr, 0);
+            if (size == 0)
+                return;
+
+            void *buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
+            pack(result, (char *) buffer, size);
+            internal_use_do_not_use::set_result(buffer, size);
+
+            if (max_stack_buffer_size < size) {
+                free(buffer);
+            }
+        }
+
+        void table_store(uint64_t table, const void *key, size_t key_size, const void *value, pack_fn pack) {
+            size_t size = pack(value, nullptr, 0);
+            void *buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
+            pack(value, (char *) buffer, size);
+
+            internal_use_do_not_use::db_store(table, key, key_size, buffer, size);
+
+            if (max_stack_buffer_size < size) {
+                free(buffer);
+            }
+        }
+
+        void table_load(uint64_t table, const void *key, size_t key_size, void *value, unpack_fn unpack) {
+            int loaded = internal_use_do_not_use::db_load(table, key, key_size, nullptr, 0);
+            ftl::check(loaded >= 0, "error get from primary key");
+
+            size_t size = size_t(loaded);
+            void *buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
+            internal_use_do_not_use::db_load(table, key, key_size, buffer, size);
+
+            unpack(value, (const char *) buffer, size);
+
+            if (max_stack_buffer_size < size) {
+                free(buffer);
+            }
+        }
+
+        int call_action(const void *contract, size_t contract_size, uint64_t act, uint64_t amount,
+                        int storage_delegate, int user_delegate, const void *args, pack_fn pack,
+                        void *result, unpack_fn unpack) {
+            size_t size = sizeof(act) + pack(args, nullptr, 0);
+            void *buffer = max_stack_buffer_size < size ? malloc(size) : alloca(size);
+            ftl::datastream<char *> ds((char *) buffer, size);
+            ds << act;
+            pack(args, (char *) buffer + sizeof(act), size - sizeof(act));
+
+            int ret = internal_use_do_not_use::call_action((void *) contract, contract_size, buffer, size, amount,
+                                                           storage_delegate, user_delegate);
+            if (max_stack_buffer_size < size) {
+                free(buffer);
+            }
+
+            if (!unpack)
+                return ret;
+            size_t result_size = internal_use_do_not_use::call_result(nullptr, 0);
+            if (result_size > 0) {
+                void *result_buffer = max_stack_buffer_size < result_size ? malloc(result_size) : alloca(result_size);
+                internal_use_do_not_use::call_result(result_buffer, result_size);
+                unpack(result, (const char *) result_buffer, result_size);
+
+                if (max_stack_buffer_size < result_size) {
+                    free(result_buffer);
+                }
+            }
+            return ret;
+        }
+    }
+}
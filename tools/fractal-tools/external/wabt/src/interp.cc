@@ -1443,6 +1443,7 @@ Result Thread::Run(int num_instructions) {
   for (int i = 0; i < num_instructions; ++i) {
     Opcode opcode = ReadOpcode(&pc);
     assert(!opcode.IsInvalid());
+    ++instruction_count_;
     switch (opcode) {
       case Opcode::Select: {
         uint32_t cond = Pop<uint32_t>();
@@ -494,6 +494,9 @@ class Thread {
 
   Result CallHost(HostFunc*);
 
+  // Number of istream instructions run by this thread, never reset.
+  uint64_t instruction_count() const { return instruction_count_; }
+
  private:
   const uint8_t* GetIstream() const { return env_->istream_->data.data(); }
 
@@ -568,6 +571,7 @@ class Thread {
   uint32_t value_stack_top_ = 0;
   uint32_t call_stack_top_ = 0;
   IstreamOffset pc_ = 0;
+  uint64_t instruction_count_ = 0;
 };
 
 struct ExecResult {
@@ -593,6 +597,8 @@ class Executor {
                              string_view name,
                              const TypedValues& args);
 
+  uint64_t instruction_count() const { return thread_.instruction_count(); }
+
  private:
   Result RunDefinedFunction(IstreamOffset function_offset);
   Result PushArgs(const FuncSignature*, const TypedValues& args);
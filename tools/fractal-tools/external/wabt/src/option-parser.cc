@@ -186,8 +186,10 @@ void OptionParser::Parse(int argc, char* argv[]) {
         const Option& best_option = options_[best_index];
         const char* option_argument = nullptr;
         if (best_option.has_argument) {
-          if (arg[best_length] == '=') {
-            option_argument = &arg[best_length + 1];
+          // best_length counts from after "--" and is one past the name on a
+          // full match, where the argument comes separately
+          if (arg[best_length + 1] != '\0' && arg[best_length + 2] == '=') {
+            option_argument = &arg[best_length + 3];
           } else {
             if (i + 1 == argc || argv[i + 1][0] == '-') {
               Errorf("option '--%s' requires argument",
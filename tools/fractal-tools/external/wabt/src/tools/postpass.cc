@@ -19,6 +19,8 @@
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <set>
 
 #include "src/apply-names.h"
 #include "src/binary-reader.h"
@@ -43,9 +45,27 @@ static std::string s_outfile;
 static Features s_features;
 static WriteBinaryOptions s_write_binary_options;
 static std::unique_ptr<FileStream> s_log_stream;
+static std::string s_stack_check = "none";
+static bool s_stack_report;
+static std::string s_name_map;
+static bool s_fold_functions = true;
+static bool s_fold_all = false;
+static bool s_strip_unused = true;
+static uint32_t s_zero_run = 16;
+static int64_t s_heap_reserve = -1;
+static bool s_memory_report;
+
+// ftllib bounds its dynamic allocas by ftl::max_stack_buffer_size, the size of those elsewhere isn't known
+static const uint32_t kDynamicAllocaBound = 512;
+
+// approximate encoding size of a data segment besides its bytes
+static const uint32_t kDataSegmentOverhead = 8;
+
+static const uint64_t kPageSize = 64 * 1024;
 
 static const char s_description[] =
-R"(  Read a file in the WebAssembly binary format, strip bss or any data segment that is only initialized to zeros, and other post processing.
+R"(  Read a file in the WebAssembly binary format, strip bss or any data segment that is only initialized to zeros, and other post processing:
+  split data segments around runs of zeros and coalesce close ones, fold functions with identical bodies and remove unused types and globals.
 
   $ fractal-pp test.wasm -o test.stripped.wasm
 
@@ -61,6 +81,59 @@ static void ParseOptions(int argc, char** argv) {
     s_log_stream = FileStream::CreateStdout();
   });
   parser.AddHelpOption();
+  parser.AddOption(
+      0, "stack-check", "error|warn|none",
+      "Check the worst-case stack usage of every exported function against the "
+      "stack size, and fail or warn when it may overflow",
+      [](const char* argument) {
+        s_stack_check = argument;
+        if (s_stack_check != "error" && s_stack_check != "warn" &&
+            s_stack_check != "none") {
+          fprintf(stderr, "invalid --stack-check value '%s'\n", argument);
+          exit(1);
+        }
+      });
+  parser.AddOption("stack-report",
+                   "Print the worst-case stack usage of every exported function",
+                   []() { s_stack_report = true; });
+  parser.AddOption("debug-names",
+                   "Keep the function names of the name section (fractal-ld --profile)",
+                   []() { s_write_binary_options.write_debug_names = true; });
+  parser.AddOption(0, "name-map", "FILE",
+                   "Write the function names to FILE, one \"<index>\\t<name>\" line each, for fractal-size",
+                   [](const char* argument) {
+                     s_name_map = argument;
+                   });
+  parser.AddOption("no-fold-functions",
+                   "Keep functions with identical bodies",
+                   []() { s_fold_functions = false; });
+  parser.AddOption("fold-all",
+                   "Also fold exported functions and those in the table, they then share one address",
+                   []() { s_fold_all = true; });
+  parser.AddOption("keep-unused",
+                   "Keep types and globals nothing refers to",
+                   []() { s_strip_unused = false; });
+  parser.AddOption(0, "zero-run", "BYTES",
+                   "Split data segments around runs of at least BYTES zeros (default 16, 0 to keep them whole)",
+                   [](const char* argument) {
+                     s_zero_run = atoi(argument);
+                     if (s_zero_run && s_zero_run < kDataSegmentOverhead) {
+                       fprintf(stderr, "--zero-run below %u bytes makes the module larger\n", kDataSegmentOverhead);
+                       exit(1);
+                     }
+                   });
+  parser.AddOption(0, "heap-reserve", "BYTES",
+                   "Size the memory for the data, the stack and BYTES of heap, and don't let it grow beyond",
+                   [](const char* argument) {
+                     s_heap_reserve = strtoll(argument, nullptr, 0);
+                     if (s_heap_reserve < 0) {
+                       fprintf(stderr, "invalid --heap-reserve value '%s'\n", argument);
+                       exit(1);
+                     }
+                   });
+  parser.AddOption("memory-report",
+                   "Print the memory, data, table and globals the contract is instantiated with",
+                   []() { s_memory_report = true; });
   parser.AddOption(
       'o', "output", "FILENAME",
       "Output file for the generated wast file, by default use stdout",
@@ -76,18 +149,21 @@ static void ParseOptions(int argc, char** argv) {
   parser.Parse(argc, argv);
 }
 
-uint32_t GetHeapPtr( Module& mod, const std::vector<uint8_t>& buff ) {
-   size_t offset = mod.GetGlobal(Var(1))->init_expr.begin()->loc.offset;
-   uint32_t heap_ptr;
-   ReadS32Leb128(buff.data()+offset+4, buff.data()+offset+9, &heap_ptr);
-   return heap_ptr;
+// wasm-ld exports the addresses of __heap_base and __data_end as immutable globals
+bool GetExportedAddress( const Module& mod, string_view name, uint32_t& out ) {
+   const Export* exp = mod.GetExport(name);
+   if ( !exp || exp->kind != ExternalKind::Global )
+      return false;
+   const Global* global = mod.GetGlobal(exp->var);
+   if ( !global || global->init_expr.size() != 1 || global->init_expr.front().type() != ExprType::Const )
+      return false;
+   out = static_cast<const ConstExpr&>(global->init_expr.front()).const_.u32;
+   return true;
 }
 
-uint32_t GetStackPtr( Module& mod, const std::vector<uint8_t>& buff ) {
-   size_t offset = mod.GetGlobal(Var(0))->init_expr.begin()->loc.offset;
-   uint32_t stack_ptr;
-   ReadS32Leb128(buff.data()+offset+4, buff.data()+offset+9, &stack_ptr);
-   return stack_ptr;
+uint32_t GetStackPtr( const Module& mod ) {
+   const Expr& init = *mod.GetGlobal(Var(0))->init_expr.begin();
+   return static_cast<const ConstExpr&>(init).const_.u32;
 }
 
 void StripZeroedData( Module& mod, size_t& fix_bytes ) {
@@ -106,24 +182,586 @@ void StripZeroedData( Module& mod, size_t& fix_bytes ) {
    mod.data_segments = ds;
 }
 
-void AddHeapPointerData( Module& mod, size_t fixup, const std::vector<uint8_t>& buff, DataSegment& ds ) {
-   uint32_t heap_ptr  = ((GetHeapPtr(mod, buff)) + 7) & ~7; // align to 8 bytes
-   Const c;
-   c.I32(0);
-   std::unique_ptr<Expr> ce(new ConstExpr(c));
-   ds.memory_var = Var(0);
-   ds.offset = ExprList{std::move(ce)};
-   uint8_t* dat = reinterpret_cast<uint8_t*>(&heap_ptr);
-   ds.data = std::vector<uint8_t>{dat[0],
-                                   dat[1], 
-                                   dat[2], 
-                                   dat[3]};
-   mod.data_segments.push_back(&ds);
+bool GetConstOffset( const ExprList& offset, uint32_t& out ) {
+   if ( offset.size() != 1 || offset.front().type() != ExprType::Const )
+      return false;
+   const Const& c = static_cast<const ConstExpr&>(offset.front()).const_;
+   if ( c.type != Type::I32 )
+      return false;
+   out = c.u32;
+   return true;
 }
 
+DataSegment* NewDataSegment( uint32_t offset, const uint8_t* begin, const uint8_t* end,
+                             std::vector<std::unique_ptr<DataSegment>>& storage ) {
+   Const c = Const::I32(offset);
+   storage.emplace_back(new DataSegment);
+   DataSegment* ds = storage.back().get();
+   ds->memory_var = Var(0);
+   ds->offset.push_back(MakeUnique<ConstExpr>(c));
+   ds->data.assign(begin, end);
+   return ds;
+}
+
+// Memory starts zeroed, so the zeros at both ends of a segment and long runs of zeros inside it
+// don't need to be initialized. Segments close enough to share one header are merged first.
+// Modules whose segments aren't all disjoint constant ranges are left as they are, the order of the
+// segments decides which bytes win there.
+void CompactDataSegments( Module& mod, std::vector<std::unique_ptr<DataSegment>>& storage ) {
+   std::map<uint32_t, std::vector<uint8_t>> ranges;
+   for ( DataSegment* ds : mod.data_segments ) {
+      uint32_t offset;
+      if ( !GetConstOffset(ds->offset, offset) || mod.GetMemoryIndex(ds->memory_var) != 0 ||
+           !ranges.emplace(offset, ds->data).second )
+         return;
+   }
+   uint64_t previous_end = 0;
+   for ( const auto& range : ranges ) {
+      if ( range.first < previous_end )
+         return;
+      previous_end = uint64_t(range.first) + range.second.size();
+   }
+
+   for ( auto it = ranges.begin(); it != ranges.end(); ) {
+      auto next = std::next(it);
+      if ( next == ranges.end() )
+         break;
+      uint64_t end = uint64_t(it->first) + it->second.size();
+      if ( next->first - end > kDataSegmentOverhead ) {
+         it = next;
+         continue;
+      }
+      it->second.resize(next->first - it->first, 0);
+      it->second.insert(it->second.end(), next->second.begin(), next->second.end());
+      ranges.erase(next);
+   }
+
+   std::vector<DataSegment*> result;
+   for ( const auto& range : ranges ) {
+      const uint8_t* data = range.second.data();
+      size_t size = range.second.size();
+      size_t begin = 0;
+      while ( begin < size ) {
+         while ( begin < size && !data[begin] )
+            begin++;
+         if ( begin == size )
+            break;
+         // the piece ends before the first run of zeros that is long enough, or at the last non zero
+         size_t end = begin, zeros = 0, last = begin;
+         for ( ; end < size; end++ ) {
+            if ( data[end] ) {
+               zeros = 0;
+               last = end;
+            } else if ( ++zeros >= s_zero_run && s_zero_run ) {
+               break;
+            }
+         }
+         result.push_back(NewDataSegment(range.first + begin, data + begin, data + last + 1, storage));
+         begin = last + 1;
+      }
+   }
+   mod.data_segments = result;
+}
+
+
 void construct_apply( Module& mod ) {
 }
 
+template <typename F>
+void VisitExprs( ExprList& exprs, F&& fn ) {
+   for ( Expr& expr : exprs ) {
+      fn(expr);
+      switch ( expr.type() ) {
+         case ExprType::Block:
+            VisitExprs(static_cast<BlockExpr*>(&expr)->block.exprs, fn);
+            break;
+         case ExprType::Loop:
+            VisitExprs(static_cast<LoopExpr*>(&expr)->block.exprs, fn);
+            break;
+         case ExprType::If:
+            VisitExprs(static_cast<IfExpr*>(&expr)->true_.exprs, fn);
+            VisitExprs(static_cast<IfExpr*>(&expr)->false_, fn);
+            break;
+         case ExprType::IfExcept:
+            VisitExprs(static_cast<IfExceptExpr*>(&expr)->true_.exprs, fn);
+            VisitExprs(static_cast<IfExceptExpr*>(&expr)->false_, fn);
+            break;
+         case ExprType::Try:
+            VisitExprs(static_cast<TryExpr*>(&expr)->block.exprs, fn);
+            VisitExprs(static_cast<TryExpr*>(&expr)->catch_, fn);
+            break;
+         default:
+            break;
+      }
+   }
+}
+
+// every expression of the module, function bodies and initializers
+template <typename F>
+void VisitModuleExprs( Module& mod, F&& fn ) {
+   for ( Index i = mod.num_func_imports; i < mod.funcs.size(); i++ )
+      VisitExprs(mod.funcs[i]->exprs, fn);
+   for ( Global* global : mod.globals )
+      VisitExprs(global->init_expr, fn);
+   for ( DataSegment* ds : mod.data_segments )
+      VisitExprs(ds->offset, fn);
+   for ( ElemSegment* es : mod.elem_segments )
+      VisitExprs(es->offset, fn);
+}
+
+// Code section entries of the defined functions, locals and body as the binary writer encodes them
+bool GetFunctionBodies( const Module& mod, std::vector<std::vector<uint8_t>>& bodies ) {
+   MemoryStream stream;
+   WriteBinaryOptions options;
+   if ( Failed(WriteBinaryModule(&stream, &mod, &options)) )
+      return false;
+   const std::vector<uint8_t>& data = stream.output_buffer().data;
+   const uint8_t* p = data.data() + 8;
+   const uint8_t* end = data.data() + data.size();
+   while ( p < end ) {
+      uint8_t id = *p++;
+      uint32_t size;
+      p += ReadU32Leb128(p, end, &size);
+      if ( id != static_cast<uint8_t>(BinarySection::Code) ) {
+         p += size;
+         continue;
+      }
+      uint32_t count;
+      p += ReadU32Leb128(p, end, &count);
+      for ( uint32_t i = 0; i < count; i++ ) {
+         uint32_t body_size;
+         p += ReadU32Leb128(p, end, &body_size);
+         bodies.emplace_back(p, p + body_size);
+         p += body_size;
+      }
+      break;
+   }
+   return bodies.size() == mod.funcs.size() - mod.num_func_imports;
+}
+
+// Removes the defined functions that map to another one, remap[i] is the function that replaces i
+void RemapFunctions( Module& mod, const std::vector<Index>& remap ) {
+   std::vector<Index> index(mod.funcs.size());
+   std::vector<Func*> funcs;
+   for ( Index i = 0; i < mod.funcs.size(); i++ ) {
+      if ( remap[i] == i ) {
+         index[i] = funcs.size();
+         funcs.push_back(mod.funcs[i]);
+      }
+   }
+   auto update = [&]( Var& var ) { var = Var(index[remap[mod.GetFuncIndex(var)]], var.loc); };
+
+   VisitModuleExprs(mod, [&]( Expr& expr ) {
+      if ( expr.type() == ExprType::Call )
+         update(static_cast<CallExpr*>(&expr)->var);
+   });
+   for ( ElemSegment* es : mod.elem_segments )
+      for ( Var& var : es->vars )
+         update(var);
+   for ( Export* exp : mod.exports )
+      if ( exp->kind == ExternalKind::Func )
+         update(exp->var);
+   for ( Var* start : mod.starts )
+      update(*start);
+   mod.funcs = funcs;
+}
+
+// Functions whose index the contract can observe, in the table (their address) or exported
+std::vector<bool> GetAddressTakenFunctions( const Module& mod ) {
+   std::vector<bool> taken(mod.funcs.size());
+   for ( const ElemSegment* es : mod.elem_segments )
+      for ( const Var& var : es->vars )
+         taken[mod.GetFuncIndex(var)] = true;
+   for ( const Export* exp : mod.exports )
+      if ( exp->kind == ExternalKind::Func )
+         taken[mod.GetFuncIndex(exp->var)] = true;
+   return taken;
+}
+
+// Folds functions whose type and encoded body are the same into the first of them, callers, the table
+// and exports use that one. Folding can make more bodies identical, e.g. wrappers of folded functions.
+// Unless fold_all, functions in the table or exported are kept so distinct function pointers stay
+// distinct, others can still fold into them.
+size_t FoldIdenticalFunctions( Module& mod, bool fold_all ) {
+   size_t folded = 0;
+   for ( ;; ) {
+      std::vector<std::vector<uint8_t>> bodies;
+      if ( !GetFunctionBodies(mod, bodies) )
+         return folded;
+      std::vector<bool> taken = GetAddressTakenFunctions(mod);
+
+      std::vector<Index> remap(mod.funcs.size());
+      std::map<std::pair<Index, std::vector<uint8_t>>, Index> first;
+      size_t round = 0;
+      for ( Index i = 0; i < mod.funcs.size(); i++ ) {
+         remap[i] = i;
+         if ( i < mod.num_func_imports )
+            continue;
+         auto key = std::make_pair(mod.GetFuncTypeIndex(mod.funcs[i]->decl),
+                                   std::move(bodies[i - mod.num_func_imports]));
+         auto it = first.emplace(std::move(key), i);
+         if ( !it.second && (fold_all || !taken[i]) ) {
+            remap[i] = it.first->second;
+            round++;
+         }
+      }
+      if ( !round )
+         return folded;
+      RemapFunctions(mod, remap);
+      folded += round;
+   }
+}
+
+// Removes the function types and the defined globals nothing refers to
+void RemoveUnusedTypesAndGlobals( Module& mod, size_t& types, size_t& globals ) {
+   std::vector<bool> type_used(mod.func_types.size());
+   std::vector<bool> global_used(mod.globals.size());
+   for ( Index i = 0; i < mod.num_global_imports; i++ )
+      global_used[i] = true;
+
+   auto is_inline = []( const BlockDeclaration& decl ) {
+      return decl.sig.GetNumParams() == 0 && decl.sig.GetNumResults() <= 1;
+   };
+   auto block_decl = []( Expr& expr ) -> BlockDeclaration* {
+      switch ( expr.type() ) {
+         case ExprType::Block:    return &static_cast<BlockExpr*>(&expr)->block.decl;
+         case ExprType::Loop:     return &static_cast<LoopExpr*>(&expr)->block.decl;
+         case ExprType::If:       return &static_cast<IfExpr*>(&expr)->true_.decl;
+         case ExprType::IfExcept: return &static_cast<IfExceptExpr*>(&expr)->true_.decl;
+         case ExprType::Try:      return &static_cast<TryExpr*>(&expr)->block.decl;
+         default:                 return nullptr;
+      }
+   };
+   auto global_var = []( Expr& expr ) -> Var* {
+      if ( expr.type() == ExprType::GetGlobal )
+         return &static_cast<GetGlobalExpr*>(&expr)->var;
+      if ( expr.type() == ExprType::SetGlobal )
+         return &static_cast<SetGlobalExpr*>(&expr)->var;
+      return nullptr;
+   };
+   auto use_type = [&]( const FuncDeclaration& decl ) {
+      Index index = mod.GetFuncTypeIndex(decl);
+      if ( index < type_used.size() )
+         type_used[index] = true;
+   };
+
+   for ( Func* func : mod.funcs )
+      use_type(func->decl);
+   VisitModuleExprs(mod, [&]( Expr& expr ) {
+      if ( expr.type() == ExprType::CallIndirect )
+         use_type(static_cast<CallIndirectExpr*>(&expr)->decl);
+      else if ( BlockDeclaration* decl = block_decl(expr) ) {
+         if ( !is_inline(*decl) )
+            use_type(*decl);
+      } else if ( Var* var = global_var(expr) )
+         global_used[mod.GetGlobalIndex(*var)] = true;
+   });
+   for ( Export* exp : mod.exports )
+      if ( exp->kind == ExternalKind::Global )
+         global_used[mod.GetGlobalIndex(exp->var)] = true;
+
+   std::vector<Index> type_index(mod.func_types.size()), global_index(mod.globals.size());
+   std::vector<FuncType*> func_types;
+   std::vector<Global*> defined_globals;
+   for ( Index i = 0; i < mod.func_types.size(); i++ ) {
+      type_index[i] = func_types.size();
+      if ( type_used[i] )
+         func_types.push_back(mod.func_types[i]);
+   }
+   for ( Index i = 0; i < mod.globals.size(); i++ ) {
+      global_index[i] = defined_globals.size();
+      if ( global_used[i] )
+         defined_globals.push_back(mod.globals[i]);
+   }
+   types = mod.func_types.size() - func_types.size();
+   globals = mod.globals.size() - defined_globals.size();
+   if ( !types && !globals )
+      return;
+
+   // the type of every declaration is referred to by index from here on
+   auto update_type = [&]( FuncDeclaration& decl ) {
+      Index index = mod.GetFuncTypeIndex(decl);
+      if ( index >= type_index.size() )
+         return;
+      decl.has_func_type = true;
+      decl.type_var = Var(type_index[index], decl.type_var.loc);
+   };
+   auto update_global = [&]( Var& var ) { var = Var(global_index[mod.GetGlobalIndex(var)], var.loc); };
+
+   for ( Func* func : mod.funcs )
+      update_type(func->decl);
+   VisitModuleExprs(mod, [&]( Expr& expr ) {
+      if ( expr.type() == ExprType::CallIndirect )
+         update_type(static_cast<CallIndirectExpr*>(&expr)->decl);
+      else if ( BlockDeclaration* decl = block_decl(expr) ) {
+         if ( !is_inline(*decl) )
+            update_type(*decl);
+      } else if ( Var* var = global_var(expr) )
+         update_global(*var);
+   });
+   for ( Export* exp : mod.exports )
+      if ( exp->kind == ExternalKind::Global )
+         update_global(exp->var);
+   mod.func_types = func_types;
+   mod.globals = defined_globals;
+}
+
+struct StackFrame {
+   uint32_t size = 0;
+   uint32_t dynamic_allocas = 0;
+   bool ftllib = false;       // the function is part of ftllib, its dynamic allocas are bounded
+   std::set<Index> callees;
+};
+
+// Whether the function is in the ftl namespace, by its name in the name section, either mangled or
+// demangled with or without a return type. Without a name section no function is.
+bool IsFtllibFunction( const Func& func ) {
+   std::string name = func.name.substr(func.name.compare(0, 1, "$") == 0);
+   if ( name.compare(0, 7, "_ZN3ftl") == 0 || name.compare(0, 8, "_ZNK3ftl") == 0 )
+      return true;
+   name = name.substr(0, name.find('('));
+   return name.compare(0, 5, "ftl::") == 0 || name.find(" ftl::") != std::string::npos;
+}
+
+void FlattenExprs( const ExprList& exprs, std::vector<const Expr*>& out ) {
+   for ( const Expr& expr : exprs ) {
+      out.push_back(&expr);
+      switch ( expr.type() ) {
+         case ExprType::Block:
+            FlattenExprs(static_cast<const BlockExpr*>(&expr)->block.exprs, out);
+            break;
+         case ExprType::Loop:
+            FlattenExprs(static_cast<const LoopExpr*>(&expr)->block.exprs, out);
+            break;
+         case ExprType::If:
+            FlattenExprs(static_cast<const IfExpr*>(&expr)->true_.exprs, out);
+            FlattenExprs(static_cast<const IfExpr*>(&expr)->false_, out);
+            break;
+         default:
+            break;
+      }
+   }
+}
+
+bool IsGetStackPointer( const Expr* expr ) {
+   return expr->type() == ExprType::GetGlobal && static_cast<const GetGlobalExpr*>(expr)->var.index() == 0;
+}
+
+// Frames are allocated by the code LLVM emits for the shadow stack:
+//    global.get $__stack_pointer, i32.const N, i32.sub  (prologue, or a fixed alloca)
+//    <size>, i32.sub, [local.tee], global.set $__stack_pointer  (dynamic alloca)
+StackFrame GetStackFrame( const Module& mod, const Func& func ) {
+   StackFrame frame;
+   frame.ftllib = IsFtllibFunction(func);
+   std::vector<const Expr*> code;
+   FlattenExprs(func.exprs, code);
+   for ( size_t i = 0; i < code.size(); i++ ) {
+      const Expr* expr = code[i];
+      if ( expr->type() == ExprType::Call ) {
+         frame.callees.insert(mod.GetFuncIndex(static_cast<const CallExpr*>(expr)->var));
+      } else if ( expr->type() == ExprType::CallIndirect ) {
+         // any function in the table with the same signature can be the target
+         const FuncSignature& sig = static_cast<const CallIndirectExpr*>(expr)->decl.sig;
+         for ( const ElemSegment* seg : mod.elem_segments )
+            for ( const Var& var : seg->vars )
+               if ( mod.GetFunc(var)->decl.sig == sig )
+                  frame.callees.insert(mod.GetFuncIndex(var));
+      } else if ( expr->type() == ExprType::Binary && static_cast<const BinaryExpr*>(expr)->opcode == Opcode::I32Sub && i >= 2 ) {
+         const Expr* rhs = code[i-1];
+         bool constant = rhs->type() == ExprType::Const && static_cast<const ConstExpr*>(rhs)->const_.type == Type::I32;
+         size_t next = i + 1;
+         if ( next < code.size() && code[next]->type() == ExprType::TeeLocal )
+            next++;
+         bool moves_sp = next < code.size() && code[next]->type() == ExprType::SetGlobal &&
+                         static_cast<const SetGlobalExpr*>(code[next])->var.index() == 0;
+         if ( constant && (IsGetStackPointer(code[i-2]) || moves_sp) )
+            frame.size += static_cast<const ConstExpr*>(rhs)->const_.u32;
+         else if ( !constant && moves_sp )
+            frame.dynamic_allocas++;
+      }
+   }
+   return frame;
+}
+
+struct StackUsage {
+   uint64_t bytes = 0;
+   bool dynamic = false;      // dynamic allocas were counted as kDynamicAllocaBound
+   bool approximate = false;  // some of them are outside ftllib, so the bound is a guess
+   bool unbounded = false;    // recursion
+   std::vector<Index> path;
+};
+
+class StackAnalysis {
+   public:
+      explicit StackAnalysis( const Module& mod ) : mod(mod), frames(mod.funcs.size()),
+                                                    state(mod.funcs.size(), 0), usage(mod.funcs.size()) {
+         for ( Index i = mod.num_func_imports; i < mod.funcs.size(); i++ )
+            frames[i] = GetStackFrame(mod, *mod.funcs[i]);
+      }
+
+      const StackUsage& Get( Index func ) {
+         if ( state[func] == 2 )
+            return usage[func];
+         if ( state[func] == 1 ) {
+            // back edge, the recursion depth isn't known
+            usage[func].unbounded = true;
+            return usage[func];
+         }
+         state[func] = 1;
+         StackUsage result;
+         const StackFrame& frame = frames[func];
+         result.bytes = frame.size + uint64_t(frame.dynamic_allocas) * kDynamicAllocaBound;
+         result.dynamic = frame.dynamic_allocas > 0;
+         result.approximate = frame.dynamic_allocas > 0 && !frame.ftllib;
+         StackUsage deepest;
+         for ( Index callee : frame.callees ) {
+            StackUsage callee_usage = Get(callee);
+            result.dynamic |= callee_usage.dynamic;
+            result.approximate |= callee_usage.approximate;
+            result.unbounded |= callee_usage.unbounded;
+            if ( callee_usage.bytes > deepest.bytes || deepest.path.empty() )
+               deepest = callee_usage;
+         }
+         result.bytes += deepest.bytes;
+         result.path.push_back(func);
+         result.path.insert(result.path.end(), deepest.path.begin(), deepest.path.end());
+         result.unbounded |= usage[func].unbounded;
+         usage[func] = result;
+         state[func] = 2;
+         return usage[func];
+      }
+
+      std::string Name( Index func ) const {
+         if ( !mod.funcs[func]->name.empty() )
+            return mod.funcs[func]->name;
+         return "func[" + std::to_string(func) + "]";
+      }
+
+   private:
+      const Module& mod;
+      std::vector<StackFrame> frames;
+      std::vector<int> state;
+      std::vector<StackUsage> usage;
+};
+
+// The stack sits below the data with -stack-first, so anything deeper than the initial
+// stack pointer overwrites the data.
+bool CheckStackUsage( Module& mod ) {
+   if ( s_stack_check == "none" && !s_stack_report )
+      return true;
+   uint64_t available = GetStackPtr(mod);
+   StackAnalysis analysis(mod);
+   bool ok = true;
+   for ( const Export* exp : mod.exports ) {
+      if ( exp->kind != ExternalKind::Func )
+         continue;
+      Index func = mod.GetFuncIndex(exp->var);
+      const StackUsage& usage = analysis.Get(func);
+      if ( s_stack_report ) {
+         std::string path;
+         for ( Index f : usage.path )
+            path += (path.empty() ? "" : " -> ") + analysis.Name(f);
+         std::string note;
+         if ( usage.dynamic )
+            note = ", dynamic allocas counted as " + std::to_string(kDynamicAllocaBound) + " bytes";
+         if ( usage.approximate )
+            note += ", approximate";
+         printf("%s: %s%" PRIu64 " bytes of %" PRIu64 "%s (%s)\n", exp->name.c_str(),
+                usage.unbounded ? ">= " : "", usage.bytes, available, note.c_str(), path.c_str());
+      }
+      if ( s_stack_check == "none" )
+         continue;
+      // recursion and dynamic allocas outside ftllib make the usage a guess, which only warns
+      if ( usage.bytes > available && !usage.unbounded && !usage.approximate ) {
+         fprintf(stderr, "%s: %s needs %" PRIu64 " bytes of stack but only %" PRIu64 " are available, "
+                         "increase it with --stack-size\n",
+                 s_stack_check == "error" ? "error" : "warning", exp->name.c_str(), usage.bytes, available);
+         ok = false;
+      } else if ( usage.bytes > available ) {
+         fprintf(stderr, "warning: %s may need %" PRIu64 " bytes of stack but only %" PRIu64 " are available\n",
+                 exp->name.c_str(), usage.bytes, available);
+      } else if ( usage.unbounded ) {
+         fprintf(stderr, "warning: stack usage of %s is unbounded because of recursion\n",
+                 exp->name.c_str());
+      } else if ( usage.approximate ) {
+         fprintf(stderr, "warning: stack usage of %s is approximate, a dynamic alloca outside ftllib "
+                         "was counted as %u bytes\n", exp->name.c_str(), kDynamicAllocaBound);
+      }
+   }
+   return ok || s_stack_check != "error";
+}
+
+// With --heap-reserve the memory starts with exactly the pages the data, the stack and the
+// reserve need and can't grow, ftl_malloc fails cleanly instead of growing it
+bool SetMemoryLimits( Module& mod ) {
+   if ( s_heap_reserve < 0 )
+      return true;
+   uint32_t heap_base;
+   if ( mod.memories.empty() || mod.num_memory_imports || !GetExportedAddress(mod, "__heap_base", heap_base) ) {
+      fprintf(stderr, "--heap-reserve needs a defined memory and the __heap_base export of fractal-ld\n");
+      return false;
+   }
+   uint64_t pages = (heap_base + uint64_t(s_heap_reserve) + kPageSize - 1) / kPageSize;
+   if ( pages > WABT_MAX_PAGES ) {
+      fprintf(stderr, "--heap-reserve %" PRId64 " needs more than the %u pages of a memory\n",
+              s_heap_reserve, WABT_MAX_PAGES);
+      return false;
+   }
+   Limits& limits = mod.memories[0]->page_limits;
+   limits.initial = pages;
+   limits.max = pages;
+   limits.has_max = true;
+   return true;
+}
+
+void PrintMemoryReport( const Module& mod, uint32_t stack_size, size_t stripped_bytes ) {
+   uint64_t data_bytes = 0, data_end = 0;
+   for ( const DataSegment* ds : mod.data_segments ) {
+      data_bytes += ds->data.size();
+      uint32_t offset;
+      if ( GetConstOffset(ds->offset, offset) )
+         data_end = std::max<uint64_t>(data_end, offset + ds->data.size());
+   }
+   uint32_t heap_base = 0, address = 0;
+   GetExportedAddress(mod, "__heap_base", heap_base);
+   if ( GetExportedAddress(mod, "__data_end", address) )
+      data_end = address;
+
+   printf("%s:\n", s_outfile.c_str());
+   if ( !mod.memories.empty() ) {
+      const Limits& limits = mod.memories[0]->page_limits;
+      printf("  memory   %" PRIu64 " pages (%" PRIu64 " bytes)", limits.initial, limits.initial * kPageSize);
+      if ( limits.has_max )
+         printf(", at most %" PRIu64 " pages\n", limits.max);
+      else
+         printf(", grows on demand\n");
+      printf("  heap     starts at %u, %" PRIu64 " bytes before the first memory.grow\n", heap_base,
+             limits.initial * kPageSize > heap_base ? limits.initial * kPageSize - heap_base : 0);
+   }
+   printf("  stack    %u bytes\n", stack_size);
+   printf("  data     %" PRIu64 " bytes in %zu segments, ends at %" PRIu64 ", %zu zeroed bytes stripped\n",
+          data_bytes, mod.data_segments.size(), data_end, stripped_bytes);
+   printf("  table    %" PRIu64 " elements\n", mod.tables.empty() ? 0 : mod.tables[0]->elem_limits.initial);
+   printf("  globals  %zu\n", mod.globals.size());
+}
+
+// names of the functions after folding, the module itself keeps its name
+// section only with --debug-names
+bool WriteNameMap( const Module& mod, const std::string& filename ) {
+   FILE* out = fopen(filename.c_str(), "w");
+   if (!out) {
+      fprintf(stderr, "can't open %s\n", filename.c_str());
+      return false;
+   }
+   for (Index i = 0; i < mod.funcs.size(); i++) {
+      const std::string& name = mod.funcs[i]->name;
+      if (name.size() > 1)
+         fprintf(out, "%u\t%s\n", i, name.c_str() + (name[0] == '$'));
+   }
+   fclose(out);
+   return true;
+}
+
 void WriteBufferToFile(string_view filename,
                        const OutputBuffer& buffer) {
   buffer.WriteToFile(filename);
@@ -139,21 +777,45 @@ int ProgramMain(int argc, char** argv) {
   bool stub = false;
   std::unique_ptr<FileStream> s_log_stream_s;
   result = ReadFile(s_infile.c_str(), &file_data);
-  DataSegment _hds;
+  std::vector<std::unique_ptr<DataSegment>> segments;
   if (Succeeded(result)) {
     ErrorHandlerFile error_handler(Location::Type::Binary);
     Module module;
     const bool kStopOnFirstError = true;
+    // the names tell ftllib frames apart in the stack check, they are only written with --debug-names
+    const bool kReadDebugNames = true;
     ReadBinaryOptions options(s_features, s_log_stream_s.get(),
-                              stub, kStopOnFirstError,
+                              kReadDebugNames, kStopOnFirstError,
                               stub);
     result = ReadBinaryIr(s_infile.c_str(), file_data.data(),
                           file_data.size(), &options, &error_handler, &module);
 
     if (Succeeded(result)) {
+      if (!CheckStackUsage(module)) {
+        return 1;
+      }
       size_t fixup = 0;
       StripZeroedData(module, fixup);
-      AddHeapPointerData(module, fixup, file_data, _hds);
+      CompactDataSegments(module, segments);
+      if (s_fold_functions) {
+        size_t folded = FoldIdenticalFunctions(module, s_fold_all);
+        if (s_verbose)
+          printf("folded %zu functions\n", folded);
+      }
+      // the stack pointer is global 0 only until the unused globals are removed
+      uint32_t stack_size = s_memory_report ? GetStackPtr(module) : 0;
+      if (s_strip_unused) {
+        size_t types = 0, globals = 0;
+        RemoveUnusedTypesAndGlobals(module, types, globals);
+        if (s_verbose)
+          printf("removed %zu types and %zu globals\n", types, globals);
+      }
+      if (!s_name_map.empty() && !WriteNameMap(module, s_name_map)) {
+        return 1;
+      }
+      if (!SetMemoryLimits(module)) {
+        return 1;
+      }
      if (Succeeded(result)) {
       MemoryStream stream(s_log_stream.get());
       result =
@@ -164,6 +826,9 @@ int ProgramMain(int argc, char** argv) {
           s_outfile = s_infile;
         }
         WriteBufferToFile(s_outfile.c_str(), stream.output_buffer());
+        if (s_memory_report) {
+          PrintMemoryReport(module, stack_size, fixup);
+        }
       }
     }
    } 
@@ -0,0 +1,430 @@
+/*
+ * Copyright 2016 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "src/binary-reader-nop.h"
+#include "src/binary-reader.h"
+#include "src/binary.h"
+#include "src/feature.h"
+#include "src/option-parser.h"
+#include "src/stream.h"
+
+using namespace wabt;
+
+static std::string s_infile;
+static std::string s_names;
+static std::string s_diff;
+static std::string s_diff_names;
+static Index s_top = 20;
+static Features s_features;
+
+static const char s_description[] =
+R"(  Attribute the bytes of a contract to sections, functions, template
+  families and data segments, or compare two builds of it.
+
+  # sizes of a contract
+  $ fractal-size contract.wasm
+
+  # stripped contract with the names fractal-ld --name-map kept aside
+  $ fractal-size contract.wasm --names contract.wasm.names
+
+  # what changed since the previous build
+  $ fractal-size new.wasm --diff old.wasm
+
+  Functions are named by the name section, the name map or their export.
+  Template families group functions by their demangled name with the
+  template arguments and parameters left out, e.g. all instances of
+  ftl::execute_action<...> or ftl::operator<<<...>.
+)";
+
+static void ParseOptions(int argc, char** argv) {
+  OptionParser parser("fractal-size", s_description);
+
+  parser.AddHelpOption();
+  s_features.AddOptions(&parser);
+  parser.AddOption(0, "names", "FILE",
+                   "Function names of a stripped contract, written by "
+                   "fractal-ld --name-map",
+                   [](const char* argument) { s_names = argument; });
+  parser.AddOption(0, "diff", "WASM", "Compare with this previous build",
+                   [](const char* argument) { s_diff = argument; });
+  parser.AddOption(0, "diff-names", "FILE",
+                   "Function names of the previous build when it is stripped",
+                   [](const char* argument) { s_diff_names = argument; });
+  parser.AddOption('n', "top", "N",
+                   "Number of rows of each table (default 20, 0 for all)",
+                   [](const char* argument) { s_top = atoi(argument); });
+  parser.AddArgument("filename", OptionParser::ArgumentCount::One,
+                     [](const char* argument) { s_infile = argument; });
+  parser.Parse(argc, argv);
+}
+
+// bytes of each item of a category, by name
+typedef std::map<std::string, uint64_t> Sizes;
+
+struct Report {
+  uint64_t total = 0;
+  Sizes sections;
+  Sizes functions;
+  Sizes families;
+  Sizes data;
+  std::map<std::string, uint64_t> family_counts;
+};
+
+static uint32_t LebSize(uint64_t value) {
+  uint32_t size = 1;
+  while (value >>= 7)
+    size++;
+  return size;
+}
+
+class SizeReader : public BinaryReaderNop {
+ public:
+  std::vector<std::pair<std::string, uint64_t>> sections;
+  std::map<Index, uint64_t> bodies;
+  std::map<Index, std::string> names;
+  std::map<Index, std::string> exports;
+  // bytes of the data segments and their offsets, -1 when not constant
+  std::vector<std::pair<int64_t, uint64_t>> segments;
+
+  Result BeginSection(BinarySection section, Offset size) override {
+    Offset header = 1 + LebSize(size);
+    sections.emplace_back(GetSectionName(section), header + size);
+    return Result::Ok;
+  }
+
+  Result BeginCustomSection(Offset size, string_view name) override {
+    sections.back().first = "custom \"" + name.to_string() + "\"";
+    return Result::Ok;
+  }
+
+  Result OnImportFunc(Index import_index,
+                      string_view module_name,
+                      string_view field_name,
+                      Index func_index,
+                      Index sig_index) override {
+    names[func_index] = field_name.to_string();
+    return Result::Ok;
+  }
+
+  Result OnExport(Index index,
+                  ExternalKind kind,
+                  Index item_index,
+                  string_view name) override {
+    if (kind == ExternalKind::Func)
+      exports[item_index] = name.to_string();
+    return Result::Ok;
+  }
+
+  // the offset is at the size of the body, the end past its last byte
+  Result BeginFunctionBody(Index index) override {
+    body_start_ = state->offset;
+    return Result::Ok;
+  }
+
+  Result EndFunctionBody(Index index) override {
+    bodies[index] = state->offset - body_start_;
+    return Result::Ok;
+  }
+
+  // the offset is past the memory index
+  Result BeginDataSegment(Index index, Index memory_index) override {
+    segment_start_ = state->offset - LebSize(memory_index);
+    segment_offset_ = -1;
+    return Result::Ok;
+  }
+
+  Result OnInitExprI32ConstExpr(Index index, uint32_t value) override {
+    segment_offset_ = value;
+    return Result::Ok;
+  }
+
+  Result EndDataSegment(Index index) override {
+    segments.emplace_back(segment_offset_, state->offset - segment_start_);
+    return Result::Ok;
+  }
+
+  Result OnFunctionName(Index index, string_view name) override {
+    if (!name.empty())
+      names[index] = name.to_string();
+    return Result::Ok;
+  }
+
+ private:
+  Offset body_start_ = 0;
+  Offset segment_start_ = 0;
+  int64_t segment_offset_ = -1;
+};
+
+// The demangled name without its return type, parameters and template
+// arguments: "bool ftl::execute_action<test, void>(void (test::*)())" is
+// "ftl::execute_action<...>", the operator<< of datastream
+// "ftl::operator<<<...>". The words after "operator" name it, e.g.
+// "operator new[]" or the conversion "ftl::name::operator unsigned long long".
+// Plain C names are their own family.
+static std::string TemplateFamily(const std::string& name) {
+  static const char* const kOperators[] = {"<<=", ">>=", "<<", ">>", "<=",
+                                           ">=",  "->",  "()", "[]", "<",
+                                           ">"};
+  static const char kAnonymous[] = "(anonymous namespace)";
+  auto is_ident = [](char c) { return isalnum(uint8_t(c)) || c == '_'; };
+
+  std::string family;
+  int depth = 0;
+  // in the words of "operator new" or a conversion operator
+  bool operator_words = false;
+  for (size_t i = 0; i < name.size(); i++) {
+    char c = name[i];
+    if (!depth && !operator_words && name.compare(i, 8, "operator") == 0 &&
+        (i == 0 || !is_ident(name[i - 1])) &&
+        (i + 8 == name.size() || !is_ident(name[i + 8]))) {
+      family += "operator";
+      i += 8;
+      for (const char* op : kOperators) {
+        if (name.compare(i, strlen(op), op) == 0) {
+          family += op;
+          i += strlen(op);
+          break;
+        }
+      }
+      operator_words = i < name.size() && name[i] == ' ';
+      i--;
+      continue;
+    }
+    if (!depth && name.compare(i, strlen(kAnonymous), kAnonymous) == 0) {
+      family += kAnonymous;
+      i += strlen(kAnonymous) - 1;
+      continue;
+    }
+    if (c == '<') {
+      if (depth++ == 0)
+        family += "<...>";
+      continue;
+    }
+    if (c == '>') {
+      if (depth)
+        depth--;
+      continue;
+    }
+    if (depth)
+      continue;
+    if (c == '(')
+      break;
+    if (c == ' ' && !operator_words) {
+      // what came before was the return type
+      family.clear();
+      continue;
+    }
+    family += c;
+  }
+  return family.empty() ? name : family;
+}
+
+// "<index>\t<name>" lines, see fractal-pp --name-map
+static Result ReadNameMap(const std::string& filename,
+                          std::map<Index, std::string>* names) {
+  std::ifstream in(filename);
+  if (!in) {
+    fprintf(stderr, "fractal-size: can't open %s\n", filename.c_str());
+    return Result::Error;
+  }
+  std::string line;
+  for (size_t n = 1; std::getline(in, line); n++) {
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos || tab == 0) {
+      fprintf(stderr, "fractal-size: %s:%" PRIzd ": malformed name map\n",
+              filename.c_str(), n);
+      return Result::Error;
+    }
+    (*names)[strtoul(line.substr(0, tab).c_str(), nullptr, 10)] =
+        line.substr(tab + 1);
+  }
+  return Result::Ok;
+}
+
+static Result ReadReport(const std::string& filename,
+                         const std::string& name_map,
+                         Report* report) {
+  std::vector<uint8_t> data;
+  CHECK_RESULT(ReadFile(filename.c_str(), &data));
+
+  SizeReader reader;
+  ReadBinaryOptions options(s_features, nullptr, true, true, false);
+  if (Failed(ReadBinary(data.data(), data.size(), &reader, &options))) {
+    fprintf(stderr, "fractal-size: %s: not a valid wasm module\n",
+            filename.c_str());
+    return Result::Error;
+  }
+  if (!name_map.empty())
+    CHECK_RESULT(ReadNameMap(name_map, &reader.names));
+
+  report->total = data.size();
+  report->sections["header"] = 8;  // magic and version
+  for (const auto& section : reader.sections)
+    report->sections[section.first] += section.second;
+  for (const auto& body : reader.bodies) {
+    std::string name;
+    auto it = reader.names.find(body.first);
+    if (it != reader.names.end())
+      name = it->second;
+    else if (reader.exports.count(body.first))
+      name = reader.exports[body.first];
+    else
+      name = "func[" + std::to_string(body.first) + "]";
+    report->functions[name] += body.second;
+    std::string family = TemplateFamily(name);
+    report->families[family] += body.second;
+    report->family_counts[family]++;
+  }
+  for (size_t i = 0; i < reader.segments.size(); i++) {
+    std::string name = "data[" + std::to_string(i) + "]";
+    // segments are matched by index when comparing builds, offsets move
+    if (s_diff.empty() && reader.segments[i].first >= 0)
+      name += " @" + std::to_string(reader.segments[i].first);
+    report->data[name] += reader.segments[i].second;
+  }
+  return Result::Ok;
+}
+
+static double Percent(uint64_t value, uint64_t total) {
+  return total ? 100.0 * value / total : 0.0;
+}
+
+static void PrintSizes(const char* title,
+                       const Sizes& sizes,
+                       uint64_t total,
+                       const std::map<std::string, uint64_t>* counts) {
+  std::vector<std::pair<std::string, uint64_t>> rows(sizes.begin(),
+                                                     sizes.end());
+  std::stable_sort(rows.begin(), rows.end(),
+                   [](const std::pair<std::string, uint64_t>& a,
+                      const std::pair<std::string, uint64_t>& b) {
+                     return a.second > b.second;
+                   });
+  uint64_t sum = 0;
+  for (const auto& row : rows)
+    sum += row.second;
+  size_t shown = s_top && rows.size() > s_top ? s_top : rows.size();
+
+  printf("\n%s (%" PRIzd ", %" PRIu64 " bytes)\n", title, rows.size(), sum);
+  printf("%10s %7s %s %s\n", "bytes", "%", counts ? "   count" : "", "name");
+  for (size_t i = 0; i < shown; i++) {
+    printf("%10" PRIu64 " %6.2f%%", rows[i].second,
+           Percent(rows[i].second, total));
+    if (counts)
+      printf(" %8" PRIu64, counts->at(rows[i].first));
+    printf("  %s\n", rows[i].first.c_str());
+  }
+  if (shown < rows.size())
+    printf("%10s  ... %" PRIzd " more\n", "", rows.size() - shown);
+}
+
+static void PrintDiff(const char* title, const Sizes& old_sizes,
+                      const Sizes& new_sizes) {
+  struct Row {
+    std::string name;
+    uint64_t old_bytes = 0;
+    uint64_t new_bytes = 0;
+    int64_t delta() const { return int64_t(new_bytes) - int64_t(old_bytes); }
+  };
+  std::map<std::string, Row> merged;
+  for (const auto& s : old_sizes) {
+    merged[s.first].name = s.first;
+    merged[s.first].old_bytes = s.second;
+  }
+  for (const auto& s : new_sizes) {
+    merged[s.first].name = s.first;
+    merged[s.first].new_bytes = s.second;
+  }
+  std::vector<Row> rows;
+  int64_t total = 0;
+  for (const auto& m : merged) {
+    if (m.second.delta()) {
+      rows.push_back(m.second);
+      total += m.second.delta();
+    }
+  }
+  std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+    return std::abs(a.delta()) > std::abs(b.delta());
+  });
+  size_t shown = s_top && rows.size() > s_top ? s_top : rows.size();
+
+  printf("\n%s (%" PRIzd " changed, %+" PRId64 " bytes)\n", title,
+         rows.size(), total);
+  if (rows.empty())
+    return;
+  printf("%10s %10s %10s  %s\n", "old", "new", "delta", "name");
+  for (size_t i = 0; i < shown; i++) {
+    const Row& row = rows[i];
+    printf("%10" PRIu64 " %10" PRIu64 " %+10" PRId64 "  %s", row.old_bytes,
+           row.new_bytes, row.delta(), row.name.c_str());
+    if (!row.old_bytes)
+      printf(" (new)");
+    else if (!row.new_bytes)
+      printf(" (removed)");
+    printf("\n");
+  }
+  if (shown < rows.size())
+    printf("%10s  ... %" PRIzd " more\n", "", rows.size() - shown);
+}
+
+int ProgramMain(int argc, char** argv) {
+  InitStdio();
+  ParseOptions(argc, argv);
+
+  Report report;
+  if (Failed(ReadReport(s_infile, s_names, &report)))
+    return 1;
+
+  if (s_diff.empty()) {
+    printf("%s: %" PRIu64 " bytes\n", s_infile.c_str(), report.total);
+    PrintSizes("sections", report.sections, report.total, nullptr);
+    PrintSizes("functions", report.functions, report.total, nullptr);
+    PrintSizes("template families", report.families, report.total,
+               &report.family_counts);
+    PrintSizes("data segments", report.data, report.total, nullptr);
+    return 0;
+  }
+
+  Report old_report;
+  if (Failed(ReadReport(s_diff, s_diff_names, &old_report)))
+    return 1;
+  int64_t delta = int64_t(report.total) - int64_t(old_report.total);
+  printf("%s: %" PRIu64 " bytes, %s: %" PRIu64 " bytes, %+" PRId64
+         " (%+.2f%%)\n",
+         s_diff.c_str(), old_report.total, s_infile.c_str(), report.total,
+         delta, old_report.total ? 100.0 * delta / old_report.total : 0.0);
+  PrintDiff("sections", old_report.sections, report.sections);
+  PrintDiff("functions", old_report.functions, report.functions);
+  PrintDiff("template families", old_report.families, report.families);
+  PrintDiff("data segments", old_report.data, report.data);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  WABT_TRY
+  return ProgramMain(argc, argv);
+  WABT_CATCH_BAD_ALLOC_AND_EXIT
+}
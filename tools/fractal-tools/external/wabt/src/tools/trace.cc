@@ -0,0 +1,1472 @@
+/*
+ * Copyright 2016 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+#include <cinttypes>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "src/binary-reader-interp.h"
+#include "src/binary-reader.h"
+#include "src/cast.h"
+#include "src/error-handler.h"
+#include "src/feature.h"
+#include "src/interp.h"
+#include "src/option-parser.h"
+#include "src/stream.h"
+
+using namespace wabt;
+using namespace wabt::interp;
+
+// Trace of the host calls of contract actions, little endian, counts and
+// lengths as unsigned LEB128:
+//
+//   "FTRC" version(u8), then for every action
+//
+//   'A' action(u64) data from to owner amount(u64) time(u64) height(u64)
+//       simple_hash(32 bytes) full_hash(32 bytes)     inputs of apply
+//   'r' table(u64) key found(u8) [value]             db_load and db_has_key
+//   't' table(u64) found(u8)                         db_has_table
+//   'c' status(u32) result                           inter-contract calls, in order
+//   'E' status(u8) instructions(u64) host_calls pages outputs(u64)
+//
+// data, from, to, owner, key, value and result are length prefixed. Reads are
+// the state before the action, the first read of each key only. outputs is an
+// FNV-1a hash over the db writes, logs, transfers, calls and set_result of the
+// action, it tells whether another build of the contract behaves the same.
+// Nodes recording canary traffic write the same format.
+
+typedef std::vector<uint8_t> Bytes;
+
+static const char kTraceMagic[4] = {'F', 'T', 'R', 'C'};
+static const uint8_t kTraceVersion = 1;
+
+enum class Status : uint8_t { Ok, Assert, Exit, Trap };
+
+static const char* StatusToString(Status status) {
+  switch (status) {
+    case Status::Ok:     return "ok";
+    case Status::Assert: return "assert";
+    case Status::Exit:   return "exit";
+    case Status::Trap:   return "trap";
+  }
+  return "?";
+}
+
+struct Stats {
+  Status status = Status::Ok;
+  uint64_t instructions = 0;
+  uint32_t host_calls = 0;
+  uint32_t pages = 0;
+  uint64_t outputs = 0;
+};
+
+struct Read {
+  bool found = false;
+  Bytes value;
+};
+
+struct ActionTrace {
+  uint64_t action = 0;
+  Bytes data;
+  Bytes from;
+  Bytes to;
+  Bytes owner;
+  uint64_t amount = 0;
+  uint64_t time = 0;
+  uint64_t height = 0;
+  uint8_t simple_hash[32] = {};
+  uint8_t full_hash[32] = {};
+
+  std::map<std::pair<uint64_t, Bytes>, Read> reads;
+  std::map<uint64_t, bool> tables;
+  std::vector<std::pair<uint32_t, Bytes>> calls;
+
+  Stats stats;  // of the recording build
+};
+
+// committed state of a local recording
+typedef std::map<uint64_t, std::map<Bytes, Bytes>> Database;
+
+static int s_verbose;
+static std::string s_infile;
+static std::string s_record_file;
+static std::string s_replay_file;
+static std::string s_outfile;
+static std::string s_baseline;
+static bool s_print;
+static Features s_features;
+static Thread::Options s_thread_options;
+static std::unique_ptr<FileStream> s_log_stream;
+
+static const char s_description[] =
+R"(  Record the host calls of contract actions in a trace, or replay a trace
+  against another build of the same contract in the interpreter and compare
+  instructions, host calls and memory per action.
+
+  # run the actions of actions.txt on an empty state and record them
+  $ fractal-trace contract.wasm --record actions.txt -o actions.ftr
+
+  # replay against a new build, compared with the recorded build
+  $ fractal-trace new.wasm --replay actions.ftr
+
+  # replay against two builds
+  $ fractal-trace new.wasm --replay actions.ftr --baseline old.wasm
+
+  Each line of the actions file is an action name (or number), the hex
+  action data and optional from=, to=, owner= (hex), amount=, time= and
+  height= fields. Local recordings have no other contracts, calls to them
+  fail with status 1. Replays serve reads, context and call results from
+  the trace and report actions reading state the recording didn't.
+)";
+
+static void ParseOptions(int argc, char** argv) {
+  OptionParser parser("fractal-trace", s_description);
+
+  parser.AddOption('v', "verbose", "Use multiple times for more info", []() {
+    s_verbose++;
+    s_log_stream = FileStream::CreateStdout();
+  });
+  parser.AddHelpOption();
+  s_features.AddOptions(&parser);
+  parser.AddOption(0, "record", "ACTIONS",
+                   "Run the actions listed in ACTIONS and record their trace",
+                   [](const char* argument) { s_record_file = argument; });
+  parser.AddOption('o', "output", "FILE", "Trace file written by --record",
+                   [](const char* argument) { s_outfile = argument; });
+  parser.AddOption(0, "replay", "TRACE",
+                   "Replay the actions of TRACE and compare with the recording",
+                   [](const char* argument) { s_replay_file = argument; });
+  parser.AddOption(0, "baseline", "WASM",
+                   "Compare the replay with this build instead of the recorded "
+                   "figures",
+                   [](const char* argument) { s_baseline = argument; });
+  parser.AddOption(0, "print", "Forward the prints of the contract to stdout",
+                   []() { s_print = true; });
+  parser.AddArgument("filename", OptionParser::ArgumentCount::One,
+                     [](const char* argument) { s_infile = argument; });
+  parser.Parse(argc, argv);
+
+  if (s_record_file.empty() == s_replay_file.empty()) {
+    fprintf(stderr, "fractal-trace: exactly one of --record or --replay\n");
+    exit(1);
+  }
+  if (!s_record_file.empty() && s_outfile.empty()) {
+    fprintf(stderr, "fractal-trace: --record needs -o\n");
+    exit(1);
+  }
+}
+
+static uint64_t StringToName(const std::string& str, bool* ok) {
+  auto char_to_value = [&](char c) -> uint64_t {
+    if (c == '.')
+      return 0;
+    if (c >= '1' && c <= '5')
+      return (c - '1') + 1;
+    if (c >= 'a' && c <= 'z')
+      return (c - 'a') + 6;
+    *ok = false;
+    return 0;
+  };
+  *ok = !str.empty() && str.size() <= 13;
+  uint64_t value = 0;
+  size_t n = std::min(str.size(), size_t(12));
+  for (size_t i = 0; i < n; ++i) {
+    value <<= 5;
+    value |= char_to_value(str[i]);
+  }
+  value <<= (4 + 5 * (12 - n));
+  if (str.size() == 13) {
+    uint64_t v = char_to_value(str[12]);
+    *ok = *ok && v <= 0x0F;
+    value |= v;
+  }
+  return value;
+}
+
+static std::string NameToString(uint64_t value) {
+  static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+  std::string str(13, '.');
+  uint64_t tmp = value;
+  for (uint32_t i = 0; i <= 12; ++i) {
+    char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+    str[12 - i] = c;
+    tmp >>= (i == 0 ? 4 : 5);
+  }
+  str.erase(str.find_last_not_of('.') + 1);
+  return str;
+}
+
+static bool ParseHex(const std::string& hex, Bytes* out) {
+  auto nibble = [](char c) -> int {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  };
+  size_t begin = hex.compare(0, 2, "0x") == 0 ? 2 : 0;
+  if ((hex.size() - begin) % 2)
+    return false;
+  out->clear();
+  for (size_t i = begin; i < hex.size(); i += 2) {
+    int hi = nibble(hex[i]), lo = nibble(hex[i + 1]);
+    if (hi < 0 || lo < 0)
+      return false;
+    out->push_back(uint8_t(hi << 4 | lo));
+  }
+  return true;
+}
+
+// SHA-256, for the sha256 and assert_sha256 imports
+class Sha256 {
+ public:
+  static void Hash(const uint8_t* data, size_t size, uint8_t out[32]) {
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    Bytes msg(data, data + size);
+    uint64_t bits = uint64_t(size) * 8;
+    msg.push_back(0x80);
+    while (msg.size() % 64 != 56)
+      msg.push_back(0);
+    for (int i = 7; i >= 0; --i)
+      msg.push_back(uint8_t(bits >> (i * 8)));
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64)
+      Block(&msg[chunk], h);
+    for (int i = 0; i < 8; ++i) {
+      out[i * 4] = uint8_t(h[i] >> 24);
+      out[i * 4 + 1] = uint8_t(h[i] >> 16);
+      out[i * 4 + 2] = uint8_t(h[i] >> 8);
+      out[i * 4 + 3] = uint8_t(h[i]);
+    }
+  }
+
+ private:
+  static uint32_t Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+  static void Block(const uint8_t* p, uint32_t h[8]) {
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+        0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+        0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+        0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+      w[i] = uint32_t(p[i * 4]) << 24 | uint32_t(p[i * 4 + 1]) << 16 |
+             uint32_t(p[i * 4 + 2]) << 8 | uint32_t(p[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+      uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5],
+             g = h[6], hh = h[7];
+    for (int i = 0; i < 64; ++i) {
+      uint32_t s1 = Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25);
+      uint32_t t1 = hh + s1 + ((e & f) ^ (~e & g)) + k[i] + w[i];
+      uint32_t s0 = Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22);
+      uint32_t t2 = s0 + ((a & b) ^ (a & c) ^ (b & c));
+      hh = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += hh;
+  }
+};
+
+class TraceWriter {
+ public:
+  void U8(uint8_t v) { data_.push_back(v); }
+  void U32(uint32_t v) {
+    do {
+      uint8_t b = v & 0x7f;
+      v >>= 7;
+      data_.push_back(b | (v ? 0x80 : 0));
+    } while (v);
+  }
+  void U64(uint64_t v) {
+    for (int i = 0; i < 8; ++i)
+      data_.push_back(uint8_t(v >> (i * 8)));
+  }
+  void Raw(const uint8_t* p, size_t size) { data_.insert(data_.end(), p, p + size); }
+  void Blob(const Bytes& b) {
+    U32(b.size());
+    Raw(b.data(), b.size());
+  }
+
+  const std::vector<uint8_t>& data() const { return data_; }
+
+ private:
+  std::vector<uint8_t> data_;
+};
+
+class TraceReader {
+ public:
+  explicit TraceReader(const std::vector<uint8_t>& data) : data_(data) {}
+
+  bool ok() const { return ok_; }
+  bool done() const { return pos_ >= data_.size(); }
+
+  uint8_t U8() {
+    if (!Need(1))
+      return 0;
+    return data_[pos_++];
+  }
+  uint32_t U32() {
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+      uint8_t b = U8();
+      v |= uint32_t(b & 0x7f) << shift;
+      if (!(b & 0x80))
+        return v;
+    }
+    ok_ = false;
+    return 0;
+  }
+  uint64_t U64() {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+      v |= uint64_t(U8()) << (i * 8);
+    return v;
+  }
+  void Raw(uint8_t* out, size_t size) {
+    if (!Need(size))
+      return;
+    memcpy(out, &data_[pos_], size);
+    pos_ += size;
+  }
+  Bytes Blob() {
+    uint32_t size = U32();
+    if (!Need(size))
+      return Bytes();
+    Bytes b(data_.begin() + pos_, data_.begin() + pos_ + size);
+    pos_ += size;
+    return b;
+  }
+
+ private:
+  bool Need(size_t size) {
+    if (!ok_ || data_.size() - pos_ < size) {
+      ok_ = false;
+      return false;
+    }
+    return true;
+  }
+
+  const std::vector<uint8_t>& data_;
+  size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+static void WriteTrace(const std::vector<ActionTrace>& actions,
+                       TraceWriter* w) {
+  w->Raw(reinterpret_cast<const uint8_t*>(kTraceMagic), sizeof(kTraceMagic));
+  w->U8(kTraceVersion);
+  for (const ActionTrace& a : actions) {
+    w->U8('A');
+    w->U64(a.action);
+    w->Blob(a.data);
+    w->Blob(a.from);
+    w->Blob(a.to);
+    w->Blob(a.owner);
+    w->U64(a.amount);
+    w->U64(a.time);
+    w->U64(a.height);
+    w->Raw(a.simple_hash, 32);
+    w->Raw(a.full_hash, 32);
+    for (const auto& t : a.tables) {
+      w->U8('t');
+      w->U64(t.first);
+      w->U8(t.second);
+    }
+    for (const auto& r : a.reads) {
+      w->U8('r');
+      w->U64(r.first.first);
+      w->Blob(r.first.second);
+      w->U8(r.second.found);
+      if (r.second.found)
+        w->Blob(r.second.value);
+    }
+    for (const auto& c : a.calls) {
+      w->U8('c');
+      w->U32(c.first);
+      w->Blob(c.second);
+    }
+    w->U8('E');
+    w->U8(uint8_t(a.stats.status));
+    w->U64(a.stats.instructions);
+    w->U32(a.stats.host_calls);
+    w->U32(a.stats.pages);
+    w->U64(a.stats.outputs);
+  }
+}
+
+static bool ReadTrace(const std::vector<uint8_t>& data,
+                      std::vector<ActionTrace>* actions) {
+  TraceReader r(data);
+  char magic[sizeof(kTraceMagic)];
+  r.Raw(reinterpret_cast<uint8_t*>(magic), sizeof(magic));
+  if (!r.ok() || memcmp(magic, kTraceMagic, sizeof(magic)) != 0) {
+    fprintf(stderr, "fractal-trace: not a trace file\n");
+    return false;
+  }
+  if (r.U8() != kTraceVersion) {
+    fprintf(stderr, "fractal-trace: unsupported trace version\n");
+    return false;
+  }
+
+  ActionTrace* current = nullptr;
+  while (r.ok() && !r.done()) {
+    uint8_t tag = r.U8();
+    if (tag == 'A') {
+      actions->emplace_back();
+      current = &actions->back();
+      current->action = r.U64();
+      current->data = r.Blob();
+      current->from = r.Blob();
+      current->to = r.Blob();
+      current->owner = r.Blob();
+      current->amount = r.U64();
+      current->time = r.U64();
+      current->height = r.U64();
+      r.Raw(current->simple_hash, 32);
+      r.Raw(current->full_hash, 32);
+      continue;
+    }
+    if (!current) {
+      fprintf(stderr, "fractal-trace: record outside of an action\n");
+      return false;
+    }
+    switch (tag) {
+      case 't': {
+        uint64_t table = r.U64();
+        current->tables[table] = r.U8();
+        break;
+      }
+      case 'r': {
+        uint64_t table = r.U64();
+        Bytes key = r.Blob();
+        Read& read = current->reads[std::make_pair(table, key)];
+        read.found = r.U8();
+        if (read.found)
+          read.value = r.Blob();
+        break;
+      }
+      case 'c': {
+        uint32_t status = r.U32();
+        current->calls.emplace_back(status, r.Blob());
+        break;
+      }
+      case 'E':
+        current->stats.status = Status(r.U8());
+        current->stats.instructions = r.U64();
+        current->stats.host_calls = r.U32();
+        current->stats.pages = r.U32();
+        current->stats.outputs = r.U64();
+        current = nullptr;
+        break;
+      default:
+        fprintf(stderr, "fractal-trace: unknown record '%c'\n", tag);
+        return false;
+    }
+  }
+  if (!r.ok()) {
+    fprintf(stderr, "fractal-trace: truncated trace\n");
+    return false;
+  }
+  return true;
+}
+
+static bool ReadActions(const std::string& filename,
+                        std::vector<ActionTrace>* actions) {
+  std::ifstream in(filename);
+  if (!in) {
+    fprintf(stderr, "fractal-trace: can't open %s\n", filename.c_str());
+    return false;
+  }
+  std::string line;
+  for (size_t n = 1; std::getline(in, line); ++n) {
+    std::istringstream ls(line);
+    std::string token;
+    if (!(ls >> token) || token[0] == '#')
+      continue;
+    auto error = [&](const char* what) {
+      fprintf(stderr, "%s:%zu: %s\n", filename.c_str(), n, what);
+      return false;
+    };
+
+    ActionTrace a;
+    bool ok = true;
+    if (token.find_first_not_of("0123456789") == std::string::npos)
+      a.action = strtoull(token.c_str(), nullptr, 10);
+    else
+      a.action = StringToName(token, &ok);
+    if (!ok)
+      return error("invalid action name");
+    a.time = actions->size() + 1;
+    a.height = actions->size() + 1;
+
+    while (ls >> token) {
+      size_t eq = token.find('=');
+      if (eq == std::string::npos) {
+        if (!ParseHex(token, &a.data))
+          return error("invalid hex action data");
+        continue;
+      }
+      std::string key = token.substr(0, eq), value = token.substr(eq + 1);
+      if (key == "from" || key == "to" || key == "owner") {
+        Bytes* field = key == "from" ? &a.from : key == "to" ? &a.to : &a.owner;
+        if (!ParseHex(value, field))
+          return error("invalid hex address");
+      } else if (key == "amount" || key == "time" || key == "height") {
+        uint64_t* field = key == "amount" ? &a.amount
+                          : key == "time" ? &a.time : &a.height;
+        *field = strtoull(value.c_str(), nullptr, 10);
+      } else {
+        return error("unknown field");
+      }
+    }
+    // the ftllib address size
+    a.from.resize(20);
+    a.to.resize(20);
+    a.owner.resize(20);
+    Sha256::Hash(reinterpret_cast<const uint8_t*>(&a.height), 8, a.simple_hash);
+    Sha256::Hash(a.simple_hash, 32, a.full_hash);
+    actions->push_back(a);
+  }
+  return true;
+}
+
+// Host side of one action, backed by the database of a recording or by the
+// reads of a trace
+class Host {
+ public:
+  Host(ActionTrace* action, Database* db) : action_(action), db_(db) {}
+
+  interp::Result Call(const std::string& name,
+                      const TypedValue* args,
+                      TypedValue* results);
+
+  void set_memory(Memory* memory) { memory_ = memory; }
+
+  Status status = Status::Ok;
+  bool stopped = false;  // by ftl_exit or a failed assert
+  std::string message;
+  uint32_t host_calls = 0;
+  uint64_t outputs = 14695981039346656037ULL;
+  size_t divergences = 0;
+
+  // moves the writes of the action to the database of a recording
+  void Commit();
+
+ private:
+  struct TableOverlay {
+    bool removed = false;
+    std::map<Bytes, Read> keys;
+  };
+
+  bool Mem(uint32_t ptr, uint64_t size, uint8_t** out) {
+    if (!memory_ || uint64_t(ptr) + size > memory_->data.size()) {
+      message = "host call out of bounds";
+      return false;
+    }
+    *out = reinterpret_cast<uint8_t*>(memory_->data.data()) + ptr;
+    return true;
+  }
+  bool Load(uint32_t ptr, uint32_t size, Bytes* out) {
+    uint8_t* p;
+    if (!Mem(ptr, size, &p))
+      return false;
+    out->assign(p, p + size);
+    return true;
+  }
+  bool Store(uint32_t ptr, const uint8_t* data, size_t size) {
+    uint8_t* p;
+    if (!Mem(ptr, size, &p))
+      return false;
+    memcpy(p, data, size);
+    return true;
+  }
+  // copies min(size, data) and zero fills the rest
+  bool Copy(uint32_t ptr, uint32_t size, const Bytes& data) {
+    uint8_t* p;
+    if (!Mem(ptr, size, &p))
+      return false;
+    size_t n = std::min(size_t(size), data.size());
+    memcpy(p, data.data(), n);
+    memset(p + n, 0, size - n);
+    return true;
+  }
+  bool CString(uint32_t ptr, std::string* out) {
+    if (!memory_)
+      return false;
+    for (uint32_t p = ptr; p < memory_->data.size(); ++p) {
+      if (!memory_->data[p]) {
+        out->assign(&memory_->data[ptr], p - ptr);
+        return true;
+      }
+    }
+    message = "unterminated string";
+    return false;
+  }
+
+  void Output(uint8_t tag, const Bytes& data = Bytes()) {
+    auto mix = [&](uint8_t b) {
+      outputs ^= b;
+      outputs *= 1099511628211ULL;
+    };
+    mix(tag);
+    uint32_t size = data.size();
+    for (int i = 0; i < 4; ++i)
+      mix(uint8_t(size >> (i * 8)));
+    for (uint8_t b : data)
+      mix(b);
+  }
+  void Output(uint8_t tag, uint64_t v) {
+    Bytes b(8);
+    memcpy(b.data(), &v, 8);
+    Output(tag, b);
+  }
+
+  Read DbRead(uint64_t table, const Bytes& key);
+  bool DbHasTable(uint64_t table);
+  uint32_t CallContract(const Bytes& addr,
+                        const Bytes& action,
+                        uint64_t amount,
+                        uint32_t storage_delegate,
+                        uint32_t user_delegate,
+                        Bytes* result);
+  bool MultiCall(uint32_t count, const Bytes& calls, uint32_t* status);
+
+  interp::Result Fail(Status s, const std::string& msg) {
+    status = s;
+    message = msg;
+    stopped = true;
+    return interp::Result::TrapHostTrapped;
+  }
+
+  ActionTrace* action_;
+  Database* db_;
+  Memory* memory_ = nullptr;
+  std::map<uint64_t, TableOverlay> overlay_;
+  size_t next_call_ = 0;
+  Bytes call_result_;
+};
+
+Read Host::DbRead(uint64_t table, const Bytes& key) {
+  auto t = overlay_.find(table);
+  if (t != overlay_.end()) {
+    auto k = t->second.keys.find(key);
+    if (k != t->second.keys.end())
+      return k->second;
+    if (t->second.removed)
+      return Read();
+  }
+
+  auto id = std::make_pair(table, key);
+  if (db_) {
+    Read read;
+    auto dt = db_->find(table);
+    if (dt != db_->end()) {
+      auto dk = dt->second.find(key);
+      if (dk != dt->second.end()) {
+        read.found = true;
+        read.value = dk->second;
+      }
+    }
+    action_->reads.emplace(id, read);
+    return read;
+  }
+
+  auto r = action_->reads.find(id);
+  if (r == action_->reads.end()) {
+    divergences++;
+    return Read();
+  }
+  return r->second;
+}
+
+bool Host::DbHasTable(uint64_t table) {
+  auto t = overlay_.find(table);
+  if (t != overlay_.end()) {
+    for (const auto& k : t->second.keys) {
+      if (k.second.found)
+        return true;
+    }
+    if (t->second.removed)
+      return false;
+  }
+
+  if (db_) {
+    auto dt = db_->find(table);
+    bool found = dt != db_->end() && !dt->second.empty();
+    action_->tables.emplace(table, found);
+    return found;
+  }
+
+  auto r = action_->tables.find(table);
+  if (r == action_->tables.end()) {
+    divergences++;
+    return false;
+  }
+  return r->second;
+}
+
+// call_action and the calls of multi_call, the result is the recorded one
+uint32_t Host::CallContract(const Bytes& addr,
+                            const Bytes& action,
+                            uint64_t amount,
+                            uint32_t storage_delegate,
+                            uint32_t user_delegate,
+                            Bytes* result) {
+  Output('C', addr);
+  Output('C', action);
+  Output('C', amount);
+  Output('C', uint64_t(storage_delegate) << 32 | user_delegate);
+  uint32_t status = 1;
+  result->clear();
+  if (db_) {
+    // no other contracts in a local recording
+    action_->calls.emplace_back(status, *result);
+  } else if (next_call_ < action_->calls.size()) {
+    status = action_->calls[next_call_].first;
+    *result = action_->calls[next_call_].second;
+    next_call_++;
+  } else {
+    divergences++;
+  }
+  return status;
+}
+
+// Makes the calls packed by ftllib's runtime::pack_call, each an address,
+// amount(u64), storage_delegate(u8), user_delegate(u8) and action, and packs
+// status(i32) and result of each as the result of the multi_call
+bool Host::MultiCall(uint32_t count, const Bytes& calls, uint32_t* status) {
+  size_t pos = 0;
+  auto leb = [&](uint32_t* out) {
+    *out = 0;
+    for (int shift = 0; shift < 35 && pos < calls.size(); shift += 7) {
+      uint8_t b = calls[pos++];
+      *out |= uint32_t(b & 0x7f) << shift;
+      if (!(b & 0x80))
+        return true;
+    }
+    return false;
+  };
+  auto bytes = [&](Bytes* out) {
+    uint32_t size;
+    if (!leb(&size) || calls.size() - pos < size)
+      return false;
+    out->assign(calls.begin() + pos, calls.begin() + pos + size);
+    pos += size;
+    return true;
+  };
+
+  Bytes results, addr, action, result;
+  *status = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t amount = 0;
+    if (!bytes(&addr) || calls.size() - pos < 10) {
+      message = "malformed multi_call";
+      return false;
+    }
+    memcpy(&amount, &calls[pos], 8);
+    uint32_t storage_delegate = calls[pos + 8];
+    uint32_t user_delegate = calls[pos + 9];
+    pos += 10;
+    if (!bytes(&action)) {
+      message = "malformed multi_call";
+      return false;
+    }
+    uint32_t s = CallContract(addr, action, amount, storage_delegate,
+                              user_delegate, &result);
+    if (!*status)
+      *status = s;
+    for (int b = 0; b < 4; ++b)
+      results.push_back(uint8_t(s >> (b * 8)));
+    uint32_t size = result.size();
+    do {
+      uint8_t b = size & 0x7f;
+      size >>= 7;
+      results.push_back(b | (size ? 0x80 : 0));
+    } while (size);
+    results.insert(results.end(), result.begin(), result.end());
+  }
+  call_result_ = results;
+  return true;
+}
+
+void Host::Commit() {
+  if (!db_)
+    return;
+  for (const auto& t : overlay_) {
+    auto& table = (*db_)[t.first];
+    if (t.second.removed)
+      table.clear();
+    for (const auto& k : t.second.keys) {
+      if (k.second.found)
+        table[k.first] = k.second.value;
+      else
+        table.erase(k.first);
+    }
+    if (table.empty())
+      db_->erase(t.first);
+  }
+}
+
+#if defined(__SIZEOF_FLOAT128__)
+typedef __float128 float128;
+
+static float128 MakeFloat128(uint64_t lo, uint64_t hi) {
+  float128 f;
+  uint64_t parts[2] = {lo, hi};
+  memcpy(&f, parts, sizeof(f));
+  return f;
+}
+
+// -1, 0, 1 or 2 when unordered
+static int CompareFloat128(const TypedValue* args) {
+  float128 a = MakeFloat128(args[0].value.i64, args[1].value.i64);
+  float128 b = MakeFloat128(args[2].value.i64, args[3].value.i64);
+  if (a != a || b != b)
+    return 2;
+  return a < b ? -1 : a > b ? 1 : 0;
+}
+#endif
+
+interp::Result Host::Call(const std::string& name,
+                          const TypedValue* args,
+                          TypedValue* results) {
+  host_calls++;
+  auto i32 = [&](int i) { return args[i].value.i32; };
+  auto i64 = [&](int i) { return args[i].value.i64; };
+  auto ret32 = [&](uint32_t v) { results[0].value.i32 = v; };
+  auto ret64 = [&](uint64_t v) { results[0].value.i64 = v; };
+  auto trap = [&]() { return Fail(Status::Trap, message); };
+  Bytes a, b;
+
+  if (name == "memcpy" || name == "memmove") {
+    uint8_t *dst, *src;
+    if (!Mem(i32(0), i32(2), &dst) || !Mem(i32(1), i32(2), &src))
+      return trap();
+    memmove(dst, src, i32(2));
+    ret32(i32(0));
+  } else if (name == "memset") {
+    uint8_t* dst;
+    if (!Mem(i32(0), i32(2), &dst))
+      return trap();
+    memset(dst, int(i32(1)), i32(2));
+    ret32(i32(0));
+  } else if (name == "memcmp") {
+    uint8_t *p1, *p2;
+    if (!Mem(i32(0), i32(2), &p1) || !Mem(i32(1), i32(2), &p2))
+      return trap();
+    int r = memcmp(p1, p2, i32(2));
+    ret32(r < 0 ? -1 : r > 0 ? 1 : 0);
+  } else if (name == "abort") {
+    return Fail(Status::Trap, "abort");
+  } else if (name == "sha256" || name == "assert_sha256") {
+    uint8_t hash[32];
+    if (!Load(i32(0), i32(1), &a))
+      return trap();
+    Sha256::Hash(a.data(), a.size(), hash);
+    if (name == "sha256") {
+      if (!Store(i32(2), hash, 32))
+        return trap();
+    } else {
+      if (!Load(i32(2), 32, &b))
+        return trap();
+      if (memcmp(b.data(), hash, 32) != 0)
+        return Fail(Status::Assert, "hash mismatch");
+    }
+  } else if (name == "read_action_data") {
+    uint32_t n = std::min(size_t(i32(1)), action_->data.size());
+    if (!Store(i32(0), action_->data.data(), n))
+      return trap();
+    ret32(i32(1) ? n : action_->data.size());
+  } else if (name == "action_data_size") {
+    ret32(action_->data.size());
+  } else if (name == "get_from" || name == "get_to" || name == "get_owner") {
+    const Bytes& v = name == "get_from" ? action_->from
+                     : name == "get_to" ? action_->to : action_->owner;
+    if (!Copy(i32(0), i32(1), v))
+      return trap();
+  } else if (name == "get_amount") {
+    ret64(action_->amount);
+  } else if (name == "current_time") {
+    ret64(action_->time);
+  } else if (name == "current_height") {
+    ret64(action_->height);
+  } else if (name == "current_hash") {
+    if (!Store(i32(0), action_->simple_hash, 32) ||
+        !Store(i32(1), action_->full_hash, 32))
+      return trap();
+  } else if (name == "transfer") {
+    if (!Load(i32(0), i32(1), &a))
+      return trap();
+    Output('T', a);
+    Output('T', i64(2));
+  } else if (name == "call_action" || name == "call_action_result" ||
+             name == "multi_call") {
+    uint32_t status;
+    if (name == "multi_call") {
+      if (!Load(i32(1), i32(2), &a) || !MultiCall(i32(0), a, &status))
+        return trap();
+    } else {
+      if (!Load(i32(0), i32(1), &a) || !Load(i32(2), i32(3), &b))
+        return trap();
+      status = CallContract(a, b, i64(4), i32(5), i32(6), &call_result_);
+    }
+    if (name != "call_action") {
+      // the result, or as much as fits, comes back with the call
+      int arg = name == "multi_call" ? 3 : 7;
+      uint32_t size = call_result_.size();
+      uint32_t n = std::min(i32(arg + 1), size);
+      if (!Store(i32(arg), call_result_.data(), n) ||
+          !Store(i32(arg + 2), reinterpret_cast<const uint8_t*>(&size), 4))
+        return trap();
+    }
+    ret32(status);
+  } else if (name == "call_result") {
+    if (!Copy(i32(0), std::min(size_t(i32(1)), call_result_.size()),
+              call_result_))
+      return trap();
+    ret32(call_result_.size());
+  } else if (name == "set_result") {
+    if (!Load(i32(0), i32(1), &a))
+      return trap();
+    Output('R', a);
+    ret32(i32(1));
+  } else if (name == "log_0" || name == "log_1" || name == "log_2") {
+    int topics = name[4] - '0';
+    if (!Load(i32(0), i32(1), &a))
+      return trap();
+    Output('L', a);
+    for (int t = 0; t <= topics; ++t) {
+      if (!Load(i32(2 + t), 32, &b))
+        return trap();
+      Output('L', b);
+    }
+  } else if (name == "ftl_assert" || name == "ftl_assert_message" ||
+             name == "ftl_assert_code") {
+    if (!i32(0)) {
+      std::string msg;
+      if (name == "ftl_assert") {
+        if (!CString(i32(1), &msg))
+          return trap();
+      } else if (name == "ftl_assert_message") {
+        if (!Load(i32(1), i32(2), &a))
+          return trap();
+        msg.assign(a.begin(), a.end());
+      } else {
+        msg = "error code " + std::to_string(i64(1));
+      }
+      return Fail(Status::Assert, msg);
+    }
+  } else if (name == "ftl_exit") {
+    return Fail(i32(0) ? Status::Exit : Status::Ok,
+                "exit " + std::to_string(int32_t(i32(0))));
+  } else if (name == "db_store") {
+    if (!Load(i32(1), i32(2), &a) || !Load(i32(3), i32(4), &b))
+      return trap();
+    Output('S', i64(0));
+    Output('S', a);
+    Output('S', b);
+    Read& r = overlay_[i64(0)].keys[a];
+    r.found = true;
+    r.value = b;
+  } else if (name == "db_load") {
+    if (!Load(i32(1), i32(2), &a))
+      return trap();
+    Read r = DbRead(i64(0), a);
+    if (!r.found) {
+      ret32(uint32_t(-1));
+    } else {
+      uint32_t n = std::min(size_t(i32(4)), r.value.size());
+      if (!Store(i32(3), r.value.data(), n))
+        return trap();
+      ret32(r.value.size());
+    }
+  } else if (name == "db_has_key") {
+    if (!Load(i32(1), i32(2), &a))
+      return trap();
+    ret32(DbRead(i64(0), a).found);
+  } else if (name == "db_remove_key") {
+    if (!Load(i32(1), i32(2), &a))
+      return trap();
+    Output('D', i64(0));
+    Output('D', a);
+    overlay_[i64(0)].keys[a] = Read();
+  } else if (name == "db_has_table") {
+    ret32(DbHasTable(i64(0)));
+  } else if (name == "db_remove_table") {
+    Output('X', i64(0));
+    TableOverlay& t = overlay_[i64(0)];
+    t.removed = true;
+    t.keys.clear();
+  } else if (name.compare(0, 5, "print") == 0) {
+    if (!s_print)
+      return interp::Result::Ok;
+    if (name == "prints") {
+      std::string s;
+      if (!CString(i32(0), &s))
+        return trap();
+      printf("%s", s.c_str());
+    } else if (name == "prints_l") {
+      if (!Load(i32(0), i32(1), &a))
+        return trap();
+      printf("%.*s", int(a.size()), reinterpret_cast<const char*>(a.data()));
+    } else if (name == "printn") {
+      printf("%s", NameToString(i64(0)).c_str());
+    } else if (name == "printi") {
+      printf("%" PRId64, int64_t(i64(0)));
+    } else if (name == "printui") {
+      printf("%" PRIu64, i64(0));
+    } else if (name == "printsf") {
+      float f;
+      memcpy(&f, &args[0].value.f32_bits, 4);
+      printf("%g", f);
+    } else if (name == "printdf") {
+      double d;
+      memcpy(&d, &args[0].value.f64_bits, 8);
+      printf("%g", d);
+    } else {
+      // printhex and the 128-bit prints, as hex
+      uint32_t size = name == "printhex" ? i32(1) : 16;
+      if (!Load(i32(0), size, &a))
+        return trap();
+      for (uint8_t byte : a)
+        printf("%02x", byte);
+    }
+#if defined(__SIZEOF_FLOAT128__)
+  } else if (name == "__addtf3" || name == "__subtf3" ||
+             name == "__multf3" || name == "__divtf3") {
+    float128 x = MakeFloat128(i64(1), i64(2));
+    float128 y = MakeFloat128(i64(3), i64(4));
+    float128 r = name == "__addtf3"   ? x + y
+                 : name == "__subtf3" ? x - y
+                 : name == "__multf3" ? x * y : x / y;
+    if (!Store(i32(0), reinterpret_cast<const uint8_t*>(&r), 16))
+      return trap();
+  } else if (name == "__negtf2") {
+    float128 r = -MakeFloat128(i64(1), i64(2));
+    if (!Store(i32(0), reinterpret_cast<const uint8_t*>(&r), 16))
+      return trap();
+  } else if (name == "__eqtf2" || name == "__netf2" || name == "__lttf2" ||
+             name == "__letf2" || name == "__cmptf2") {
+    int r = CompareFloat128(args);
+    ret32(r == 2 ? 1 : r);
+  } else if (name == "__getf2" || name == "__gttf2") {
+    int r = CompareFloat128(args);
+    ret32(r == 2 ? -1 : r);
+  } else if (name == "__unordtf2") {
+    ret32(CompareFloat128(args) == 2);
+  } else if (name == "__floatsitf" || name == "__floatunsitf" ||
+             name == "__floatditf" || name == "__floatunditf" ||
+             name == "__extendsftf2" || name == "__extenddftf2") {
+    float128 r;
+    if (name == "__floatsitf") {
+      r = int32_t(i32(1));
+    } else if (name == "__floatunsitf") {
+      r = i32(1);
+    } else if (name == "__floatditf") {
+      r = int64_t(i64(1));
+    } else if (name == "__floatunditf") {
+      r = i64(1);
+    } else if (name == "__extendsftf2") {
+      float f;
+      memcpy(&f, &args[1].value.f32_bits, 4);
+      r = f;
+    } else {
+      double d;
+      memcpy(&d, &args[1].value.f64_bits, 8);
+      r = d;
+    }
+    if (!Store(i32(0), reinterpret_cast<const uint8_t*>(&r), 16))
+      return trap();
+  } else if (name == "__floatsidf") {
+    double d = int32_t(i32(0));
+    memcpy(&results[0].value.f64_bits, &d, 8);
+  } else if (name == "__fixtfsi" || name == "__fixunstfsi") {
+    float128 f = MakeFloat128(i64(0), i64(1));
+    ret32(name == "__fixtfsi" ? uint32_t(int32_t(f)) : uint32_t(f));
+  } else if (name == "__fixtfdi" || name == "__fixunstfdi") {
+    float128 f = MakeFloat128(i64(0), i64(1));
+    ret64(name == "__fixtfdi" ? uint64_t(int64_t(f)) : uint64_t(f));
+  } else if (name == "__fixtfti" || name == "__fixunstfti") {
+    float128 f = MakeFloat128(i64(1), i64(2));
+    typedef unsigned __int128 uint128;
+    uint128 r = name == "__fixtfti" ? static_cast<uint128>(
+                                          static_cast<__int128>(f))
+                                    : static_cast<uint128>(f);
+    if (!Store(i32(0), reinterpret_cast<const uint8_t*>(&r), 16))
+      return trap();
+  } else if (name == "__trunctfdf2") {
+    double d = double(MakeFloat128(i64(0), i64(1)));
+    memcpy(&results[0].value.f64_bits, &d, 8);
+  } else if (name == "__trunctfsf2") {
+    float f = float(MakeFloat128(i64(0), i64(1)));
+    memcpy(&results[0].value.f32_bits, &f, 4);
+#endif
+  } else {
+    return Fail(Status::Trap, "unsupported host function " + name);
+  }
+  return interp::Result::Ok;
+}
+
+struct HostImport {
+  const char* name;
+  const char* signature;  // params:results, i/I/f/F for i32/i64/f32/f64
+};
+
+// the imports of ftllib (base.hpp) and ftl.imports
+static const HostImport s_imports[] = {
+    {"memcpy", "iii:i"}, {"memmove", "iii:i"}, {"memset", "iii:i"},
+    {"memcmp", "iii:i"}, {"abort", ":"},
+    {"sha256", "iii:"}, {"assert_sha256", "iii:"},
+    {"read_action_data", "ii:i"}, {"action_data_size", ":i"},
+    {"get_from", "ii:"}, {"get_to", "ii:"}, {"get_owner", "ii:"},
+    {"get_amount", ":I"}, {"current_time", ":I"}, {"current_height", ":I"},
+    {"current_hash", "ii:"}, {"transfer", "iiI:"},
+    {"call_action", "iiiiIii:i"}, {"call_result", "ii:i"},
+    {"call_action_result", "iiiiIiiiii:i"}, {"multi_call", "iiiiii:i"},
+    {"set_result", "ii:i"}, {"log_0", "iii:"}, {"log_1", "iiii:"},
+    {"log_2", "iiiii:"}, {"ftl_assert", "ii:"},
+    {"ftl_assert_message", "iii:"}, {"ftl_assert_code", "iI:"},
+    {"ftl_exit", "i:"}, {"db_store", "Iiiii:"}, {"db_load", "Iiiii:i"},
+    {"db_has_key", "Iii:i"}, {"db_remove_key", "Iii:"},
+    {"db_has_table", "I:i"}, {"db_remove_table", "I:"},
+    {"printn", "I:"}, {"prints", "i:"}, {"prints_l", "ii:"},
+    {"printi", "I:"}, {"printui", "I:"}, {"printi128", "i:"},
+    {"printui128", "i:"}, {"printsf", "f:"}, {"printdf", "F:"},
+    {"printqf", "i:"}, {"printhex", "ii:"},
+#if defined(__SIZEOF_FLOAT128__)
+    {"__addtf3", "iIIII:"}, {"__subtf3", "iIIII:"}, {"__multf3", "iIIII:"},
+    {"__divtf3", "iIIII:"}, {"__negtf2", "iII:"},
+    {"__eqtf2", "IIII:i"}, {"__netf2", "IIII:i"}, {"__getf2", "IIII:i"},
+    {"__gttf2", "IIII:i"}, {"__lttf2", "IIII:i"}, {"__letf2", "IIII:i"},
+    {"__cmptf2", "IIII:i"}, {"__unordtf2", "IIII:i"},
+    {"__floatsitf", "ii:"}, {"__floatunsitf", "ii:"},
+    {"__floatditf", "iI:"}, {"__floatunditf", "iI:"},
+    {"__floatsidf", "i:F"}, {"__extendsftf2", "if:"},
+    {"__extenddftf2", "iF:"}, {"__fixtfti", "iII:"},
+    {"__fixunstfti", "iII:"}, {"__fixtfdi", "II:I"},
+    {"__fixunstfdi", "II:I"}, {"__fixtfsi", "II:i"},
+    {"__fixunstfsi", "II:i"}, {"__trunctfdf2", "II:F"},
+    {"__trunctfsf2", "II:f"},
+#endif
+};
+
+static std::string SignatureToString(const FuncSignature* sig) {
+  auto code = [](Type type) {
+    switch (type) {
+      case Type::I32: return 'i';
+      case Type::I64: return 'I';
+      case Type::F32: return 'f';
+      case Type::F64: return 'F';
+      default:        return '?';
+    }
+  };
+  std::string s;
+  for (Type type : sig->param_types)
+    s += code(type);
+  s += ':';
+  for (Type type : sig->result_types)
+    s += code(type);
+  return s;
+}
+
+struct HostBinding {
+  Host* host;
+  std::string name;
+};
+
+class TraceHostImportDelegate : public HostImportDelegate {
+ public:
+  explicit TraceHostImportDelegate(Host* host) : host_(host) {}
+
+  wabt::Result ImportFunc(interp::FuncImport* import,
+                          interp::Func* func,
+                          interp::FuncSignature* func_sig,
+                          const ErrorCallback& callback) override {
+    std::string name = import->field_name;
+    for (const HostImport& i : s_imports) {
+      if (name != i.name)
+        continue;
+      if (SignatureToString(func_sig) != i.signature) {
+        callback(("host function " + name + " has an unexpected signature")
+                     .c_str());
+        return wabt::Result::Error;
+      }
+      bindings_.emplace_back(new HostBinding{host_, name});
+      HostFunc* host_func = cast<HostFunc>(func);
+      host_func->callback = HostCallback;
+      host_func->user_data = bindings_.back().get();
+      return wabt::Result::Ok;
+    }
+    callback(("unknown host function " + name).c_str());
+    return wabt::Result::Error;
+  }
+
+  wabt::Result ImportTable(interp::TableImport*,
+                           interp::Table*,
+                           const ErrorCallback&) override {
+    return wabt::Result::Error;
+  }
+
+  wabt::Result ImportMemory(interp::MemoryImport*,
+                            interp::Memory*,
+                            const ErrorCallback&) override {
+    return wabt::Result::Error;
+  }
+
+  wabt::Result ImportGlobal(interp::GlobalImport*,
+                            interp::Global*,
+                            const ErrorCallback&) override {
+    return wabt::Result::Error;
+  }
+
+ private:
+  static interp::Result HostCallback(const HostFunc* func,
+                                     const interp::FuncSignature* sig,
+                                     Index num_args,
+                                     TypedValue* args,
+                                     Index num_results,
+                                     TypedValue* out_results,
+                                     void* user_data) {
+    memset(static_cast<void*>(out_results), 0,
+           sizeof(TypedValue) * num_results);
+    for (Index i = 0; i < num_results; ++i)
+      out_results[i].type = sig->result_types[i];
+    auto* binding = static_cast<HostBinding*>(user_data);
+    return binding->host->Call(binding->name, args, out_results);
+  }
+
+  Host* host_;
+  std::vector<std::unique_ptr<HostBinding>> bindings_;
+};
+
+// Runs apply for one action in a fresh instance. db is the state of a
+// recording, null to replay from the trace.
+static bool RunAction(const std::vector<uint8_t>& wasm,
+                      ActionTrace* action,
+                      Database* db,
+                      Stats* stats,
+                      size_t* divergences) {
+  Host host(action, db);
+  Environment env;
+  HostModule* host_module = env.AppendHostModule("env");
+  host_module->import_delegate.reset(new TraceHostImportDelegate(&host));
+
+  ErrorHandlerFile error_handler(Location::Type::Binary);
+  DefinedModule* module = nullptr;
+  const bool kReadDebugNames = false;
+  const bool kStopOnFirstError = true;
+  const bool kFailOnCustomSectionError = false;
+  ReadBinaryOptions options(s_features, s_log_stream.get(), kReadDebugNames,
+                            kStopOnFirstError, kFailOnCustomSectionError);
+  if (Failed(ReadBinaryInterp(&env, wasm.data(), wasm.size(), &options,
+                              &error_handler, &module))) {
+    return false;
+  }
+  if (module->memory_index == kInvalidIndex) {
+    fprintf(stderr, "fractal-trace: the contract has no memory\n");
+    return false;
+  }
+  Memory* memory = env.GetMemory(module->memory_index);
+  host.set_memory(memory);
+
+  Executor executor(&env, nullptr, s_thread_options);
+  ExecResult result = executor.RunStartFunction(module);
+  if (result.result == interp::Result::Ok) {
+    TypedValues args{TypedValue(Type::I64)};
+    args[0].value.i64 = action->action;
+    result = executor.RunExportByName(module, "apply", args);
+  }
+  if (result.result != interp::Result::Ok && !host.stopped) {
+    host.status = Status::Trap;
+    if (host.message.empty())
+      host.message = ResultToString(result.result);
+  }
+  if (s_verbose && host.status != Status::Ok)
+    printf("  %s: %s\n", StatusToString(host.status), host.message.c_str());
+  if (result.result == interp::Result::UnknownExport) {
+    fprintf(stderr, "fractal-trace: the contract exports no apply\n");
+    return false;
+  }
+
+  if (host.status == Status::Ok)
+    host.Commit();
+  stats->status = host.status;
+  stats->instructions = executor.instruction_count();
+  stats->host_calls = host.host_calls;
+  stats->pages = memory->data.size() / WABT_PAGE_SIZE;
+  stats->outputs = host.outputs;
+  *divergences = host.divergences;
+  return true;
+}
+
+static std::string Delta(uint64_t from, uint64_t to) {
+  char buffer[64];
+  if (from == to)
+    return "=";
+  if (!from)
+    snprintf(buffer, sizeof(buffer), "+%" PRIu64, to);
+  else
+    snprintf(buffer, sizeof(buffer), "%+.2f%%",
+             (double(to) - double(from)) * 100.0 / double(from));
+  return buffer;
+}
+
+static int Record(const std::vector<uint8_t>& wasm) {
+  std::vector<ActionTrace> actions;
+  if (!ReadActions(s_record_file, &actions))
+    return 1;
+
+  Database db;
+  printf("%4s  %-13s %-7s %14s %10s %6s\n", "#", "action", "status",
+         "instructions", "host calls", "pages");
+  for (size_t i = 0; i < actions.size(); ++i) {
+    ActionTrace& a = actions[i];
+    size_t divergences;
+    if (!RunAction(wasm, &a, &db, &a.stats, &divergences))
+      return 1;
+    printf("%4zu  %-13s %-7s %14" PRIu64 " %10u %6u\n", i,
+           NameToString(a.action).c_str(), StatusToString(a.stats.status),
+           a.stats.instructions, a.stats.host_calls, a.stats.pages);
+  }
+
+  TraceWriter writer;
+  WriteTrace(actions, &writer);
+  FileStream stream(s_outfile);
+  if (!stream.is_open()) {
+    fprintf(stderr, "fractal-trace: can't write %s\n", s_outfile.c_str());
+    return 1;
+  }
+  stream.WriteData(writer.data().data(), writer.data().size());
+  return 0;
+}
+
+static int Replay(const std::vector<uint8_t>& wasm) {
+  std::vector<uint8_t> data;
+  if (Failed(ReadFile(s_replay_file, &data)))
+    return 1;
+  std::vector<ActionTrace> actions;
+  if (!ReadTrace(data, &actions))
+    return 1;
+  std::vector<uint8_t> baseline;
+  if (!s_baseline.empty() && Failed(ReadFile(s_baseline, &baseline)))
+    return 1;
+
+  printf("%4s  %-13s %-13s %14s %9s %11s %9s %9s  %s\n", "#", "action",
+         "status", "instructions", "delta", "host calls", "delta", "pages",
+         "outputs");
+  Stats total_a, total_b;
+  size_t differ = 0, diverged = 0;
+  for (size_t i = 0; i < actions.size(); ++i) {
+    ActionTrace& action = actions[i];
+    Stats a = action.stats, b;
+    size_t divergences_a = 0, divergences_b = 0;
+    if (!baseline.empty() &&
+        !RunAction(baseline, &action, nullptr, &a, &divergences_a))
+      return 1;
+    if (!RunAction(wasm, &action, nullptr, &b, &divergences_b))
+      return 1;
+
+    std::string status = StatusToString(b.status);
+    if (a.status != b.status)
+      status = std::string(StatusToString(a.status)) + ">" + status;
+    bool same = a.outputs == b.outputs && a.status == b.status;
+    differ += !same;
+    diverged += divergences_a || divergences_b;
+    char pages[32];
+    snprintf(pages, sizeof(pages), "%u>%u", a.pages, b.pages);
+    printf("%4zu  %-13s %-13s %14" PRIu64 " %9s %11u %9s %9s  %s%s\n", i,
+           NameToString(action.action).c_str(), status.c_str(), b.instructions,
+           Delta(a.instructions, b.instructions).c_str(), b.host_calls,
+           Delta(a.host_calls, b.host_calls).c_str(), pages,
+           same ? "same" : "DIFFER",
+           divergences_a || divergences_b ? " (left the trace)" : "");
+
+    total_a.instructions += a.instructions;
+    total_b.instructions += b.instructions;
+    total_a.host_calls += a.host_calls;
+    total_b.host_calls += b.host_calls;
+    total_a.pages = std::max(total_a.pages, a.pages);
+    total_b.pages = std::max(total_b.pages, b.pages);
+  }
+
+  char pages[32];
+  snprintf(pages, sizeof(pages), "%u>%u", total_a.pages, total_b.pages);
+  printf("%4s  %-13s %-13s %14" PRIu64 " %9s %11u %9s %9s\n", "", "total", "",
+         total_b.instructions,
+         Delta(total_a.instructions, total_b.instructions).c_str(),
+         total_b.host_calls,
+         Delta(total_a.host_calls, total_b.host_calls).c_str(), pages);
+  if (diverged) {
+    printf("%zu actions read state or made calls the trace doesn't have, "
+           "their figures are not comparable\n", diverged);
+  }
+  if (differ) {
+    printf("%zu actions changed their outputs or status\n", differ);
+    return 1;
+  }
+  return 0;
+}
+
+int ProgramMain(int argc, char** argv) {
+  InitStdio();
+  ParseOptions(argc, argv);
+
+  std::vector<uint8_t> wasm;
+  if (Failed(ReadFile(s_infile, &wasm)))
+    return 1;
+  return s_record_file.empty() ? Replay(wasm) : Record(wasm);
+}
+
+int main(int argc, char** argv) {
+  WABT_TRY
+  return ProgramMain(argc, argv);
+  WABT_CATCH_BAD_ALLOC_AND_EXIT
+}
@@ -41,6 +41,35 @@ static cl::list <std::string> input_filename_opt(
         cl::desc("<input file> ..."),
         cl::cat(LD_CAT),
         cl::OneOrMore);
+static cl::opt <std::string> stack_size_opt(
+        "stack-size",
+        cl::desc("Stack size in bytes (default 8192)"),
+        cl::cat(LD_CAT));
+static cl::opt <std::string> stack_check_opt(
+        "stack-check",
+        cl::desc("What to do when an exported function may need more stack than available: error, warn or none"),
+        cl::init("error"),
+        cl::cat(LD_CAT));
+static cl::opt<bool> stack_report_opt(
+        "stack-report",
+        cl::desc("Print the worst-case stack usage of each exported function"),
+        cl::cat(LD_CAT));
+static cl::opt <std::string> heap_reserve_opt(
+        "heap-reserve",
+        cl::desc("Start with memory for the data, the stack and this many bytes of heap, and don't grow it beyond"),
+        cl::cat(LD_CAT));
+static cl::opt<bool> memory_report_opt(
+        "memory-report",
+        cl::desc("Print the memory pages, data, table and globals the contract is instantiated with"),
+        cl::cat(LD_CAT));
+static cl::opt<bool> profile_opt(
+        "profile",
+        cl::desc("Count basic block, host call and allocation executions and keep function names, see fractal-prof"),
+        cl::cat(LD_CAT));
+static cl::opt<bool> name_map_opt(
+        "name-map",
+        cl::desc("Write the function names of the contract to <output>.names for fractal-size"),
+        cl::cat(LD_CAT));
 /// End of ld options
 
 #ifndef ONLY_LD
@@ -107,6 +136,18 @@ static cl::opt<std::string> std_opt(
     "std",
     cl::desc("Language standard to compile for"),
     cl::cat(FtlCompilerToolCategory));
+static cl::opt<bool> no_serializers_opt(
+    "no-serializers",
+    cl::desc("Don't generate datastream serializers for contract types, use reflection instead"),
+    cl::cat(FtlCompilerToolCategory));
+static cl::opt<bool> error_codes_opt(
+    "error-codes",
+    cl::desc("Replace constant check messages by numeric codes, listed in the error_messages of the abi"),
+    cl::cat(FtlCompilerToolCategory));
+static cl::opt<bool> call_result_opt(
+    "call-result",
+    cl::desc("Get call results back with the call and enable ftl::multi_call, needs a host with the call_action_result and multi_call imports"),
+    cl::cat(FtlCompilerToolCategory));
 #endif
 /// end c++ options
 
@@ -120,10 +161,11 @@ struct Options {
     std::string abigen_contract;
     std::vector <std::string> comp_options;
     std::vector <std::string> ld_options;
+    std::vector <std::string> pp_options;
 };
 
 static void GetCompDefaults(std::vector <std::string> &copts) {
-    const char *ftl_fixup_suff = "${CMAKE_SHARED_LIBRARY_SUFFIX}";
+    const char *ftl_fixup_suff = ".so";
     std::string apply_lib;
     copts.emplace_back("--target=wasm32");
     copts.emplace_back("-ffreestanding");
@@ -156,11 +198,15 @@ static void GetCompDefaults(std::vector <std::string> &copts) {
 #ifdef ONLY_LD
 static void GetLdDefaults(std::vector<std::string>& ldopts) {
       ldopts.emplace_back("--gc-sections");
-      ldopts.emplace_back("--strip-all");
-      ldopts.emplace_back("-zstack-size="+std::string("${FTL_STACK_SIZE}"));
+      // the names tell ftllib frames apart in the stack check and go to the name map, fractal-pp drops
+      // the name section
+      ldopts.emplace_back("-zstack-size="+(stack_size_opt.empty() ? std::string("8192") : stack_size_opt));
       ldopts.emplace_back("--merge-data-segments");
       ldopts.emplace_back("-e apply");
-      ldopts.emplace_back("-lc++ -lc -lftl_malloc");
+      if (profile_opt)
+         ldopts.emplace_back("-lftl_prof -lftl_rt -lc++ -lc -lftl_malloc_prof -lftl_builtins");
+      else
+         ldopts.emplace_back("-lftl_rt -lc++ -lc -lftl_malloc -lftl_builtins");
 }
 #endif
 
@@ -169,6 +215,7 @@ static Options CreateOptions(bool add_defaults = true) {
     std::vector <std::string> inputs;
     std::vector <std::string> copts;
     std::vector <std::string> ldopts;
+    std::vector <std::string> ppopts;
     bool link = true;
     std::string pp_dir;
     std::string abigen_contract;
@@ -237,6 +284,60 @@ static Options CreateOptions(bool add_defaults = true) {
 
 #ifdef ONLY_LD
     ldopts.emplace_back("-stack-first");
+
+    ppopts.emplace_back("--stack-check " + stack_check_opt);
+    if (stack_report_opt) {
+        ppopts.emplace_back("--stack-report");
+    }
+    if (!heap_reserve_opt.empty()) {
+        ppopts.emplace_back("--heap-reserve " + heap_reserve_opt);
+    }
+    if (memory_report_opt) {
+        ppopts.emplace_back("--memory-report");
+    }
+    if (profile_opt) {
+        ppopts.emplace_back("--debug-names");
+    }
+#else
+    if (!stack_size_opt.empty()) {
+        ldopts.emplace_back("--stack-size=" + stack_size_opt);
+    }
+    if (stack_check_opt.getNumOccurrences()) {
+        ldopts.emplace_back("--stack-check=" + stack_check_opt);
+    }
+    if (stack_report_opt) {
+        ldopts.emplace_back("--stack-report");
+    }
+    if (!heap_reserve_opt.empty()) {
+        ldopts.emplace_back("--heap-reserve=" + heap_reserve_opt);
+    }
+    if (memory_report_opt) {
+        ldopts.emplace_back("--memory-report");
+    }
+    if (profile_opt) {
+#ifndef _WIN32
+        // line tables feed the counter map of the LLVMFtlFixup pass, which strips them again
+        copts.emplace_back("-gline-tables-only");
+        copts.emplace_back("-mllvm");
+        copts.emplace_back("-ftl-profile");
+#endif
+        ldopts.emplace_back("--profile");
+    }
+    if (name_map_opt) {
+        ldopts.emplace_back("--name-map");
+    }
+#ifdef CPP_COMP
+    if (error_codes_opt) {
+#ifndef _WIN32
+        copts.emplace_back("-mllvm");
+        copts.emplace_back("-ftl-error-codes");
+#endif
+        copts.emplace_back("-DFTL_ERROR_CODES");
+    }
+    if (call_result_opt) {
+        copts.emplace_back("-DFTL_CALL_RESULT");
+    }
+#endif
 #endif
 
     for (auto lib_dir : L_opt) {
@@ -294,5 +395,5 @@ static Options CreateOptions(bool add_defaults = true) {
     }
 #endif
 
-    return {output_fn, inputs, link, pp_dir, abigen_contract, copts, ldopts};
+    return {output_fn, inputs, link, pp_dir, abigen_contract, copts, ldopts, ppopts};
 }
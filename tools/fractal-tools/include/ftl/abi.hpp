@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <set>
 #include <string>
 #include <vector>
 #include <unordered_set>
@@ -28,6 +29,14 @@ struct abi_struct {
 struct abi_action {
     std::string name;
     std::string type;
+    bool readonly = false;
+    // tables read and written ("*" when the table isn't known statically) and the reachable calls,
+    // filled for actions declared on methods
+    bool analyzed = false;
+    std::set <std::string> reads;
+    std::set <std::string> writes;
+    bool calls = false;
+    bool transfers = false;
 
     bool operator<(const abi_action &s) const { return name < s.name; }
 };
@@ -36,6 +45,8 @@ struct abi_table {
     std::string name;
     std::string key_type;
     std::string value_type;
+    // "flat", "chunked" or "vector" for DEF_FLAT_TABLE, DEF_BLOB_TABLE and DEF_VECTOR_TABLE, empty for DEF_TABLE
+    std::string encoding;
 
     bool operator<(const abi_table &t) const { return name < t.name; }
 };
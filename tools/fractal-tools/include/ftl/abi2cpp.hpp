@@ -0,0 +1,587 @@
+#pragma once
+
+#include <ftl/abi_binary.hpp>
+
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ftl {
+    using jsoncons::ojson;
+
+    /**
+     * Generates a standalone C++17 header with a struct and an encoder/decoder for every type of an abi.
+     *
+     * The generated codecs produce the same bytes as ftl::datastream: varuint32 lengths for strings,
+     * vectors and maps, a one byte flag before optionals, fields in declaration order after the fields
+     * of the base. The only dependency is a small runtime emitted once per translation unit, so
+     * off-chain clients don't need ftllib, boost or a JSON parser to talk to a contract.
+     */
+    class abi2cpp {
+    public:
+        abi2cpp(const ojson &abi, const std::string &ns, const std::string &source)
+                : abi(abi), ns(identifier(ns)), source(source), sizes(abi) {
+            if (abi.has_key("structs")) {
+                for (const auto &s : abi["structs"].array_range())
+                    structs[s["name"].as<std::string>()] = &s;
+            }
+            if (abi.has_key("types")) {
+                for (const auto &t : abi["types"].array_range())
+                    typedefs[t["new_type_name"].as<std::string>()] = t["type"].as<std::string>();
+            }
+        }
+
+        std::string generate() {
+            for (const auto &s : structs)
+                visit(s.first);
+            for (const auto &t : typedefs)
+                visit(t.first);
+
+            std::stringstream ss;
+            ss << "// This code was generated by fractal-abi2cpp from " << source << ". DO NOT EDIT\n";
+            ss << "#pragma once\n\n";
+            ss << runtime();
+
+            ss << "\nnamespace " << ns << " {\n";
+            for (const auto &s : structs)
+                ss << "    struct " << identifier(s.first) << ";\n";
+            for (const auto &name : order) {
+                if (typedefs.count(name))
+                    ss << "\n    using " << identifier(name) << " = " << cpp_type(typedefs[name]) << ";\n";
+                else
+                    emit_struct(ss, *structs[name]);
+            }
+            emit_index(ss);
+            ss << "} // namespace " << ns << "\n";
+
+            // codec specializations are declared before any of them is defined, so struct codecs can
+            // use each other in any order (and recursive types work through vectors)
+            ss << "\nnamespace ftl_abi2cpp {\n";
+            for (const auto &s : structs) {
+                std::string type = "::" + ns + "::" + identifier(s.first);
+                ss << "    template<>\n";
+                ss << "    struct codec<" << type << "> {\n";
+                ss << "        static constexpr uint32_t fixed_size = " << sizes.size_of(s.first) << ";\n";
+                ss << "        static void encode(writer &w, const " << type << " &v);\n";
+                ss << "        static void decode(reader &r, " << type << " &v);\n";
+                ss << "    };\n\n";
+            }
+            for (const auto &name : order) {
+                if (structs.count(name))
+                    emit_codec(ss, *structs[name]);
+            }
+            ss << "} // namespace ftl_abi2cpp\n";
+            return ss.str();
+        }
+
+    private:
+        const ojson &abi;
+        std::string ns;
+        std::string source;
+        abi_binary::size_calculator sizes;
+        std::map<std::string, const ojson *> structs;
+        std::map<std::string, std::string> typedefs;
+        std::vector<std::string> order;
+        std::set<std::string> visited;
+
+        static std::string identifier(const std::string &name) {
+            static const std::set<std::string> keywords = {
+                    "alignas", "alignof", "and", "asm", "auto", "bool", "break", "case", "catch", "char", "class",
+                    "const", "constexpr", "continue", "decltype", "default", "delete", "do", "double", "else",
+                    "enum", "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if",
+                    "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "not", "nullptr",
+                    "operator", "or", "private", "protected", "public", "register", "return", "short", "signed",
+                    "sizeof", "static", "struct", "switch", "template", "this", "throw", "true", "try", "typedef",
+                    "typeid", "typename", "union", "unsigned", "using", "virtual", "void", "volatile", "while",
+                    "xor"
+            };
+            std::string ret = name;
+            for (auto &c : ret) {
+                if (!isalnum((unsigned char) c) && c != '_')
+                    c = '_';
+            }
+            if (ret.empty() || isdigit((unsigned char) ret[0]) || keywords.count(ret))
+                ret += "_";
+            return ret;
+        }
+
+        static std::string element_type(const std::string &type) {
+            std::string ret = type;
+            while (!ret.empty()) {
+                if (ret.size() > 2 && ret.compare(ret.size() - 2, 2, "[]") == 0)
+                    ret.resize(ret.size() - 2);
+                else if (ret.back() == '?' || ret.back() == '$')
+                    ret.pop_back();
+                else
+                    break;
+            }
+            return ret;
+        }
+
+        std::string cpp_type(const std::string &type) const {
+            static const std::map<std::string, std::string> builtins = {
+                    {"bool",        "bool"},
+                    {"int8",        "int8_t"},
+                    {"uint8",       "uint8_t"},
+                    {"int16",       "int16_t"},
+                    {"uint16",      "uint16_t"},
+                    {"int32",       "int32_t"},
+                    {"uint32",      "uint32_t"},
+                    {"int64",       "int64_t"},
+                    {"uint64",      "uint64_t"},
+                    {"int128",      "::ftl_abi2cpp::int128"},
+                    {"uint128",     "::ftl_abi2cpp::uint128"},
+                    {"int256",      "::ftl_abi2cpp::int256"},
+                    {"uint256",     "::ftl_abi2cpp::uint256"},
+                    {"float32",     "float"},
+                    {"float64",     "double"},
+                    {"varuint32",   "::ftl_abi2cpp::varuint32"},
+                    {"name",        "::ftl_abi2cpp::name"},
+                    {"address",     "::ftl_abi2cpp::address"},
+                    {"checksum256", "::ftl_abi2cpp::checksum256"},
+                    {"string",      "std::string"},
+                    {"bytes",       "::ftl_abi2cpp::bytes"}
+            };
+            if (type.size() > 2 && type.compare(type.size() - 2, 2, "[]") == 0)
+                return "std::vector<" + cpp_type(type.substr(0, type.size() - 2)) + ">";
+            if (!type.empty() && type.back() == '?')
+                return "std::optional<" + cpp_type(type.substr(0, type.size() - 1)) + ">";
+            if (!type.empty() && type.back() == '$')
+                return "::ftl_abi2cpp::extension<" + cpp_type(type.substr(0, type.size() - 1)) + ">";
+            if (structs.count(type) || typedefs.count(type))
+                return "::" + ns + "::" + identifier(type);
+            auto it = builtins.find(type);
+            if (it == builtins.end())
+                throw std::runtime_error("type " + type + " is not supported by fractal-abi2cpp");
+            return it->second;
+        }
+
+        // dependencies first, a struct holding another one by value needs its complete type
+        void visit(const std::string &name) {
+            if (!visited.insert(name).second)
+                return;
+            auto td = typedefs.find(name);
+            if (td != typedefs.end()) {
+                visit_type(td->second);
+            } else {
+                const ojson &s = *structs[name];
+                visit_type(s.get_with_default("base", std::string()));
+                for (const auto &f : s["fields"].array_range()) {
+                    const std::string type = f["type"].as<std::string>();
+                    // vector members can hold incomplete types, the forward declaration is enough
+                    if (type.size() < 2 || type.compare(type.size() - 2, 2, "[]") != 0)
+                        visit_type(type);
+                }
+            }
+            order.push_back(name);
+        }
+
+        void visit_type(const std::string &type) {
+            std::string t = element_type(type);
+            if (structs.count(t) || typedefs.count(t))
+                visit(t);
+        }
+
+        void emit_struct(std::stringstream &ss, const ojson &s) {
+            std::string base = s.get_with_default("base", std::string());
+            ss << "\n    struct " << identifier(s["name"].as<std::string>());
+            if (!base.empty())
+                ss << " : " << cpp_type(base);
+            ss << " {\n";
+            for (const auto &f : s["fields"].array_range())
+                ss << "        " << cpp_type(f["type"].as<std::string>()) << " " << identifier(f["name"].as<std::string>()) << "{};\n";
+            ss << "    };\n";
+        }
+
+        void emit_codec(std::stringstream &ss, const ojson &s) {
+            std::string type = "::" + ns + "::" + identifier(s["name"].as<std::string>());
+            std::string base = s.get_with_default("base", std::string());
+
+            ss << "    inline void codec<" << type << ">::encode(writer &w, const " << type << " &v) {\n";
+            if (!base.empty())
+                ss << "        codec<" << cpp_type(base) << ">::encode(w, v);\n";
+            for (const auto &f : s["fields"].array_range()) {
+                ss << "        codec<" << cpp_type(f["type"].as<std::string>()) << ">::encode(w, v."
+                   << identifier(f["name"].as<std::string>()) << ");\n";
+            }
+            ss << "    }\n\n";
+
+            ss << "    inline void codec<" << type << ">::decode(reader &r, " << type << " &v) {\n";
+            if (!base.empty())
+                ss << "        codec<" << cpp_type(base) << ">::decode(r, v);\n";
+            for (const auto &f : s["fields"].array_range()) {
+                ss << "        codec<" << cpp_type(f["type"].as<std::string>()) << ">::decode(r, v."
+                   << identifier(f["name"].as<std::string>()) << ");\n";
+            }
+            ss << "    }\n\n";
+        }
+
+        // actions and tables by their abi name, e.g. ns::actions::transfer is the argument struct of transfer
+        void emit_index(std::stringstream &ss) {
+            if (abi.has_key("actions") && !abi["actions"].empty()) {
+                ss << "\n    namespace actions {\n";
+                for (const auto &a : abi["actions"].array_range()) {
+                    ss << "        using " << identifier(a["name"].as<std::string>()) << " = "
+                       << cpp_type(a["type"].as<std::string>()) << ";\n";
+                }
+                ss << "    }\n";
+            }
+            if (abi.has_key("tables") && !abi["tables"].empty()) {
+                ss << "\n    namespace tables {\n";
+                for (const auto &t : abi["tables"].array_range()) {
+                    ss << "        struct " << identifier(t["name"].as<std::string>()) << " {\n";
+                    ss << "            using key_type = " << cpp_type(t["key_type"].as<std::string>()) << ";\n";
+                    ss << "            using value_type = " << cpp_type(t["value_type"].as<std::string>()) << ";\n";
+                    // the marker DEF_FLAT_TABLE, DEF_BLOB_TABLE or DEF_VECTOR_TABLE gives the table struct
+                    std::string encoding = t.get_with_default("encoding", std::string());
+                    if (!encoding.empty())
+                        ss << "            static constexpr bool " << identifier(encoding) << " = true;\n";
+                    ss << "        };\n";
+                }
+                ss << "    }\n";
+            }
+        }
+
+        static const char *runtime() {
+            return R"=====(#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifndef FTL_ABI2CPP_RUNTIME
+#define FTL_ABI2CPP_RUNTIME
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "fractal-abi2cpp codecs copy integers as they are laid out in memory, the host must be little-endian"
+#endif
+
+namespace ftl_abi2cpp {
+    using int128 = __int128;
+    using uint128 = unsigned __int128;
+    using bytes = std::vector<char>;
+    using address = std::array<uint8_t, 20>;
+    using checksum256 = std::array<uint8_t, 32>;
+    // 256-bit integers as their 32 little-endian bytes, the layout of ftl::uint256/int256
+    using int256 = std::array<uint8_t, 32>;
+    using uint256 = std::array<uint8_t, 32>;
+
+    struct varuint32 {
+        uint32_t value = 0;
+    };
+
+    struct name {
+        uint64_t value = 0;
+
+        static name from_string(const std::string &str) {
+            auto symbol = [](char c) -> uint64_t {
+                if (c >= 'a' && c <= 'z')
+                    return (c - 'a') + 6;
+                if (c >= '1' && c <= '5')
+                    return (c - '1') + 1;
+                return 0;
+            };
+            name n;
+            size_t i = 0;
+            for (; i < str.size() && i < 12; ++i)
+                n.value |= (symbol(str[i]) & 0x1f) << (64 - 5 * (i + 1));
+            if (i == 12 && str.size() > 12)
+                n.value |= symbol(str[12]) & 0x0f;
+            return n;
+        }
+
+        std::string to_string() const {
+            static const char *charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+            std::string str(13, '.');
+            uint64_t tmp = value;
+            for (uint32_t i = 0; i <= 12; ++i) {
+                str[12 - i] = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+                tmp >>= (i == 0 ? 4 : 5);
+            }
+            str.erase(str.find_last_not_of('.') + 1);
+            return str;
+        }
+    };
+
+    /**
+     * Trailing field that may be absent from the encoding, ftl::binary_extension
+     */
+    template<typename T>
+    struct extension : std::optional<T> {
+        using std::optional<T>::optional;
+        using std::optional<T>::operator=;
+    };
+
+    class writer {
+    public:
+        explicit writer(std::vector<char> &out) : out(out) {}
+
+        void write(const void *data, size_t size) {
+            const char *p = static_cast<const char *>(data);
+            out.insert(out.end(), p, p + size);
+        }
+
+        void put(char c) { out.push_back(c); }
+
+        void varuint(uint32_t v) {
+            do {
+                uint8_t b = v & 0x7f;
+                v >>= 7;
+                out.push_back(char(v ? b | 0x80 : b));
+            } while (v);
+        }
+
+    private:
+        std::vector<char> &out;
+    };
+
+    class reader {
+    public:
+        reader(const char *data, size_t size) : pos(data), end(data + size) {}
+
+        void check(uint64_t size) const {
+            if (uint64_t(end - pos) < size)
+                throw std::out_of_range("ftl_abi2cpp: read past the end of the buffer");
+        }
+
+        void read(void *data, size_t size) {
+            check(size);
+            memcpy(data, pos, size);
+            pos += size;
+        }
+
+        char get() {
+            check(1);
+            return *pos++;
+        }
+
+        uint32_t varuint() {
+            uint64_t v = 0;
+            for (int shift = 0; shift < 35; shift += 7) {
+                uint8_t b = uint8_t(get());
+                v |= uint64_t(b & 0x7f) << shift;
+                if (!(b & 0x80)) {
+                    if (v > 0xffffffffu)
+                        break;
+                    return uint32_t(v);
+                }
+            }
+            throw std::out_of_range("ftl_abi2cpp: varuint32 out of range");
+        }
+
+        size_t remaining() const { return end - pos; }
+
+    private:
+        const char *pos;
+        const char *end;
+    };
+
+    /**
+     * encode/decode of T, fixed_size is the encoded size of T or 0 if it varies
+     */
+    template<typename T>
+    struct codec;
+
+    template<typename T>
+    struct raw_codec {
+        static constexpr uint32_t fixed_size = sizeof(T);
+
+        static void encode(writer &w, const T &v) { w.write(&v, sizeof(T)); }
+
+        static void decode(reader &r, T &v) { r.read(&v, sizeof(T)); }
+    };
+
+    template<> struct codec<int8_t> : raw_codec<int8_t> {};
+    template<> struct codec<uint8_t> : raw_codec<uint8_t> {};
+    template<> struct codec<int16_t> : raw_codec<int16_t> {};
+    template<> struct codec<uint16_t> : raw_codec<uint16_t> {};
+    template<> struct codec<int32_t> : raw_codec<int32_t> {};
+    template<> struct codec<uint32_t> : raw_codec<uint32_t> {};
+    template<> struct codec<int64_t> : raw_codec<int64_t> {};
+    template<> struct codec<uint64_t> : raw_codec<uint64_t> {};
+    template<> struct codec<int128> : raw_codec<int128> {};
+    template<> struct codec<uint128> : raw_codec<uint128> {};
+    template<> struct codec<float> : raw_codec<float> {};
+    template<> struct codec<double> : raw_codec<double> {};
+    template<size_t N> struct codec<std::array<uint8_t, N>> : raw_codec<std::array<uint8_t, N>> {};
+
+    template<>
+    struct codec<bool> {
+        static constexpr uint32_t fixed_size = 1;
+
+        static void encode(writer &w, const bool &v) { w.put(char(v)); }
+
+        static void decode(reader &r, bool &v) { v = r.get() != 0; }
+    };
+
+    template<>
+    struct codec<name> {
+        static constexpr uint32_t fixed_size = 8;
+
+        static void encode(writer &w, const name &v) { w.write(&v.value, 8); }
+
+        static void decode(reader &r, name &v) { r.read(&v.value, 8); }
+    };
+
+    template<>
+    struct codec<varuint32> {
+        static constexpr uint32_t fixed_size = 0;
+
+        static void encode(writer &w, const varuint32 &v) { w.varuint(v.value); }
+
+        static void decode(reader &r, varuint32 &v) { v.value = r.varuint(); }
+    };
+
+    template<>
+    struct codec<std::string> {
+        static constexpr uint32_t fixed_size = 0;
+
+        static void encode(writer &w, const std::string &v) {
+            w.varuint(uint32_t(v.size()));
+            w.write(v.data(), v.size());
+        }
+
+        static void decode(reader &r, std::string &v) {
+            uint32_t size = r.varuint();
+            r.check(size);
+            v.resize(size);
+            r.read(&v[0], size);
+        }
+    };
+
+    template<typename T>
+    struct codec<std::vector<T>> {
+        static constexpr uint32_t fixed_size = 0;
+        // vectors of integers are copied in one go, like the datastream operators of vector<char>
+        static constexpr bool raw = std::is_base_of<raw_codec<T>, codec<T>>::value;
+
+        static void encode(writer &w, const std::vector<T> &v) {
+            w.varuint(uint32_t(v.size()));
+            if constexpr (raw) {
+                w.write(v.data(), v.size() * sizeof(T));
+            } else {
+                for (const auto &e : v)
+                    codec<T>::encode(w, e);
+            }
+        }
+
+        static void decode(reader &r, std::vector<T> &v) {
+            uint32_t size = r.varuint();
+            // reject impossible sizes before allocating
+            r.check(uint64_t(size) * codec<T>::fixed_size);
+            if constexpr (raw) {
+                v.resize(size);
+                r.read(v.data(), size * sizeof(T));
+            } else {
+                v.clear();
+                v.reserve(std::min<size_t>(size, r.remaining()));
+                for (uint32_t i = 0; i < size; i++) {
+                    v.emplace_back();
+                    codec<T>::decode(r, v.back());
+                }
+            }
+        }
+    };
+
+    template<>
+    struct codec<std::vector<char>> {
+        static constexpr uint32_t fixed_size = 0;
+
+        static void encode(writer &w, const std::vector<char> &v) {
+            w.varuint(uint32_t(v.size()));
+            w.write(v.data(), v.size());
+        }
+
+        static void decode(reader &r, std::vector<char> &v) {
+            uint32_t size = r.varuint();
+            r.check(size);
+            v.resize(size);
+            r.read(v.data(), size);
+        }
+    };
+
+    template<typename T>
+    struct codec<std::optional<T>> {
+        static constexpr uint32_t fixed_size = 0;
+
+        static void encode(writer &w, const std::optional<T> &v) {
+            w.put(char(v.has_value()));
+            if (v)
+                codec<T>::encode(w, *v);
+        }
+
+        static void decode(reader &r, std::optional<T> &v) {
+            if (r.get()) {
+                v.emplace();
+                codec<T>::decode(r, *v);
+            } else {
+                v.reset();
+            }
+        }
+    };
+
+    template<typename T>
+    struct codec<extension<T>> {
+        static constexpr uint32_t fixed_size = 0;
+
+        static void encode(writer &w, const extension<T> &v) {
+            if (v)
+                codec<T>::encode(w, *v);
+        }
+
+        static void decode(reader &r, extension<T> &v) {
+            if (r.remaining()) {
+                v.emplace();
+                codec<T>::decode(r, *v);
+            } else {
+                v.reset();
+            }
+        }
+    };
+
+    /**
+     * Append the encoding of v to out
+     */
+    template<typename T>
+    void pack(std::vector<char> &out, const T &v) {
+        writer w(out);
+        codec<T>::encode(w, v);
+    }
+
+    template<typename T>
+    std::vector<char> pack(const T &v) {
+        std::vector<char> out;
+        out.reserve(codec<T>::fixed_size ? codec<T>::fixed_size : 64);
+        pack(out, v);
+        return out;
+    }
+
+    /**
+     * Decode a T from the start of the buffer, throws std::out_of_range if the buffer is too short
+     */
+    template<typename T>
+    T unpack(const char *data, size_t size) {
+        T v{};
+        reader r(data, size);
+        codec<T>::decode(r, v);
+        return v;
+    }
+
+    template<typename T>
+    T unpack(const std::vector<char> &data) {
+        return unpack<T>(data.data(), data.size());
+    }
+} // namespace ftl_abi2cpp
+
+#endif // FTL_ABI2CPP_RUNTIME
+)=====";
+        }
+    };
+} // namespace ftl
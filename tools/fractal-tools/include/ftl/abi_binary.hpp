@@ -0,0 +1,476 @@
+#pragma once
+
+#include <jsoncons/json.hpp>
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ftl {
+   /**
+    * Compact binary form of the JSON ABI, embedded by fractal-ld in the ".ftl_abi" custom section.
+    *
+    * Layout, every count, index and length is a LEB128 varuint32:
+    *
+    *   "FABI" format_version
+    *   strings         count, then length + bytes of each interned name
+    *   version         string index
+    *   structs         count, then name, base + 1 (0 for none), fixed_size + 1 (0 if variable),
+    *                   field count and name/type of each field
+    *   types           count, then new_type_name/type of each typedef
+    *   actions         count, then name, type and flags of each action, followed by the counts
+    *                   and names of the tables it reads and writes when action_analyzed is set
+    *   tables          count, then name/key_type/value_type and flags of each table
+    *   error_messages  count, then varuint64 error_code and message of each entry
+    *
+    * fixed_size is the packed size of a struct whose fields (and base) all have a fixed size,
+    * so a reader can skip or copy values of that struct without walking its fields.
+    */
+   namespace abi_binary {
+      using jsoncons::ojson;
+
+      static const char     magic[4]       = {'F', 'A', 'B', 'I'};
+      static const uint8_t  format_version = 4;
+      static const char*    section_name   = ".ftl_abi";
+
+      static const uint32_t action_readonly  = 1;
+      static const uint32_t action_analyzed  = 2;
+      static const uint32_t action_calls     = 4;
+      static const uint32_t action_transfers = 8;
+
+      static const uint32_t table_flat    = 1;
+      static const uint32_t table_chunked = 2;
+      static const uint32_t table_vector  = 4;
+
+      class writer {
+         public:
+            void varuint(uint64_t v) {
+               do {
+                  uint8_t b = v & 0x7f;
+                  v >>= 7;
+                  out.push_back(char(v ? b | 0x80 : b));
+               } while (v);
+            }
+            void bytes(const std::string& s) { out += s; }
+            const std::string& str() const { return out; }
+         private:
+            std::string out;
+      };
+
+      class reader {
+         public:
+            reader(const char* data, size_t size) : pos(data), end(data+size) {}
+            uint64_t varuint(unsigned max_bits = 32) {
+               uint64_t v = 0;
+               for (unsigned shift = 0; ; shift += 7) {
+                  if (shift >= max_bits)
+                     throw std::runtime_error("binary abi: varuint too long");
+                  uint8_t b = byte();
+                  v |= uint64_t(b & 0x7f) << shift;
+                  if (!(b & 0x80))
+                     return v;
+               }
+            }
+            uint8_t byte() {
+               if (pos == end)
+                  throw std::runtime_error("binary abi: unexpected end of data");
+               return uint8_t(*pos++);
+            }
+            std::string bytes(size_t n) {
+               if (size_t(end - pos) < n)
+                  throw std::runtime_error("binary abi: unexpected end of data");
+               std::string s(pos, n);
+               pos += n;
+               return s;
+            }
+            bool done() const { return pos == end; }
+         private:
+            const char* pos;
+            const char* end;
+      };
+
+      /**
+       * Packed size of the builtin types with a fixed encoding, 0 for the variable ones
+       */
+      inline uint32_t builtin_size(const std::string& type) {
+         static const std::map<std::string, uint32_t> sizes = {
+            {"bool", 1}, {"int8", 1}, {"uint8", 1}, {"int16", 2}, {"uint16", 2},
+            {"int32", 4}, {"uint32", 4}, {"int64", 8}, {"uint64", 8},
+            {"int128", 16}, {"uint128", 16}, {"int256", 32}, {"uint256", 32},
+            {"float32", 4}, {"float64", 8}, {"float128", 16},
+            {"time_point", 8}, {"time_point_sec", 4}, {"block_timestamp_type", 4},
+            {"name", 8}, {"address", 20}, {"checksum160", 20}, {"checksum256", 32}, {"checksum512", 64}
+         };
+         auto it = sizes.find(type);
+         return it == sizes.end() ? 0 : it->second;
+      }
+
+      /**
+       * Computes the packed size of every struct of the abi that has one, recursing through
+       * bases, field structs and typedefs. Variable sized and recursive structs map to 0.
+       */
+      class size_calculator {
+         public:
+            explicit size_calculator(const ojson& abi) {
+               if (abi.has_key("structs")) {
+                  for (const auto& s : abi["structs"].array_range())
+                     structs[s["name"].as<std::string>()] = &s;
+               }
+               if (abi.has_key("types")) {
+                  for (const auto& t : abi["types"].array_range())
+                     typedefs[t["new_type_name"].as<std::string>()] = t["type"].as<std::string>();
+               }
+            }
+
+            uint32_t size_of(const std::string& type) {
+               if (type.empty())
+                  return 0;
+               char last = type.back();
+               if (last == ']' || last == '?' || last == '$')
+                  return 0;
+               auto td = typedefs.find(type);
+               if (td != typedefs.end() && td->second != type) {
+                  if (!resolving.insert(type).second)
+                     return 0;
+                  uint32_t r = size_of(td->second);
+                  resolving.erase(type);
+                  return r;
+               }
+               auto st = structs.find(type);
+               if (st == structs.end())
+                  return builtin_size(type);
+
+               auto memo = sizes.find(type);
+               if (memo != sizes.end())
+                  return memo->second;
+               if (!resolving.insert(type).second)
+                  return 0;
+               uint32_t total = 0;
+               bool fixed = true;
+               const ojson& s = *st->second;
+               std::string base = s.get_with_default("base", std::string());
+               if (!base.empty()) {
+                  uint32_t b = size_of(base);
+                  fixed = b != 0;
+                  total += b;
+               }
+               for (const auto& f : s["fields"].array_range()) {
+                  if (!fixed)
+                     break;
+                  uint32_t fs = size_of(f["type"].as<std::string>());
+                  fixed = fs != 0;
+                  total += fs;
+               }
+               resolving.erase(type);
+               return sizes[type] = fixed ? total : 0;
+            }
+
+         private:
+            std::map<std::string, const ojson*> structs;
+            std::map<std::string, std::string>  typedefs;
+            std::map<std::string, uint32_t>     sizes;
+            std::set<std::string>               resolving;
+      };
+
+      /**
+       * Encode a JSON abi (as produced by abigen::to_json) to its binary form
+       */
+      inline std::string encode(const ojson& abi) {
+         std::vector<std::string> strings;
+         std::map<std::string, uint32_t> index;
+         auto intern = [&](const std::string& s) {
+            auto it = index.find(s);
+            if (it != index.end())
+               return it->second;
+            uint32_t i = strings.size();
+            strings.push_back(s);
+            index.emplace(s, i);
+            return i;
+         };
+         auto str = [&](const ojson& o, const char* key) {
+            return intern(o.get_with_default(key, std::string()));
+         };
+
+         // body first, the string table is only complete once every name was interned
+         size_calculator sizes(abi);
+         writer body;
+         body.varuint(str(abi, "version"));
+
+         const ojson empty = ojson::array();
+         const ojson& structs = abi.has_key("structs") ? abi["structs"] : empty;
+         body.varuint(structs.size());
+         for (const auto& s : structs.array_range()) {
+            std::string name = s["name"].as<std::string>();
+            std::string base = s.get_with_default("base", std::string());
+            body.varuint(intern(name));
+            body.varuint(base.empty() ? 0 : intern(base) + 1);
+            uint32_t size = sizes.size_of(name);
+            body.varuint(size ? uint64_t(size) + 1 : 0);
+            body.varuint(s["fields"].size());
+            for (const auto& f : s["fields"].array_range()) {
+               body.varuint(str(f, "name"));
+               body.varuint(str(f, "type"));
+            }
+         }
+
+         const ojson& types = abi.has_key("types") ? abi["types"] : empty;
+         body.varuint(types.size());
+         for (const auto& t : types.array_range()) {
+            body.varuint(str(t, "new_type_name"));
+            body.varuint(str(t, "type"));
+         }
+
+         const ojson& actions = abi.has_key("actions") ? abi["actions"] : empty;
+         body.varuint(actions.size());
+         for (const auto& a : actions.array_range()) {
+            body.varuint(str(a, "name"));
+            body.varuint(str(a, "type"));
+            uint32_t flags = 0;
+            if (a.get_with_default("readonly", false))
+               flags |= action_readonly;
+            if (a.has_key("reads") || a.has_key("writes"))
+               flags |= action_analyzed;
+            if (a.get_with_default("calls", false))
+               flags |= action_calls;
+            if (a.get_with_default("transfers", false))
+               flags |= action_transfers;
+            body.varuint(flags);
+            if (flags & action_analyzed) {
+               for (const char* key : {"reads", "writes"}) {
+                  const ojson& tables = a.has_key(key) ? a[key] : empty;
+                  body.varuint(tables.size());
+                  for (const auto& t : tables.array_range())
+                     body.varuint(intern(t.as<std::string>()));
+               }
+            }
+         }
+
+         const ojson& tables = abi.has_key("tables") ? abi["tables"] : empty;
+         body.varuint(tables.size());
+         for (const auto& t : tables.array_range()) {
+            body.varuint(str(t, "name"));
+            body.varuint(str(t, "key_type"));
+            body.varuint(str(t, "value_type"));
+            std::string encoding = t.get_with_default("encoding", std::string());
+            body.varuint(encoding == "flat" ? table_flat : encoding == "chunked" ? table_chunked :
+                         encoding == "vector" ? table_vector : 0);
+         }
+
+         const ojson& errors = abi.has_key("error_messages") ? abi["error_messages"] : empty;
+         body.varuint(errors.size());
+         for (const auto& e : errors.array_range()) {
+            body.varuint(e["error_code"].as<uint64_t>());
+            body.varuint(str(e, "error_msg"));
+         }
+
+         writer out;
+         out.bytes(std::string(magic, sizeof(magic)));
+         out.bytes(std::string(1, char(format_version)));
+         out.varuint(strings.size());
+         for (const auto& s : strings) {
+            out.varuint(s.size());
+            out.bytes(s);
+         }
+         out.bytes(body.str());
+         return out.str();
+      }
+
+      /**
+       * Decode a binary abi back to the JSON form, fixed_size is only emitted when requested
+       */
+      inline ojson decode(const char* data, size_t size, bool with_sizes = false) {
+         reader in(data, size);
+         if (in.bytes(sizeof(magic)) != std::string(magic, sizeof(magic)))
+            throw std::runtime_error("binary abi: bad magic");
+         if (in.byte() != format_version)
+            throw std::runtime_error("binary abi: unsupported format version");
+
+         std::vector<std::string> strings(in.varuint());
+         for (auto& s : strings)
+            s = in.bytes(in.varuint());
+         auto str = [&]() -> const std::string& {
+            uint64_t i = in.varuint();
+            if (i >= strings.size())
+               throw std::runtime_error("binary abi: string index out of range");
+            return strings[i];
+         };
+
+         ojson o;
+         o["version"] = str();
+
+         o["structs"] = ojson::array();
+         for (uint64_t n = in.varuint(); n; n--) {
+            ojson s;
+            s["name"] = str();
+            uint64_t base = in.varuint();
+            if (base > strings.size())
+               throw std::runtime_error("binary abi: string index out of range");
+            s["base"] = base ? strings[base - 1] : std::string();
+            uint64_t fixed_size = in.varuint();
+            if (with_sizes && fixed_size)
+               s["fixed_size"] = fixed_size - 1;
+            s["fields"] = ojson::array();
+            for (uint64_t m = in.varuint(); m; m--) {
+               ojson f;
+               f["name"] = str();
+               f["type"] = str();
+               s["fields"].push_back(f);
+            }
+            o["structs"].push_back(s);
+         }
+
+         o["types"] = ojson::array();
+         for (uint64_t n = in.varuint(); n; n--) {
+            ojson t;
+            t["new_type_name"] = str();
+            t["type"] = str();
+            o["types"].push_back(t);
+         }
+
+         o["actions"] = ojson::array();
+         for (uint64_t n = in.varuint(); n; n--) {
+            ojson a;
+            a["name"] = str();
+            a["type"] = str();
+            uint64_t flags = in.varuint();
+            if (flags & action_readonly)
+               a["readonly"] = true;
+            if (flags & action_analyzed) {
+               for (const char* key : {"reads", "writes"}) {
+                  a[key] = ojson::array();
+                  for (uint64_t m = in.varuint(); m; m--)
+                     a[key].push_back(str());
+               }
+               a["calls"] = bool(flags & action_calls);
+               a["transfers"] = bool(flags & action_transfers);
+            }
+            o["actions"].push_back(a);
+         }
+
+         o["tables"] = ojson::array();
+         for (uint64_t n = in.varuint(); n; n--) {
+            ojson t;
+            t["name"] = str();
+            t["key_type"] = str();
+            t["value_type"] = str();
+            uint64_t flags = in.varuint();
+            if (flags & table_flat)
+               t["encoding"] = "flat";
+            else if (flags & table_chunked)
+               t["encoding"] = "chunked";
+            else if (flags & table_vector)
+               t["encoding"] = "vector";
+            o["tables"].push_back(t);
+         }
+
+         uint64_t errors = in.varuint();
+         if (errors) {
+            o["error_messages"] = ojson::array();
+            for (; errors; errors--) {
+               ojson e;
+               e["error_code"] = in.varuint(64);
+               e["error_msg"] = str();
+               o["error_messages"].push_back(e);
+            }
+         }
+
+         if (!in.done())
+            throw std::runtime_error("binary abi: trailing data");
+         return o;
+      }
+
+      inline ojson decode(const std::string& bin, bool with_sizes = false) {
+         return decode(bin.data(), bin.size(), with_sizes);
+      }
+
+      /**
+       * Add the entries of `from` missing in `into`, entries are keyed by their name and error messages by
+       * their code, throws when both give a code different messages
+       */
+      inline void merge(ojson& into, const ojson& from) {
+         auto merge_array = [&](const char* key, const char* name_key) {
+            if (!from.has_key(key))
+               return;
+            if (!into.has_key(key))
+               into[key] = ojson::array();
+            std::set<std::string> names;
+            for (const auto& e : into[key].array_range())
+               names.insert(e[name_key].as<std::string>());
+            for (const auto& e : from[key].array_range()) {
+               if (names.insert(e[name_key].as<std::string>()).second)
+                  into[key].push_back(e);
+            }
+         };
+         if (!into.has_key("version") && from.has_key("version"))
+            into["version"] = from["version"];
+         merge_array("structs", "name");
+         merge_array("types", "new_type_name");
+         merge_array("actions", "name");
+         merge_array("tables", "name");
+         if (from.has_key("error_messages")) {
+            if (!into.has_key("error_messages"))
+               into["error_messages"] = ojson::array();
+            // the codes are message hashes, two objects can give different messages the same one
+            std::map<uint64_t, std::string> codes;
+            for (const auto& e : into["error_messages"].array_range())
+               codes.emplace(e["error_code"].as<uint64_t>(), e["error_msg"].as<std::string>());
+            for (const auto& e : from["error_messages"].array_range()) {
+               uint64_t code = e["error_code"].as<uint64_t>();
+               std::string msg = e["error_msg"].as<std::string>();
+               auto it = codes.emplace(code, msg);
+               if (it.second)
+                  into["error_messages"].push_back(e);
+               else if (it.first->second != msg)
+                  throw std::runtime_error("error code " + std::to_string(code) + " stands for both \"" +
+                                           it.first->second + "\" and \"" + msg + "\"");
+            }
+         }
+      }
+
+      /**
+       * A complete wasm custom section named ".ftl_abi" whose payload is the binary abi as a
+       * length prefixed string, the layout WasmObjectFile::parseFtlABISection expects
+       */
+      inline std::string custom_section(const std::string& bin) {
+         writer payload;
+         std::string name(section_name);
+         payload.varuint(name.size());
+         payload.bytes(name);
+         payload.varuint(bin.size());
+         payload.bytes(bin);
+
+         writer section;
+         section.bytes(std::string(1, '\0'));
+         section.varuint(payload.str().size());
+         section.bytes(payload.str());
+         return section.str();
+      }
+
+      /**
+       * Find the ".ftl_abi" section of a wasm module and extract the binary abi
+       *
+       * @return false if the module has no such section
+       */
+      inline bool find_section(const std::string& wasm, std::string& bin) {
+         if (wasm.size() < 8 || wasm.compare(0, 4, std::string("\0asm", 4)) != 0)
+            throw std::runtime_error("not a wasm module");
+         reader in(wasm.data() + 8, wasm.size() - 8);
+         while (!in.done()) {
+            uint8_t id = in.byte();
+            std::string content = in.bytes(in.varuint());
+            if (id != 0)
+               continue;
+            reader sec(content.data(), content.size());
+            std::string name = sec.bytes(sec.varuint());
+            if (name != section_name)
+               continue;
+            bin = sec.bytes(sec.varuint());
+            return true;
+         }
+         return false;
+      }
+   } // namespace abi_binary
+} // namespace ftl
@@ -0,0 +1,483 @@
+#pragma once
+
+#include <ftl/utils.hpp>
+
+#include <jsoncons/json.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ftl {
+    using jsoncons::ojson;
+
+    /**
+     * Converts between JSON values and the ftl::datastream encoding of the types of an abi.
+     *
+     * The abi is compiled once into a table of type nodes (typedefs resolved, struct bases flattened
+     * into their fields), encode and decode only walk that table. They are const and can be called
+     * from several threads at once.
+     *
+     * JSON mapping: integers up to 64 bits, floats and varuint32 are numbers (strings are accepted on
+     * input), 128-bit integers are decimal strings, name is its string form, address, checksum256,
+     * int256, uint256 and bytes are hex strings, optionals are null or the value, structs are objects.
+     */
+    class abi_codec {
+    public:
+        explicit abi_codec(const ojson &abi) {
+            if (abi.has_key("types")) {
+                for (const auto &t : abi["types"].array_range())
+                    typedefs[t["new_type_name"].as<std::string>()] = t["type"].as<std::string>();
+            }
+            if (abi.has_key("structs")) {
+                for (const auto &s : abi["structs"].array_range())
+                    structs[s["name"].as<std::string>()] = &s;
+            }
+            if (abi.has_key("actions")) {
+                for (const auto &a : abi["actions"].array_range())
+                    actions[a["name"].as<std::string>()] = a["type"].as<std::string>();
+            }
+            // compile everything up front, after construction the codec is read only
+            for (const auto &s : structs)
+                type(s.first);
+            for (const auto &t : typedefs)
+                type(t.first);
+            for (const auto &a : actions)
+                type(a.second);
+            structs.clear();
+        }
+
+        /**
+         * Id of an abi type, e.g. "order", "uint64[]" or "name?"
+         */
+        uint32_t type(const std::string &name) {
+            auto it = ids.find(name);
+            if (it != ids.end())
+                return it->second;
+            return compile(name);
+        }
+
+        /**
+         * Id of the argument struct of an action
+         */
+        uint32_t action_type(const std::string &action) {
+            auto it = actions.find(action);
+            if (it == actions.end())
+                throw std::runtime_error("unknown action " + action);
+            return type(it->second);
+        }
+
+        void encode(uint32_t type, const ojson &value, std::string &out) const {
+            encode_node(nodes[type], value, out);
+        }
+
+        ojson decode(uint32_t type, const char *data, size_t size) const {
+            reader r{data, data + size};
+            ojson value = decode_node(nodes[type], r);
+            if (r.pos != r.end)
+                throw std::runtime_error("unexpected data after the value");
+            return value;
+        }
+
+    private:
+        using uint128 = unsigned __int128;
+
+        enum class kind : uint8_t {
+            boolean, int8, uint8, int16, uint16, int32, uint32, int64, uint64, int128, uint128,
+            float32, float64, varuint32, name, string, bytes, fixed_bytes, array, optional, extension, structure
+        };
+
+        struct field {
+            std::string name;
+            uint32_t type;
+        };
+
+        struct node {
+            kind k;
+            std::string name;
+            uint32_t size = 0;      // fixed_bytes
+            uint32_t element = 0;   // array, optional, extension
+            std::vector<field> fields;
+        };
+
+        struct reader {
+            const char *pos;
+            const char *end;
+
+            void read(void *d, size_t s) {
+                if (size_t(end - pos) < s)
+                    throw std::runtime_error("read past the end of the data");
+                memcpy(d, pos, s);
+                pos += s;
+            }
+
+            uint32_t varuint() {
+                uint64_t v = 0;
+                for (int shift = 0; shift < 35; shift += 7) {
+                    uint8_t b;
+                    read(&b, 1);
+                    v |= uint64_t(b & 0x7f) << shift;
+                    if (!(b & 0x80) && v <= 0xffffffffu)
+                        return uint32_t(v);
+                    if (!(b & 0x80))
+                        break;
+                }
+                throw std::runtime_error("invalid varuint32");
+            }
+        };
+
+        std::vector<node> nodes;
+        std::map<std::string, uint32_t> ids;
+        std::map<std::string, std::string> typedefs;
+        std::map<std::string, std::string> actions;
+        std::map<std::string, const ojson *> structs;
+
+        uint32_t add(const std::string &name, node n) {
+            n.name = name;
+            nodes.push_back(std::move(n));
+            ids[name] = nodes.size() - 1;
+            return nodes.size() - 1;
+        }
+
+        uint32_t compile(const std::string &name) {
+            static const std::map<std::string, std::pair<kind, uint32_t>> builtins = {
+                    {"bool",        {kind::boolean,     0}},
+                    {"int8",        {kind::int8,        0}},
+                    {"uint8",       {kind::uint8,       0}},
+                    {"int16",       {kind::int16,       0}},
+                    {"uint16",      {kind::uint16,      0}},
+                    {"int32",       {kind::int32,       0}},
+                    {"uint32",      {kind::uint32,      0}},
+                    {"int64",       {kind::int64,       0}},
+                    {"uint64",      {kind::uint64,      0}},
+                    {"int128",      {kind::int128,      0}},
+                    {"uint128",     {kind::uint128,     0}},
+                    {"float32",     {kind::float32,     0}},
+                    {"float64",     {kind::float64,     0}},
+                    {"varuint32",   {kind::varuint32,   0}},
+                    {"name",        {kind::name,        0}},
+                    {"string",      {kind::string,      0}},
+                    {"bytes",       {kind::bytes,       0}},
+                    {"address",     {kind::fixed_bytes, 20}},
+                    {"checksum256", {kind::fixed_bytes, 32}},
+                    {"int256",      {kind::fixed_bytes, 32}},
+                    {"uint256",     {kind::fixed_bytes, 32}},
+            };
+
+            node n;
+            if (name.size() > 2 && name.compare(name.size() - 2, 2, "[]") == 0) {
+                n.k = kind::array;
+                n.element = type(name.substr(0, name.size() - 2));
+                return add(name, n);
+            }
+            if (!name.empty() && (name.back() == '?' || name.back() == '$')) {
+                n.k = name.back() == '?' ? kind::optional : kind::extension;
+                n.element = type(name.substr(0, name.size() - 1));
+                return add(name, n);
+            }
+            auto td = typedefs.find(name);
+            if (td != typedefs.end() && td->second != name) {
+                uint32_t id = type(td->second);
+                ids[name] = id;
+                return id;
+            }
+            auto st = structs.find(name);
+            if (st != structs.end()) {
+                // registered before the fields so recursive structs resolve to themselves
+                n.k = kind::structure;
+                uint32_t id = add(name, n);
+                const ojson &s = *st->second;
+                std::vector<field> fields;
+                std::string base = s.get_with_default("base", std::string());
+                if (!base.empty()) {
+                    uint32_t base_id = type(base);
+                    if (nodes[base_id].k != kind::structure)
+                        throw std::runtime_error("base of " + name + " is not a struct");
+                    fields = nodes[base_id].fields;
+                }
+                for (const auto &f : s["fields"].array_range())
+                    fields.push_back({f["name"].as<std::string>(), type(f["type"].as<std::string>())});
+                nodes[id].fields = std::move(fields);
+                return id;
+            }
+            auto b = builtins.find(name);
+            if (b == builtins.end())
+                throw std::runtime_error("unknown type " + name);
+            n.k = b->second.first;
+            n.size = b->second.second;
+            return add(name, n);
+        }
+
+        static void write_varuint(uint32_t v, std::string &out) {
+            do {
+                uint8_t b = v & 0x7f;
+                v >>= 7;
+                out.push_back(char(v ? b | 0x80 : b));
+            } while (v);
+        }
+
+        template<typename T>
+        static void write_raw(const T &v, std::string &out) {
+            out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+        }
+
+        static uint64_t parse_u64(const std::string &s) {
+            if (s.empty() || s.size() > 20 || s.find_first_not_of("0123456789") != std::string::npos)
+                throw std::runtime_error("invalid integer " + s);
+            return std::stoull(s);
+        }
+
+        static int64_t to_int(const ojson &v, int64_t min, int64_t max) {
+            int64_t r;
+            if (v.is_integer())
+                r = v.as<int64_t>();
+            else if (v.is_uinteger() && v.as<uint64_t>() <= uint64_t(INT64_MAX))
+                r = int64_t(v.as<uint64_t>());
+            else if (v.is_string() && !v.as<std::string>().empty() && v.as<std::string>()[0] == '-')
+                r = -int64_t(parse_u64(v.as<std::string>().substr(1)));
+            else if (v.is_string())
+                r = int64_t(parse_u64(v.as<std::string>()));
+            else
+                throw std::runtime_error("expected an integer, got " + v.to_string());
+            if (r < min || r > max)
+                throw std::runtime_error("integer out of range " + v.to_string());
+            return r;
+        }
+
+        static uint64_t to_uint(const ojson &v, uint64_t max) {
+            uint64_t r;
+            if (v.is_uinteger())
+                r = v.as<uint64_t>();
+            else if (v.is_integer() && v.as<int64_t>() >= 0)
+                r = uint64_t(v.as<int64_t>());
+            else if (v.is_string())
+                r = parse_u64(v.as<std::string>());
+            else
+                throw std::runtime_error("expected an unsigned integer, got " + v.to_string());
+            if (r > max)
+                throw std::runtime_error("integer out of range " + v.to_string());
+            return r;
+        }
+
+        static uint128 parse_u128(const std::string &s) {
+            if (s.empty() || s.size() > 39 || s.find_first_not_of("0123456789") != std::string::npos)
+                throw std::runtime_error("invalid integer " + s);
+            uint128 r = 0;
+            for (char c : s) {
+                unsigned digit = unsigned(c - '0');
+                if (r > (~uint128(0) - digit) / 10)
+                    throw std::runtime_error("integer out of range " + s);
+                r = r * 10 + digit;
+            }
+            return r;
+        }
+
+        static std::string u128_to_string(uint128 v) {
+            char buffer[40];
+            int pos = sizeof(buffer);
+            do {
+                buffer[--pos] = char('0' + unsigned(v % 10));
+                v /= 10;
+            } while (v);
+            return std::string(buffer + pos, sizeof(buffer) - pos);
+        }
+
+        static std::string to_hex(const char *d, size_t s) {
+            static const char digits[] = "0123456789abcdef";
+            std::string r(s * 2, '0');
+            for (size_t i = 0; i < s; i++) {
+                r[2 * i] = digits[uint8_t(d[i]) >> 4];
+                r[2 * i + 1] = digits[uint8_t(d[i]) & 0xf];
+            }
+            return r;
+        }
+
+        static void from_hex(const std::string &hex, std::string &out) {
+            auto nibble = [&](char c) -> uint8_t {
+                if (c >= '0' && c <= '9') return c - '0';
+                if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+                if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+                throw std::runtime_error("invalid hex string " + hex);
+            };
+            if (hex.size() % 2)
+                throw std::runtime_error("odd length hex string " + hex);
+            for (size_t i = 0; i < hex.size(); i += 2)
+                out.push_back(char((nibble(hex[i]) << 4) | nibble(hex[i + 1])));
+        }
+
+        static std::string name_to_string(uint64_t value) {
+            static const char *charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+            std::string str(13, '.');
+            for (uint32_t i = 0; i <= 12; ++i) {
+                str[12 - i] = charmap[value & (i == 0 ? 0x0f : 0x1f)];
+                value >>= (i == 0 ? 4 : 5);
+            }
+            str.erase(str.find_last_not_of('.') + 1);
+            return str;
+        }
+
+        void encode_node(const node &n, const ojson &v, std::string &out) const {
+            switch (n.k) {
+                case kind::boolean:
+                    if (!v.is_bool())
+                        throw std::runtime_error("expected a bool, got " + v.to_string());
+                    out.push_back(char(v.as<bool>()));
+                    break;
+                case kind::int8:    write_raw(int8_t(to_int(v, INT8_MIN, INT8_MAX)), out); break;
+                case kind::uint8:   write_raw(uint8_t(to_uint(v, UINT8_MAX)), out); break;
+                case kind::int16:   write_raw(int16_t(to_int(v, INT16_MIN, INT16_MAX)), out); break;
+                case kind::uint16:  write_raw(uint16_t(to_uint(v, UINT16_MAX)), out); break;
+                case kind::int32:   write_raw(int32_t(to_int(v, INT32_MIN, INT32_MAX)), out); break;
+                case kind::uint32:  write_raw(uint32_t(to_uint(v, UINT32_MAX)), out); break;
+                case kind::int64:   write_raw(int64_t(to_int(v, INT64_MIN, INT64_MAX)), out); break;
+                case kind::uint64:  write_raw(uint64_t(to_uint(v, UINT64_MAX)), out); break;
+                case kind::varuint32: write_varuint(uint32_t(to_uint(v, UINT32_MAX)), out); break;
+                case kind::float32: write_raw(float(v.as<double>()), out); break;
+                case kind::float64: write_raw(v.as<double>(), out); break;
+                case kind::int128:
+                case kind::uint128: {
+                    std::string s = v.is_string() ? v.as<std::string>() : v.to_string();
+                    bool negative = n.k == kind::int128 && !s.empty() && s[0] == '-';
+                    uint128 m = parse_u128(negative ? s.substr(1) : s);
+                    uint128 limit = n.k == kind::int128 ? uint128(1) << 127 : 0;
+                    if (n.k == kind::int128 && (negative ? m > limit : m >= limit))
+                        throw std::runtime_error("integer out of range " + s);
+                    write_raw(negative ? uint128(0) - m : m, out);
+                    break;
+                }
+                case kind::name: {
+                    std::string s = v.as<std::string>();
+                    uint64_t value = ftl::string_to_name(s.c_str());
+                    if (name_to_string(value) != s)
+                        throw std::runtime_error("invalid name " + s);
+                    write_raw(value, out);
+                    break;
+                }
+                case kind::string: {
+                    if (!v.is_string())
+                        throw std::runtime_error("expected a string, got " + v.to_string());
+                    auto s = v.as_string_view();
+                    write_varuint(uint32_t(s.size()), out);
+                    out.append(s.data(), s.size());
+                    break;
+                }
+                case kind::bytes: {
+                    std::string b;
+                    from_hex(v.as<std::string>(), b);
+                    write_varuint(uint32_t(b.size()), out);
+                    out += b;
+                    break;
+                }
+                case kind::fixed_bytes: {
+                    size_t start = out.size();
+                    from_hex(v.as<std::string>(), out);
+                    if (out.size() - start != n.size)
+                        throw std::runtime_error(n.name + " must be " + std::to_string(n.size) + " bytes");
+                    break;
+                }
+                case kind::array:
+                    if (!v.is_array())
+                        throw std::runtime_error("expected an array for " + n.name);
+                    write_varuint(uint32_t(v.size()), out);
+                    for (const auto &e : v.array_range())
+                        encode_node(nodes[n.element], e, out);
+                    break;
+                case kind::optional:
+                    out.push_back(char(!v.is_null()));
+                    if (!v.is_null())
+                        encode_node(nodes[n.element], v, out);
+                    break;
+                case kind::extension:
+                    encode_node(nodes[n.element], v, out);
+                    break;
+                case kind::structure:
+                    if (!v.is_object())
+                        throw std::runtime_error("expected an object for " + n.name);
+                    for (const auto &f : n.fields) {
+                        if (!v.has_key(f.name)) {
+                            // binary extensions are trailing, a missing one ends the struct
+                            if (nodes[f.type].k == kind::extension)
+                                break;
+                            throw std::runtime_error("missing field " + n.name + "." + f.name);
+                        }
+                        encode_node(nodes[f.type], v[f.name], out);
+                    }
+                    break;
+            }
+        }
+
+        template<typename T>
+        static T read_raw(reader &r) {
+            T v;
+            r.read(&v, sizeof(T));
+            return v;
+        }
+
+        ojson decode_node(const node &n, reader &r) const {
+            switch (n.k) {
+                case kind::boolean: return ojson(read_raw<uint8_t>(r) != 0);
+                case kind::int8:    return ojson(int64_t(read_raw<int8_t>(r)));
+                case kind::uint8:   return ojson(uint64_t(read_raw<uint8_t>(r)));
+                case kind::int16:   return ojson(int64_t(read_raw<int16_t>(r)));
+                case kind::uint16:  return ojson(uint64_t(read_raw<uint16_t>(r)));
+                case kind::int32:   return ojson(int64_t(read_raw<int32_t>(r)));
+                case kind::uint32:  return ojson(uint64_t(read_raw<uint32_t>(r)));
+                case kind::int64:   return ojson(read_raw<int64_t>(r));
+                case kind::uint64:  return ojson(read_raw<uint64_t>(r));
+                case kind::varuint32: return ojson(uint64_t(r.varuint()));
+                case kind::float32: return ojson(double(read_raw<float>(r)));
+                case kind::float64: return ojson(read_raw<double>(r));
+                case kind::int128: {
+                    __int128 v = read_raw<__int128>(r);
+                    return v < 0 ? ojson("-" + u128_to_string(uint128(0) - uint128(v)))
+                                 : ojson(u128_to_string(uint128(v)));
+                }
+                case kind::uint128: return ojson(u128_to_string(read_raw<uint128>(r)));
+                case kind::name:    return ojson(name_to_string(read_raw<uint64_t>(r)));
+                case kind::string:
+                case kind::bytes: {
+                    uint32_t size = r.varuint();
+                    if (size_t(r.end - r.pos) < size)
+                        throw std::runtime_error("read past the end of the data");
+                    const char *d = r.pos;
+                    r.pos += size;
+                    return n.k == kind::string ? ojson(std::string(d, size)) : ojson(to_hex(d, size));
+                }
+                case kind::fixed_bytes: {
+                    if (size_t(r.end - r.pos) < n.size)
+                        throw std::runtime_error("read past the end of the data");
+                    const char *d = r.pos;
+                    r.pos += n.size;
+                    return ojson(to_hex(d, n.size));
+                }
+                case kind::array: {
+                    uint32_t size = r.varuint();
+                    ojson a = ojson::array();
+                    a.reserve(std::min<size_t>(size, r.end - r.pos));
+                    for (uint32_t i = 0; i < size; i++)
+                        a.push_back(decode_node(nodes[n.element], r));
+                    return a;
+                }
+                case kind::optional:
+                    if (read_raw<uint8_t>(r))
+                        return decode_node(nodes[n.element], r);
+                    return ojson::null();
+                case kind::extension:
+                    return decode_node(nodes[n.element], r);
+                case kind::structure: {
+                    ojson o;
+                    for (const auto &f : n.fields) {
+                        if (r.pos == r.end && nodes[f.type].k == kind::extension)
+                            break;
+                        o[f.name] = decode_node(nodes[f.type], r);
+                    }
+                    return o;
+                }
+            }
+            throw std::runtime_error("invalid type node");
+        }
+    };
+} // namespace ftl
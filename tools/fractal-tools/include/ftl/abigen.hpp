@@ -6,6 +6,10 @@
 #include <ftl/whereami/whereami.hpp>
 #include <ftl/abi.hpp>
 
+#include "clang/AST/RecordLayout.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+
+#include <deque>
 #include <exception>
 #include <iostream>
 #include <fstream>
@@ -13,6 +17,8 @@
 #include <memory>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <jsoncons/json.hpp>
 
@@ -28,6 +34,237 @@ namespace ftl {
         }
     };
 
+    /**
+     * What an action can reach: the tables it reads and writes, whether it transfers or calls another
+     * contract, the shortest call chain to its first state change and to its first call that can't be
+     * followed
+     */
+    struct action_effects {
+        std::set<std::string> reads;
+        std::set<std::string> writes;
+        bool calls = false;
+        bool transfers = false;
+        std::vector<const clang::FunctionDecl *> state_change;
+        std::vector<const clang::FunctionDecl *> unresolved;
+    };
+
+    /**
+     * Walks the call graph of an action, following direct calls, constructors and destructors of locals
+     * through every body available in the translation unit. ftl::table methods are recorded with the
+     * table name bound in their type and not entered, db imports or ftl::runtime functions reached any
+     * other way record the table as "*". A function without a body in the unit, other than the standard
+     * library, the C library and the parts of ftl_rt known not to touch state, and any call through a
+     * function pointer or a virtual method can do anything: it reads and writes "*" and calls other contracts.
+     */
+    class action_analyzer : public clang::RecursiveASTVisitor<action_analyzer> {
+    public:
+        action_effects analyze(const clang::FunctionDecl *root) {
+            action_effects effects;
+            std::map<const clang::FunctionDecl *, const clang::FunctionDecl *> caller;
+            std::deque<const clang::FunctionDecl *> queue;
+            root = root->getCanonicalDecl();
+            caller[root] = nullptr;
+            queue.push_back(root);
+            while (!queue.empty()) {
+                const clang::FunctionDecl *decl = queue.front();
+                queue.pop_front();
+                bool leaf = true;
+                if (record_effect(decl, effects)) {
+                    if (effects.state_change.empty())
+                        for (auto d = decl; d; d = caller[d])
+                            effects.state_change.insert(effects.state_change.begin(), d);
+                } else if (!is_table_method(decl) && !decl->isFtlWasmImport()) {
+                    leaf = false;
+                }
+                const clang::FunctionDecl *def = nullptr;
+                if (leaf)
+                    continue;
+                if (!decl->hasBody(def)) {
+                    if (!is_stateless_external(decl)) { std::cerr << "DBG " << decl->getQualifiedNameAsString() << " tsk=" << decl->getTemplateSpecializationKind() << " tmpl=" << (decl->getPrimaryTemplate()!=nullptr) << " dep=" << decl->isDependentContext() << " loc=" << decl->getLocation().printToString(decl->getASTContext().getSourceManager()) << std::endl; }
+                    if (!is_stateless_external(decl))
+                        record_unresolved(decl, caller, effects);
+                    continue;
+                }
+                callees.clear();
+                indirect = false;
+                TraverseStmt(def->getBody());
+                if (indirect)
+                    record_unresolved(decl, caller, effects);
+                for (auto callee : callees) {
+                    callee = callee->getCanonicalDecl();
+                    if (caller.emplace(callee, decl).second)
+                        queue.push_back(callee);
+                }
+            }
+            return effects;
+        }
+
+        bool VisitCallExpr(clang::CallExpr *expr) {
+            // p->~T() of a scalar T calls nothing
+            if (llvm::isa<clang::CXXPseudoDestructorExpr>(expr->getCallee()->IgnoreParens()))
+                return true;
+            auto callee = expr->getDirectCallee();
+            if (!callee) {
+                indirect = true;
+                return true;
+            }
+            callees.push_back(callee);
+            if (auto call = llvm::dyn_cast<clang::CXXMemberCallExpr>(expr)) {
+                auto method = call->getMethodDecl();
+                auto member = llvm::dyn_cast<clang::MemberExpr>(call->getCallee()->IgnoreParens());
+                // an override can run instead, unless the call is qualified or nothing can override it
+                if (method && method->isVirtual() && !(member && member->hasQualifier()) &&
+                    !method->hasAttr<clang::FinalAttr>() && !method->getParent()->hasAttr<clang::FinalAttr>())
+                    indirect = true;
+            }
+            return true;
+        }
+
+        bool VisitCXXConstructExpr(clang::CXXConstructExpr *expr) {
+            callees.push_back(expr->getConstructor());
+            return true;
+        }
+
+        bool VisitVarDecl(clang::VarDecl *decl) {
+            auto record = decl->getType()->getAsCXXRecordDecl();
+            if (record && record->hasDefinition())
+                if (auto dtor = record->getDestructor())
+                    callees.push_back(dtor);
+            return true;
+        }
+
+        bool shouldVisitImplicitCode() const { return true; }
+
+    private:
+        static const clang::ClassTemplateSpecializationDecl *table_of(const clang::FunctionDecl *decl) {
+            auto spec = llvm::dyn_cast<clang::ClassTemplateSpecializationDecl>(decl->getDeclContext());
+            if (!spec)
+                return nullptr;
+            std::string name = spec->getQualifiedNameAsString();
+            if (name != "ftl::table" && name != "ftl::flat_table" && name != "ftl::blob_table" &&
+                name != "ftl::vector_table")
+                return nullptr;
+            return spec;
+        }
+
+        static bool is_table_method(const clang::FunctionDecl *decl) { return table_of(decl) != nullptr; }
+
+        /**
+         * Functions that are called without a body in the unit but can't reach state: compiler builtins,
+         * trivial or defaulted members, the standard library, the C library and ftl_rt functions
+         * whose table is recorded by the caller or that touch no table
+         */
+        static bool is_stateless_external(const clang::FunctionDecl *decl) {
+            if (decl->getBuiltinID() || decl->isTrivial() || decl->isDefaulted() ||
+                decl->getDeclContext()->getEnclosingNamespaceContext()->isStdNamespace())
+                return true;
+            std::string qualified = decl->getQualifiedNameAsString();
+            static const std::set<std::string> known = {
+                    "malloc", "calloc", "realloc", "free", "memcpy", "memmove", "memset", "memcmp", "strlen",
+                    "strcmp", "strncmp", "abort",
+                    "ftl::runtime::unpack_bytes", "ftl::runtime::read_action", "ftl::runtime::set_result",
+                    "ftl::runtime::pack_call",
+            };
+            if (known.count(qualified))
+                return true;
+            // the C library only prints
+            if (decl->isExternC() && in_libc(decl))
+                return true;
+            // the streams of blob_table::reader and writer, which record the table
+            auto spec = llvm::dyn_cast<clang::ClassTemplateSpecializationDecl>(decl->getDeclContext());
+            if (spec && spec->getQualifiedNameAsString() == "ftl::datastream") {
+                auto tag = spec->getTemplateArgs()[0].getAsType()->getAsCXXRecordDecl();
+                if (tag && (tag->getQualifiedNameAsString() == "ftl::blob_source" ||
+                            tag->getQualifiedNameAsString() == "ftl::blob_sink"))
+                    return true;
+            }
+            return false;
+        }
+
+        static bool in_libc(const clang::FunctionDecl *decl) {
+            const auto &sm = decl->getASTContext().getSourceManager();
+            std::string file = sm.getFilename(sm.getSpellingLoc(decl->getLocation())).str();
+            return file.find("/libc/") != std::string::npos;
+        }
+
+        /**
+         * decl has no body to follow or makes a call that can't be followed
+         */
+        static void record_unresolved(const clang::FunctionDecl *decl,
+                                      std::map<const clang::FunctionDecl *, const clang::FunctionDecl *> &caller,
+                                      action_effects &effects) {
+            effects.reads.insert("*");
+            effects.writes.insert("*");
+            effects.calls = true;
+            if (effects.unresolved.empty())
+                for (auto d = decl; d; d = caller[d])
+                    effects.unresolved.insert(effects.unresolved.begin(), d);
+        }
+
+        /**
+         * Records what a table method or host import does, returns true if it changes state
+         */
+        static bool record_effect(const clang::FunctionDecl *decl, action_effects &effects) {
+            std::string name = decl->getNameAsString();
+            if (auto spec = table_of(decl)) {
+                const auto &arg = spec->getTemplateArgs()[0];
+                std::string table = arg.getKind() == clang::TemplateArgument::Integral
+                                    ? name_to_string(arg.getAsIntegral().getZExtValue()) : "*";
+                // these load the value or the vector size they change
+                bool loads = name == "set_field" || name == "writer" || name == "push_back" || name == "set" ||
+                             name == "pop_back" || name == "truncate";
+                if (loads)
+                    effects.reads.insert(table);
+                if (loads || name == "put" || name == "put_flat" || name == "erase") {
+                    effects.writes.insert(table);
+                    return true;
+                }
+                if (name == "get" || name == "get_field" || name == "get_lazy" || name == "get_flat" ||
+                    name == "read" || name == "reader" || name == "size" || name == "empty" || name == "back" ||
+                    name == "get_range" || name == "has_key")
+                    effects.reads.insert(table);
+                return false;
+            }
+            // the shared runtime (ftllib/runtime.hpp) is built into ftl_rt, its bodies are not in the unit
+            std::string qualified = decl->getQualifiedNameAsString();
+            if (qualified == "ftl::runtime::table_store") {
+                effects.writes.insert("*");
+                return true;
+            }
+            if (qualified == "ftl::runtime::table_load") {
+                effects.reads.insert("*");
+                return false;
+            }
+            if (qualified == "ftl::runtime::call_action" || qualified == "ftl::runtime::call_action_result" ||
+                qualified == "ftl::runtime::multi_call") {
+                effects.calls = true;
+                return true;
+            }
+            if (!decl->isFtlWasmImport())
+                return false;
+            if (name == "db_store" || name == "db_remove_key" || name == "db_remove_table") {
+                effects.writes.insert("*");
+                return true;
+            }
+            if (name == "db_load" || name == "db_has_key" || name == "db_has_table") {
+                effects.reads.insert("*");
+                return false;
+            }
+            if (name == "call_action" || name == "call_action_result" || name == "multi_call") {
+                effects.calls = true;
+                return true;
+            }
+            if (name == "transfer") {
+                effects.transfers = true;
+                return true;
+            }
+            return name == "log_0" || name == "log_1" || name == "log_2";
+        }
+
+        std::vector<const clang::FunctionDecl *> callees;
+        bool indirect = false;
+    };
+
     class abigen : public generation_utils {
     public:
 
@@ -68,6 +305,13 @@ namespace ftl {
                 ret.name = action_name.str();
             }
             ret.type = decl->getName().str();
+            ret.readonly = decl->getFtlActionAttr()->getAccess() == clang::FtlActionAttr::ReadOnly;
+            // the code handling a record action isn't known, so its effects can't be checked
+            if (ret.readonly) {
+                std::cout << "Error, action <" << ret.name << "> is readonly but its code is not known, "
+                          << "declare it as a readonly action method instead" << std::endl;
+                throw abigen_exception();
+            }
             _abi.actions.insert(ret);
         }
 
@@ -92,9 +336,36 @@ namespace ftl {
                 ret.name = action_name.str();
             }
             ret.type = decl->getNameAsString();
+            ret.readonly = decl->getFtlActionAttr()->getAccess() == clang::FtlActionAttr::ReadOnly;
+
+            auto effects = action_analyzer().analyze(decl);
+            if (ret.readonly)
+                check_readonly(effects, ret.name);
+            ret.analyzed = true;
+            ret.reads = effects.reads;
+            ret.writes = effects.writes;
+            ret.calls = effects.calls;
+            ret.transfers = effects.transfers;
             _abi.actions.insert(ret);
         }
 
+        /**
+         * A readonly action may be served against a snapshot without journaling, so it must not reach
+         * a db write, a transfer, a log, a call to another contract or a call whose effects are unknown
+         */
+        void check_readonly(const action_effects &effects, const std::string &action_name) {
+            bool changes = effects.unresolved.empty();
+            const auto &chain = changes ? effects.state_change : effects.unresolved;
+            if (chain.empty())
+                return;
+            std::cout << "Error, action <" << action_name << "> is readonly but "
+                      << (changes ? "changes state: " : "makes a call that can't be checked: ");
+            for (size_t i = 0; i < chain.size(); i++)
+                std::cout << (i ? " -> " : "") << chain[i]->getQualifiedNameAsString();
+            std::cout << std::endl;
+            throw abigen_exception();
+        }
+
         void add_tuple(const clang::QualType &type) {
             auto pt = llvm::dyn_cast<clang::ElaboratedType>(type.getTypePtr());
             auto tst = llvm::dyn_cast<clang::TemplateSpecializationType>(pt->desugar().getTypePtr());
@@ -142,6 +413,17 @@ namespace ftl {
             _abi.structs.insert(kv);
         }
 
+        /**
+         * ftl::fixed<Int, Scale> is encoded as its underlying integer, so it becomes an alias
+         * named after the template (e.g. fixed_int64_4) instead of a struct
+         */
+        void add_fixed(const clang::QualType &type) {
+            abi_typedef ret;
+            ret.new_type_name = get_type(type);
+            ret.type = translate_type(get_template_argument(type).getAsType());
+            _abi.typedefs.insert(ret);
+        }
+
         void add_struct(const clang::CXXRecordDecl *decl, const std::string &rname = "") {
             abi_struct ret;
             if (decl->getNumBases() == 1) {
@@ -165,8 +447,10 @@ namespace ftl {
             }
             if (!rname.empty())
                 ret.name = rname;
-            else
+            else {
                 ret.name = decl->getName().str();
+                add_serializer(decl);
+            }
             _abi.structs.insert(ret);
         }
 
@@ -181,6 +465,21 @@ namespace ftl {
             _abi.structs.insert(new_struct);
         }
 
+        /**
+         * Records the message an error code of fractal-cpp --error-codes stands for
+         */
+        void add_error_message(uint64_t code, const std::string &msg) {
+            for (const auto &e : _abi.error_messages) {
+                if (e.error_code != code)
+                    continue;
+                if (e.error_msg != msg)
+                    throw std::runtime_error("error code " + std::to_string(code) + " stands for both \"" +
+                                             e.error_msg + "\" and \"" + msg + "\"");
+                return;
+            }
+            _abi.error_messages.push_back({code, msg});
+        }
+
         void add_table(const clang::CXXRecordDecl *decl) {
             abi_table t;
             t.name = decl->getNameAsString();
@@ -192,6 +491,12 @@ namespace ftl {
                     t.value_type = get_type(field->getType());
                 }
             }
+            // DEF_FLAT_TABLE, DEF_BLOB_TABLE and DEF_VECTOR_TABLE mark the struct with a static member
+            for (auto d : decl->decls()) {
+                auto var = llvm::dyn_cast<clang::VarDecl>(d);
+                if (var && (var->getName() == "flat" || var->getName() == "chunked" || var->getName() == "vector"))
+                    t.encoding = var->getName().str();
+            }
             _abi.tables.insert(t);
         }
 
@@ -204,7 +509,9 @@ namespace ftl {
                                                     {"vector", "set", "deque", "list", "optional", "binary_extension",
                                                      "ignore"})) {
                     add_type(get_template_argument(type).getAsType());
-                } else if (is_template_specialization(type, {"map"}))
+                } else if (is_template_specialization(type, {"fixed"}))
+                    add_fixed(type);
+                else if (is_template_specialization(type, {"map"}))
                     add_map(type);
                 else if (is_template_specialization(type, {"pair"}))
                     add_pair(type);
@@ -217,6 +524,177 @@ namespace ftl {
             }
         }
 
+        static bool has_custom_stream_operator(const clang::CXXRecordDecl *decl) {
+            auto &ctx = decl->getASTContext();
+            auto refers_to_decl = [&](const clang::FunctionDecl *fd) {
+                for (auto param : fd->parameters()) {
+                    auto rd = param->getType().getNonReferenceType()->getAsCXXRecordDecl();
+                    if (rd && rd->getCanonicalDecl() == decl->getCanonicalDecl())
+                        return true;
+                }
+                return false;
+            };
+            const clang::DeclContext *contexts[] = {decl->getEnclosingNamespaceContext(), decl};
+            for (auto op : {clang::OO_LessLess, clang::OO_GreaterGreater}) {
+                auto op_name = ctx.DeclarationNames.getCXXOperatorName(op);
+                for (auto dc : contexts) {
+                    for (auto nd : dc->lookup(op_name)) {
+                        auto fd = nd->getAsFunction();
+                        if (fd && refers_to_decl(fd))
+                            return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        // only plain aggregates that can be named from global scope get a generated serializer,
+        // everything else keeps going through the reflection based operators in datastream.hpp
+        static bool is_serializer_candidate(const clang::CXXRecordDecl *decl) {
+            if (!decl || !(decl = decl->getDefinition()))
+                return false;
+            if (!decl->getIdentifier() || decl->isUnion() || decl->isLambda() || decl->isDependentContext() ||
+                decl->isInAnonymousNamespace() || decl->getParentFunctionOrMethod() ||
+                llvm::isa<clang::ClassTemplateSpecializationDecl>(decl))
+                return false;
+            if (!decl->isAggregate() || decl->getNumBases() != 0)
+                return false;
+
+            const clang::Decl *d = decl;
+            while (auto parent = llvm::dyn_cast<clang::CXXRecordDecl>(d->getDeclContext())) {
+                if (d->getAccess() != clang::AS_public || llvm::isa<clang::ClassTemplateSpecializationDecl>(parent))
+                    return false;
+                d = parent;
+            }
+
+            std::string qualified_name = decl->getQualifiedNameAsString();
+            for (std::string ns : {"ftl::", "std::", "boost::"})
+                if (qualified_name.compare(0, ns.size(), ns) == 0)
+                    return false;
+
+            for (auto field : decl->fields()) {
+                auto type = field->getType();
+                if (field->isBitField() || field->getAccess() != clang::AS_public ||
+                    type->isReferenceType() || type->isPointerType() || type.isConstQualified())
+                    return false;
+            }
+            return !has_custom_stream_operator(decl);
+        }
+
+        // returns the encoded size of types whose datastream encoding is exactly their in-memory bytes, otherwise 0
+        static size_t flat_size(const clang::QualType &type, const clang::ASTContext &ctx) {
+            auto t = type.getCanonicalType();
+            if (t->isBooleanType())
+                return 0;
+            if ((t->isBuiltinType() && t->isArithmeticType()) || t->isEnumeralType())
+                return ctx.getTypeSizeInChars(t).getQuantity();
+
+            auto rd = t->getAsCXXRecordDecl();
+            if (!rd || !(rd = rd->getDefinition()))
+                return 0;
+            size_t record_size = ctx.getTypeSizeInChars(t).getQuantity();
+            std::string qualified_name = rd->getQualifiedNameAsString();
+            if (qualified_name == "ftl::address" || qualified_name == "ftl::checksum256" ||
+                qualified_name == "ftl::uint256" || qualified_name == "ftl::int256")
+                return record_size;
+            if (!is_serializer_candidate(rd))
+                return 0;
+
+            const auto &layout = ctx.getASTRecordLayout(rd);
+            size_t size = 0;
+            for (auto field : rd->fields()) {
+                size_t field_size = flat_size(field->getType(), ctx);
+                if (!field_size || ctx.toCharUnitsFromBits(layout.getFieldOffset(field->getFieldIndex())).getQuantity() != size)
+                    return 0;
+                size += field_size;
+            }
+            return size == record_size ? size : 0;
+        }
+
+        void add_serializer(const clang::CXXRecordDecl *decl) {
+            if (!is_serializer_candidate(decl))
+                return;
+            decl = decl->getDefinition();
+            std::string type = "::" + decl->getQualifiedNameAsString();
+            if (_serializers.count(type))
+                return;
+
+            // fields are grouped into runs, adjacent fixed size fields without padding between them are
+            // copied with a single write/read, a run with size 0 holds one variable size field
+            struct field_run {
+                std::string first_field;
+                size_t size;
+            };
+            std::vector <field_run> runs;
+            const auto &ctx = decl->getASTContext();
+            const auto &layout = ctx.getASTRecordLayout(decl);
+            size_t run_end = 0;
+            for (auto field : decl->fields()) {
+                size_t size = flat_size(field->getType(), ctx);
+                size_t offset = ctx.toCharUnitsFromBits(layout.getFieldOffset(field->getFieldIndex())).getQuantity();
+                if (size && !runs.empty() && runs.back().size && run_end == offset)
+                    runs.back().size += size;
+                else
+                    runs.push_back({field->getNameAsString(), size});
+                run_end = offset + size;
+            }
+
+            // the operators go in the namespace of the struct, the only one argument dependent lookup
+            // searches from the datastream templates in ftl besides ftl itself
+            std::string open_ns, close_ns;
+            for (auto ctx = decl->getDeclContext(); !ctx->isTranslationUnit(); ctx = ctx->getParent()) {
+                if (auto ns = llvm::dyn_cast<clang::NamespaceDecl>(ctx)) {
+                    open_ns = std::string(ns->isInline() ? "inline " : "") + "namespace " + ns->getNameAsString() +
+                              " {\n" + open_ns;
+                    close_ns += "}\n";
+                }
+            }
+
+            std::stringstream ss;
+            ss << open_ns;
+            ss << "template<typename Stream>\n";
+            ss << "inline ftl::datastream<Stream> &operator<<(ftl::datastream<Stream> &ds, const " << type << " &v) {\n";
+            for (auto &r : runs) {
+                if (r.size)
+                    ss << "    ds.write((const char *) &v." << r.first_field << ", " << r.size << ");\n";
+                else
+                    ss << "    ds << v." << r.first_field << ";\n";
+            }
+            ss << "    return ds;\n}\n\n";
+            ss << "template<typename Stream>\n";
+            ss << "inline ftl::datastream<Stream> &operator>>(ftl::datastream<Stream> &ds, " << type << " &v) {\n";
+            for (auto &r : runs) {
+                if (r.size)
+                    ss << "    ds.read((char *) &v." << r.first_field << ", " << r.size << ");\n";
+                else
+                    ss << "    ds >> v." << r.first_field << ";\n";
+            }
+            ss << "    return ds;\n}\n\n";
+            // tells ftl::unpack_field the fields are still packed in order
+            ss << "std::true_type ftl_field_by_field(const " << type << " *);\n";
+            ss << close_ns;
+            _serializers[type] = ss.str();
+        }
+
+        /**
+         * Generated datastream operators for every plain struct reachable from an action or a table.
+         * They are more specialized than the reflection based class operators in datastream.hpp,
+         * so overload resolution picks them whenever they are visible at instantiation. They are
+         * declared next to their struct, which makes them visible to argument dependent lookup at
+         * the end of the unit, where clang instantiates the function templates the source used.
+         */
+        std::string to_serializers() {
+            if (_serializers.empty())
+                return "";
+            std::stringstream ss;
+            ss << "// This code was generated by fractal-abigen. DO NOT EDIT\n";
+            ss << "#include <ftllib/datastream.hpp>\n";
+            for (auto &s : _serializers)
+                ss << "\n" << s.second;
+            _serializers.clear();
+            return ss.str();
+        }
+
         std::string generate_json_comment() {
             std::stringstream ss;
             ss << "This file was generated automatically.";
@@ -229,7 +707,7 @@ namespace ftl {
             o["name"] = s.name;
             o["base"] = s.base;
             o["fields"] = ojson::array();
-            for (auto field : s.fields) {
+            for (const auto &field : s.fields) {
                 ojson f;
                 f["name"] = field.name;
                 f["type"] = field.type;
@@ -249,6 +727,18 @@ namespace ftl {
             ojson o;
             o["name"] = a.name;
             o["type"] = a.type;
+            if (a.readonly)
+                o["readonly"] = true;
+            if (a.analyzed) {
+                o["reads"] = ojson::array();
+                for (const auto &t : a.reads)
+                    o["reads"].push_back(t);
+                o["writes"] = ojson::array();
+                for (const auto &t : a.writes)
+                    o["writes"].push_back(t);
+                o["calls"] = a.calls;
+                o["transfers"] = a.transfers;
+            }
             return o;
         }
 
@@ -257,11 +747,14 @@ namespace ftl {
             o["name"] = t.name;
             o["key_type"] = t.key_type;
             o["value_type"] = t.value_type;
+            if (!t.encoding.empty())
+                o["encoding"] = t.encoding;
             return o;
         }
 
         bool is_empty() {
-            return _abi.structs.empty() && _abi.typedefs.empty() && _abi.actions.empty() && _abi.tables.empty();
+            return _abi.structs.empty() && _abi.typedefs.empty() && _abi.actions.empty() && _abi.tables.empty() &&
+                   _abi.error_messages.empty();
         }
 
         ojson to_json() {
@@ -269,7 +762,7 @@ namespace ftl {
             o["____comment"] = generate_json_comment();
             o["version"] = _abi.version;
             o["structs"] = ojson::array();
-            auto remove_suffix = [&](std::string name) {
+            auto remove_suffix = [&](const std::string &name) {
                 int i = name.length() - 1;
                 for (; i >= 0; i--)
                     if (name[i] != '[' && name[i] != ']' && name[i] != '?' && name[i] != '$')
@@ -279,73 +772,75 @@ namespace ftl {
 
             printf("generate json\n");
 
-            auto validate_struct = [&](abi_struct as) {
-                if (is_builtin_type(_translate_type(as.name)))
-                    return false;
-                for (auto s : _abi.structs) {
-                    for (auto f : s.fields) {
-                        if (as.name == _translate_type(remove_suffix(f.type)))
-                            return true;
-                    }
-                    if (s.base == as.name)
-                        return true;
-                }
-                for (auto a : _abi.actions) {
-                    if (as.name == _translate_type(a.type))
-                        return true;
-                }
-                for (auto t : _abi.tables) {
-                    if (as.name == _translate_type(t.key_type))
-                        return true;
-                    if (as.name == _translate_type(t.value_type))
-                        return true;
-                }
-                for (auto td : _abi.typedefs) {
-                    if (as.name == _translate_type(remove_suffix(td.type)))
-                        return true;
-                }
-                return false;
-            };
-
-            auto validate_types = [&](abi_typedef td) {
-                for (auto as : _abi.structs)
-                    if (validate_struct(as))
-                        for (auto f : as.fields)
-                            if (remove_suffix(f.type) == td.new_type_name)
-                                return true;
-                for (auto t : _abi.tables)
-                    if (t.value_type == td.new_type_name)
-                        return true;
-                for (auto a : _abi.actions)
-                    if (a.type == td.new_type_name)
-                        return true;
-                for (auto _td : _abi.typedefs)
-                    if (remove_suffix(_td.type) == td.new_type_name)
-                        return true;
-                return false;
+            // Index structs and typedefs by name once, then walk everything reachable from the
+            // actions and tables. Each type is expanded at most once, so this stays linear in
+            // the number of fields even with hundreds of generated pair/tuple structs.
+            std::unordered_map<std::string, const abi_struct *> struct_index;
+            std::unordered_map<std::string, const abi_typedef *> typedef_index;
+            for (const auto &s : _abi.structs)
+                struct_index.emplace(s.name, &s);
+            for (const auto &t : _abi.typedefs)
+                typedef_index.emplace(t.new_type_name, &t);
+
+            std::unordered_set<std::string> reachable;
+            std::vector<std::string> pending;
+            auto visit = [&](const std::string &type) {
+                std::string name = _translate_type(remove_suffix(type));
+                if (!name.empty() && reachable.insert(name).second)
+                    pending.push_back(std::move(name));
             };
+            for (const auto &a : _abi.actions)
+                visit(a.type);
+            for (const auto &t : _abi.tables) {
+                visit(t.key_type);
+                visit(t.value_type);
+            }
+            while (!pending.empty()) {
+                std::string name = std::move(pending.back());
+                pending.pop_back();
+                auto s = struct_index.find(name);
+                if (s != struct_index.end()) {
+                    if (!s->second->base.empty())
+                        visit(s->second->base);
+                    for (const auto &f : s->second->fields)
+                        visit(f.type);
+                }
+                auto t = typedef_index.find(name);
+                if (t != typedef_index.end())
+                    visit(t->second->type);
+            }
 
-            for (auto s : _abi.structs) {
-                if (validate_struct(s))
+            for (const auto &s : _abi.structs) {
+                if (reachable.count(s.name) && !is_builtin_type(_translate_type(s.name)))
                     o["structs"].push_back(struct_to_json(s));
             }
             o["types"] = ojson::array();
-            for (auto t : _abi.typedefs) {
-                if (validate_types(t))
+            for (const auto &t : _abi.typedefs) {
+                if (reachable.count(t.new_type_name))
                     o["types"].push_back(typedef_to_json(t));
             }
             o["actions"] = ojson::array();
-            for (auto a : _abi.actions) {
+            for (const auto &a : _abi.actions) {
                 o["actions"].push_back(action_to_json(a));
             }
             o["tables"] = ojson::array();
-            for (auto t : _abi.tables) {
+            for (const auto &t : _abi.tables) {
                 o["tables"].push_back(table_to_json(t));
             }
+            if (!_abi.error_messages.empty()) {
+                o["error_messages"] = ojson::array();
+                for (const auto &e : _abi.error_messages) {
+                    ojson m;
+                    m["error_code"] = e.error_code;
+                    m["error_msg"] = e.error_msg;
+                    o["error_messages"].push_back(m);
+                }
+            }
             return o;
         }
 
     private:
         abi _abi;
+        std::map <std::string, std::string> _serializers;
     };
 } // namespace ftl
@@ -188,6 +188,11 @@ namespace ftl {
         std::string _translate_type(const std::string &t) {
             static std::map <std::string, std::string> translation_table =
                     {
+                            {"unsigned __int128",  "uint128"},
+                            {"__int128",           "int128"},
+                            {"uint128_t",          "uint128"},
+                            {"int128_t",           "int128"},
+
                             {"unsigned long long", "uint64"},
                             {"long long",          "int64"},
                             {"uint64_t",           "uint64"},
@@ -327,6 +332,10 @@ namespace ftl {
                             "uint32",
                             "int64",
                             "uint64",
+                            "int128",
+                            "uint128",
+                            "int256",
+                            "uint256",
                             "varuint32",
                             "name",
                             "bytes",
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace ftl {
+   /**
+    * Counter maps and flushed counters of contracts built with fractal-cpp --profile.
+    *
+    * The map is the concatenation of the ".ftl_prof" sections fractal-ld finds in the objects, each
+    * module starts with "module <id> <count>" followed by one tab separated line per counter:
+    *
+    *   <index> block <instructions> <function> <file:line>
+    *   <index> host  <import>       <function> <file:line>
+    *   <index> alloc <allocator>    <function> <file:line>
+    *
+    * The ftl_prof runtime flushes the counters that are not zero as the data of a "ftl_prof" log:
+    * "FPRF" version, then id (u64) count (u32) and count (index (u32), value (u64)) per module.
+    * Allocations go to a second "ftl_prof" log starting with "FPRA", see libraries/ftllib/src/profile.cpp.
+    */
+   namespace profile {
+      static const char    magic[4]       = {'F', 'P', 'R', 'F'};
+      static const char    alloc_magic[4] = {'F', 'P', 'R', 'A'};
+      static const uint8_t format_version = 1;
+
+      enum kind_t { block, host, alloc };
+
+      struct counter {
+         kind_t      kind = block;
+         uint32_t    instructions = 0; // of the block
+         std::string callee;           // import or allocator called by the site
+         std::string function;
+         std::string location;
+      };
+
+      using maps = std::map<uint64_t, std::vector<counter>>;
+
+      inline maps parse_map(const std::string& text) {
+         maps result;
+         std::vector<counter>* current = nullptr;
+         std::istringstream in(text);
+         std::string line;
+         for (size_t n = 1; std::getline(in, line); n++) {
+            if (line.empty())
+               continue;
+            std::vector<std::string> fields;
+            std::istringstream ls(line);
+            for (std::string f; std::getline(ls, f, '\t');)
+               fields.push_back(f);
+            auto bad = [&]() {
+               return std::runtime_error("profile map line " + std::to_string(n) + ": malformed");
+            };
+
+            try {
+               if (fields.size() == 3 && fields[0] == "module") {
+                  current = &result[std::stoull(fields[1], nullptr, 16)];
+                  current->clear();
+                  current->reserve(std::stoul(fields[2]));
+                  continue;
+               }
+               if (!current || fields.size() != 5 || std::stoul(fields[0]) != current->size())
+                  throw bad();
+               counter c;
+               if (fields[1] == "block") {
+                  c.instructions = std::stoul(fields[2]);
+               } else if (fields[1] == "host" || fields[1] == "alloc") {
+                  c.kind = fields[1] == "host" ? host : alloc;
+                  c.callee = fields[2];
+               } else {
+                  throw bad();
+               }
+               c.function = fields[3];
+               c.location = fields[4];
+               current->push_back(c);
+            } catch (std::logic_error&) {
+               throw bad();
+            }
+         }
+         return result;
+      }
+
+      /**
+       * Adds the counters of one flush to totals, returns the number of modules missing from the map
+       */
+      inline size_t accumulate(const maps& map, const std::string& data,
+                               std::map<uint64_t, std::vector<uint64_t>>& totals) {
+         size_t pos = 0;
+         auto take = [&](void* out, size_t size) {
+            if (data.size() - pos < size)
+               throw std::runtime_error("profile data: truncated");
+            memcpy(out, data.data() + pos, size);
+            pos += size;
+         };
+
+         char header[5];
+         take(header, sizeof(header));
+         if (memcmp(header, magic, sizeof(magic)) != 0)
+            throw std::runtime_error("profile data: bad magic");
+         if (uint8_t(header[4]) != format_version)
+            throw std::runtime_error("profile data: unsupported format version");
+
+         size_t unknown = 0;
+         while (pos < data.size()) {
+            uint64_t id;
+            uint32_t count;
+            take(&id, 8);
+            take(&count, 4);
+            auto it = map.find(id);
+            if (it == map.end())
+               unknown++;
+            std::vector<uint64_t>* total = nullptr;
+            if (it != map.end()) {
+               total = &totals[id];
+               total->resize(it->second.size());
+            }
+            for (; count; count--) {
+               uint32_t index;
+               uint64_t value;
+               take(&index, 4);
+               take(&value, 8);
+               if (!total)
+                  continue;
+               if (index >= total->size())
+                  throw std::runtime_error("profile data: counter index out of range");
+               (*total)[index] += value;
+            }
+         }
+         return unknown;
+      }
+
+      /** (module id, counter index) of an allocation site or shadow stack frame */
+      struct frame {
+         uint64_t module = 0;
+         uint32_t index = 0;
+         bool     known = false;
+         bool operator<(const frame& o) const {
+            return std::tie(known, module, index) < std::tie(o.known, o.module, o.index);
+         }
+      };
+
+      struct alloc_context {
+         uint64_t           allocations = 0;
+         uint64_t           bytes = 0;
+         uint64_t           grown = 0; // pages
+         frame              site;
+         std::vector<frame> frames; // outermost first
+         bool               truncated = false;
+      };
+
+      struct alloc_profile {
+         size_t   flushes = 0;
+         uint32_t peak_pages = 0; // memory size at the largest flush
+         uint64_t allocations = 0;
+         uint64_t bytes = 0;
+         uint64_t max_bytes = 0; // of one flush
+         uint64_t grows = 0;
+         uint64_t grown = 0;
+         uint64_t dropped = 0;
+         std::map<std::pair<frame, std::vector<frame>>, alloc_context> contexts;
+      };
+
+      inline bool is_alloc(const std::string& data) {
+         return data.size() >= sizeof(alloc_magic) && memcmp(data.data(), alloc_magic, sizeof(alloc_magic)) == 0;
+      }
+
+      /**
+       * Adds one allocation flush to profile
+       */
+      inline void accumulate_alloc(const std::string& data, alloc_profile& profile) {
+         size_t pos = 0;
+         auto take = [&](void* out, size_t size) {
+            if (data.size() - pos < size)
+               throw std::runtime_error("allocation data: truncated");
+            memcpy(out, data.data() + pos, size);
+            pos += size;
+         };
+
+         char header[5];
+         take(header, sizeof(header));
+         if (memcmp(header, alloc_magic, sizeof(alloc_magic)) != 0)
+            throw std::runtime_error("allocation data: bad magic");
+         if (uint8_t(header[4]) != format_version)
+            throw std::runtime_error("allocation data: unsupported format version");
+
+         uint32_t pages, grows, grown, modules;
+         uint64_t allocations, bytes, dropped;
+         take(&pages, 4);
+         take(&allocations, 8);
+         take(&bytes, 8);
+         take(&grows, 4);
+         take(&grown, 4);
+         take(&dropped, 8);
+         take(&modules, 4);
+         std::vector<uint64_t> ids(modules);
+         for (auto& id : ids)
+            take(&id, 8);
+         auto read_frame = [&]() {
+            uint32_t module, index;
+            take(&module, 4);
+            take(&index, 4);
+            frame f;
+            if (module == 0xffffffff)
+               return f;
+            if (module >= ids.size())
+               throw std::runtime_error("allocation data: module index out of range");
+            f.module = ids[module];
+            f.index  = index;
+            f.known  = true;
+            return f;
+         };
+
+         uint32_t contexts;
+         take(&contexts, 4);
+         for (; contexts; contexts--) {
+            alloc_context c;
+            uint32_t grown_pages, depth;
+            uint8_t truncated;
+            take(&c.allocations, 8);
+            take(&c.bytes, 8);
+            take(&grown_pages, 4);
+            c.grown = grown_pages;
+            c.site = read_frame();
+            take(&depth, 4);
+            take(&truncated, 1);
+            c.truncated = truncated;
+            for (; depth; depth--)
+               c.frames.push_back(read_frame());
+
+            auto& total = profile.contexts[std::make_pair(c.site, c.frames)];
+            total.allocations += c.allocations;
+            total.bytes += c.bytes;
+            total.grown += c.grown;
+            total.site = c.site;
+            total.frames = c.frames;
+            total.truncated |= c.truncated;
+         }
+         if (pos != data.size())
+            throw std::runtime_error("allocation data: trailing bytes");
+
+         profile.flushes++;
+         profile.peak_pages = std::max(profile.peak_pages, pages);
+         profile.allocations += allocations;
+         profile.bytes += bytes;
+         profile.max_bytes = std::max(profile.max_bytes, bytes);
+         profile.grows += grows;
+         profile.grown += grown;
+         profile.dropped += dropped;
+      }
+
+      inline std::string from_hex(const std::string& hex) {
+         auto nibble = [](char c) -> int {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            throw std::runtime_error("profile data: invalid hex");
+         };
+         size_t begin = hex.compare(0, 2, "0x") == 0 ? 2 : 0;
+         if ((hex.size() - begin) % 2)
+            throw std::runtime_error("profile data: odd number of hex digits");
+         std::string out;
+         out.reserve((hex.size() - begin) / 2);
+         for (size_t i = begin; i < hex.size(); i += 2)
+            out.push_back(char(nibble(hex[i]) << 4 | nibble(hex[i + 1])));
+         return out;
+      }
+   }
+}
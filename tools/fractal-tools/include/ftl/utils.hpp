@@ -148,10 +148,8 @@ namespace ftl {
             if (root)
                 find_path = "/usr/bin";
             if (auto path = llvm::sys::findProgramByName(prog.c_str(), {find_path}))
-                std::system((*path + " " + args.str()).c_str());
-            else
-                return false;
-            return true;
+                return std::system((*path + " " + args.str()).c_str()) == 0;
+            return false;
         }
 
     };
@@ -0,0 +1,161 @@
+//===- FtlErrorCodes ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Replaces the constant messages of ftl_assert and ftl_assert_message calls by
+// numeric codes passed to ftl_assert_code when -ftl-error-codes is given
+// (fractal-cpp --error-codes), so the strings drop out of the data segments.
+// The code of a message is its FNV-1a hash with the top bit set, which keeps
+// them apart from the small codes contracts pass to ftl::check themselves.
+// The code to message map goes to the ".ftl_errors" custom section, one
+// "<code>\t<message>" line per code with \, tab and newline escaped, and
+// fractal-cpp copies it to the error_messages of the abi.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Type.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<bool> EnableFtlErrorCodes("ftl-error-codes",
+                                         cl::desc("Replace constant check messages by error codes"),
+                                         cl::init(false));
+
+namespace {
+    // FtlErrorCodes - Intern the constant messages of failed checks
+    struct FtlErrorCodes : public ModulePass {
+        static char ID;
+
+        FtlErrorCodes() : ModulePass(ID) {}
+
+        static uint32_t errorCode(StringRef Msg) {
+            uint32_t Hash = 2166136261u;
+            for (char c : Msg) {
+                Hash ^= uint8_t(c);
+                Hash *= 16777619u;
+            }
+            return Hash | 0x80000000u;
+        }
+
+        static void escape(raw_ostream &os, StringRef Msg) {
+            for (char c : Msg) {
+                if (c == '\\')
+                    os << "\\\\";
+                else if (c == '\t')
+                    os << "\\t";
+                else if (c == '\n')
+                    os << "\\n";
+                else
+                    os << c;
+            }
+        }
+
+        bool runOnModule(Module &M) override {
+            if (!EnableFtlErrorCodes)
+                return false;
+
+            Function *Assert = M.getFunction("ftl_assert");
+            Function *AssertMessage = M.getFunction("ftl_assert_message");
+            std::map<uint32_t, std::string> Messages;
+            std::vector<std::pair<CallInst *, uint32_t>> Calls;
+            for (Function *F : {Assert, AssertMessage}) {
+                if (!F)
+                    continue;
+                for (User *U : F->users()) {
+                    auto *Call = dyn_cast<CallInst>(U);
+                    if (!Call || Call->getCalledFunction() != F)
+                        continue;
+                    StringRef Msg;
+                    if (!getConstantStringInfo(Call->getArgOperand(1), Msg, 0, F == Assert))
+                        continue;
+                    if (F == AssertMessage) {
+                        auto *Len = dyn_cast<ConstantInt>(Call->getArgOperand(2));
+                        if (!Len || Len->getZExtValue() > Msg.size())
+                            continue;
+                        Msg = Msg.substr(0, Len->getZExtValue());
+                    }
+                    auto It = Messages.emplace(errorCode(Msg), Msg.str());
+                    // two messages with the same code, the second one keeps its string
+                    if (It.first->second != Msg)
+                        continue;
+                    Calls.emplace_back(Call, It.first->first);
+                }
+            }
+            if (Calls.empty())
+                return false;
+
+            LLVMContext &Ctx = M.getContext();
+            IntegerType *I64Ty = Type::getInt64Ty(Ctx);
+            Function *AssertCode = M.getFunction("ftl_assert_code");
+            if (!AssertCode) {
+                // declared like the import it replaces, base.hpp has ftl_assert_code(uint32_t, uint64_t)
+                Function *Import = Assert ? Assert : AssertMessage;
+                FunctionType *Ty = FunctionType::get(Type::getVoidTy(Ctx),
+                                                     {Import->getFunctionType()->getParamType(0), I64Ty}, false);
+                AssertCode = Function::Create(Ty, GlobalValue::ExternalLinkage, "ftl_assert_code", &M);
+                AssertCode->setAttributes(AttributeList::get(Ctx, AttributeList::FunctionIndex,
+                        AttrBuilder(Import->getAttributes(), AttributeList::FunctionIndex)));
+            }
+
+            std::set<GlobalVariable *> Strings;
+            for (const auto &C : Calls) {
+                if (auto *GV = dyn_cast<GlobalVariable>(C.first->getArgOperand(1)->stripPointerCasts()))
+                    Strings.insert(GV);
+                CallInst *Call = CallInst::Create(AssertCode, {C.first->getArgOperand(0),
+                                                               ConstantInt::get(I64Ty, C.second)}, "", C.first);
+                Call->setDebugLoc(C.first->getDebugLoc());
+                C.first->eraseFromParent();
+            }
+            for (GlobalVariable *GV : Strings) {
+                GV->removeDeadConstantUsers();
+                if (GV->use_empty() && GV->hasLocalLinkage())
+                    GV->eraseFromParent();
+            }
+
+            std::string section;
+            raw_string_ostream ss(section);
+            for (const auto &Msg : Messages) {
+                ss << Msg.first << "\t";
+                escape(ss, Msg.second);
+                ss << "\n";
+            }
+            ss.flush();
+            M.getOrInsertNamedMetadata("wasm.custom_sections")->addOperand(
+                    MDTuple::get(Ctx, {MDString::get(Ctx, ".ftl_errors"), MDString::get(Ctx, section)}));
+            return true;
+        }
+    };
+}
+
+char FtlErrorCodes::ID = 0;
+static RegisterPass<FtlErrorCodes> X("ftl_error_codes", "Fractal Error Codes");
+
+static void registerFtlErrorCodesPass(const PassManagerBuilder &, legacy::PassManagerBase &PM) {
+    PM.add(new FtlErrorCodes());
+}
+
+static RegisterStandardPasses RegisterErrorCodesPass(PassManagerBuilder::EP_OptimizerLast,
+                                                     registerFtlErrorCodesPass);
+static RegisterStandardPasses RegisterErrorCodesPassO0(PassManagerBuilder::EP_EnabledOnOptLevel0,
+                                                       registerFtlErrorCodesPass);
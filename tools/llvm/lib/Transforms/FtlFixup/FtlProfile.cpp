@@ -0,0 +1,219 @@
+//===- FtlProfile ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Counts the executions of every basic block, host call and allocation site
+// when -ftl-profile is given (fractal-cpp --profile). The counters of a module
+// are an array in linear memory registered with the ftl_prof runtime by a
+// constructor and flushed by apply. The map from counter index to function and
+// source line goes to the ".ftl_prof" custom section, fractal-ld collects the
+// sections of all objects in the side-car file fractal-prof reads.
+//
+// For the allocation profile every function pushes its entry block counter on
+// the shadow stack of the runtime, and allocation calls store their counter in
+// __ftl_prof_site, ftl_malloc_prof attributes each allocation to both.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Type.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/ADT/StringSwitch.h"
+
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<bool> EnableFtlProfile("ftl-profile",
+                                      cl::desc("Count basic block and host call executions"),
+                                      cl::init(false));
+
+namespace {
+    // FtlProfile - Instrument the module with profile counters
+    struct FtlProfile : public ModulePass {
+        static char ID;
+
+        FtlProfile() : ModulePass(ID) {}
+
+        static bool isAlloc(const Function &F) {
+            return StringSwitch<bool>(F.getName())
+                    .Cases("malloc", "calloc", "realloc", true)
+                    .Cases("_Znwm", "_Znam", "_Znwj", "_Znaj", true)
+                    .Cases("_ZnwmRKSt9nothrow_t", "_ZnamRKSt9nothrow_t", true)
+                    .Cases("_ZnwjRKSt9nothrow_t", "_ZnajRKSt9nothrow_t", true)
+                    .Default(false);
+        }
+
+        static bool isEntry(const Function &F) {
+            return F.hasFnAttribute("ftl_wasm_entry") || F.getName().equals("apply");
+        }
+
+        // source line of the first instruction from I on that has one
+        static std::string location(const Instruction *I) {
+            for (; I; I = I->getNextNode()) {
+                if (const DILocation *Loc = I->getDebugLoc().get())
+                    return (Loc->getFilename() + ":" + Twine(Loc->getLine())).str();
+            }
+            return "?:0";
+        }
+
+        bool runOnModule(Module &M) override {
+            if (!EnableFtlProfile)
+                return false;
+
+            LLVMContext &Ctx = M.getContext();
+            Type *VoidTy = Type::getVoidTy(Ctx);
+            Type *I8PtrTy = Type::getInt8PtrTy(Ctx);
+            IntegerType *I32Ty = Type::getInt32Ty(Ctx);
+            IntegerType *I64Ty = Type::getInt64Ty(Ctx);
+
+            // one counter per insertion point, a line of the map each
+            std::vector<Instruction *> counters;
+            std::vector<Instruction *> flushes;
+            // entry block counter of each function, counter of each allocation call
+            std::vector<std::pair<Function *, size_t>> frames;
+            std::vector<std::pair<Instruction *, size_t>> sites;
+            std::string map;
+            raw_string_ostream os(map);
+
+            for (Function &F : M) {
+                if (F.isDeclaration() || F.getName().startswith("__ftl_prof_"))
+                    continue;
+                frames.emplace_back(&F, counters.size());
+                for (BasicBlock &BB : F) {
+                    unsigned weight = 0;
+                    for (const Instruction &I : BB) {
+                        if (!isa<DbgInfoIntrinsic>(I) && !isa<PHINode>(I))
+                            weight++;
+                    }
+                    os << counters.size() << "\tblock\t" << weight << "\t" << F.getName() << "\t"
+                       << location(&BB.front()) << "\n";
+                    counters.push_back(&*BB.getFirstInsertionPt());
+
+                    for (Instruction &I : BB) {
+                        auto *Call = dyn_cast<CallInst>(&I);
+                        Function *Callee = Call ? Call->getCalledFunction() : nullptr;
+                        if (Callee && isAlloc(*Callee)) {
+                            os << counters.size() << "\talloc\t" << Callee->getName() << "\t" << F.getName()
+                               << "\t" << location(&I) << "\n";
+                            sites.emplace_back(Call, counters.size());
+                            counters.push_back(Call);
+                            continue;
+                        }
+                        if (!Callee || !Callee->hasFnAttribute("ftl_wasm_import"))
+                            continue;
+                        os << counters.size() << "\thost\t" << Callee->getName() << "\t" << F.getName() << "\t"
+                           << location(&I) << "\n";
+                        counters.push_back(Call);
+                        if (Callee->getName().equals("ftl_exit"))
+                            flushes.push_back(Call);
+                    }
+                    if (isEntry(F) && isa<ReturnInst>(BB.getTerminator()))
+                        flushes.push_back(BB.getTerminator());
+                }
+            }
+            if (counters.empty())
+                return false;
+            os.flush();
+
+            // FNV-1a of the map, matches the flushed counters with their map entry
+            uint64_t id = 14695981039346656037ULL;
+            for (char c : M.getModuleIdentifier() + map) {
+                id ^= uint8_t(c);
+                id *= 1099511628211ULL;
+            }
+
+            ArrayType *CountersTy = ArrayType::get(I64Ty, counters.size());
+            auto *Counters = new GlobalVariable(M, CountersTy, false, GlobalValue::InternalLinkage,
+                                                Constant::getNullValue(CountersTy), "__ftl_prof_counters");
+            IRBuilder<> builder(Ctx);
+            for (size_t i = 0; i < counters.size(); i++) {
+                builder.SetInsertPoint(counters[i]);
+                Value *Ptr = builder.CreateConstInBoundsGEP2_64(Counters, 0, i);
+                builder.CreateStore(builder.CreateAdd(builder.CreateLoad(Ptr), ConstantInt::get(I64Ty, 1)), Ptr);
+            }
+
+            PointerType *I64PtrTy = I64Ty->getPointerTo();
+            auto counter = [&](size_t i) {
+                return ConstantExpr::getInBoundsGetElementPtr(CountersTy, Counters,
+                        ArrayRef<Constant *>{ConstantInt::get(I32Ty, 0), ConstantInt::get(I32Ty, i)});
+            };
+            Constant *Site = M.getOrInsertGlobal("__ftl_prof_site", I64PtrTy);
+            for (const auto &S : sites)
+                new StoreInst(counter(S.second), Site, S.first);
+
+            Constant *Enter = M.getOrInsertFunction("__ftl_prof_enter", VoidTy, I64PtrTy);
+            Constant *Leave = M.getOrInsertFunction("__ftl_prof_leave", VoidTy);
+            for (const auto &F : frames) {
+                // after the increment of the entry block counter
+                CallInst::Create(Enter, {counter(F.second)}, "", counters[F.second]);
+                for (BasicBlock &BB : *F.first) {
+                    if (isa<ReturnInst>(BB.getTerminator()))
+                        CallInst::Create(Leave, {}, "", BB.getTerminator());
+                }
+            }
+
+            // struct __ftl_prof_module of the runtime
+            StructType *ModuleTy = StructType::get(I64Ty, I64Ty->getPointerTo(), I32Ty, I8PtrTy);
+            auto *Desc = new GlobalVariable(M, ModuleTy, false, GlobalValue::InternalLinkage,
+                                            ConstantStruct::get(ModuleTy, {
+                                                    ConstantInt::get(I64Ty, id),
+                                                    ConstantExpr::getPointerCast(Counters, I64Ty->getPointerTo()),
+                                                    ConstantInt::get(I32Ty, counters.size()),
+                                                    ConstantPointerNull::get(cast<PointerType>(I8PtrTy))}),
+                                            "__ftl_prof_module");
+
+            Constant *Register = M.getOrInsertFunction("__ftl_prof_register", VoidTy, I8PtrTy);
+            Function *Init = Function::Create(FunctionType::get(VoidTy, false), GlobalValue::InternalLinkage,
+                                              "__ftl_prof_init", &M);
+            builder.SetInsertPoint(BasicBlock::Create(Ctx, "", Init));
+            builder.CreateCall(Register, {builder.CreatePointerCast(Desc, I8PtrTy)});
+            builder.CreateRetVoid();
+            appendToGlobalCtors(M, Init, 0);
+
+            Constant *Flush = M.getOrInsertFunction("__ftl_prof_flush", VoidTy);
+            for (Instruction *I : flushes)
+                CallInst::Create(Flush, {}, "", I);
+
+            std::string section;
+            raw_string_ostream ss(section);
+            ss << "module\t" << format_hex_no_prefix(id, 16) << "\t" << counters.size() << "\n" << map;
+            ss.flush();
+            M.getOrInsertNamedMetadata("wasm.custom_sections")->addOperand(
+                    MDTuple::get(Ctx, {MDString::get(Ctx, ".ftl_prof"), MDString::get(Ctx, section)}));
+
+            // the line tables were only requested for the map
+            StripDebugInfo(M);
+            return true;
+        }
+    };
+}
+
+char FtlProfile::ID = 0;
+static RegisterPass<FtlProfile> X("ftl_profile", "Fractal Profile");
+
+static void registerFtlProfilePass(const PassManagerBuilder &, legacy::PassManagerBase &PM) {
+    PM.add(new FtlProfile());
+}
+
+static RegisterStandardPasses RegisterProfilePass(PassManagerBuilder::EP_OptimizerLast, registerFtlProfilePass);
+static RegisterStandardPasses RegisterProfilePassO0(PassManagerBuilder::EP_EnabledOnOptLevel0,
+                                                    registerFtlProfilePass);
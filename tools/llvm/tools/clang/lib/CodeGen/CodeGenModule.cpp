@@ -2397,12 +2397,15 @@ llvm::Constant *CodeGenModule::GetOrCreateLLVMFunction(
 
   bool isWasmImport = false;
   bool isWasmEntry  = false;
+  FtlWasmImportAttr::EffectType wasmImportEffect = FtlWasmImportAttr::Any;
 
   // Any attempts to use a MultiVersion function should result in retrieving
   // the iFunc instead. Name Mangling will handle the rest of the changes.
   if (const FunctionDecl *FD = cast_or_null<FunctionDecl>(D)) {
-     if (FD->hasAttr<FtlWasmImportAttr>())
+     if (const auto *IA = FD->getAttr<FtlWasmImportAttr>()) {
         isWasmImport = true;
+        wasmImportEffect = IA->getEffect();
+     }
      if (FD->hasAttr<FtlWasmEntryAttr>())
         isWasmEntry = true;
 
@@ -2521,8 +2524,27 @@ llvm::Constant *CodeGenModule::GetOrCreateLLVMFunction(
     llvm::AttrBuilder B(ExtraAttrs, llvm::AttributeList::FunctionIndex);
     F->addAttributes(llvm::AttributeList::FunctionIndex, B);
   }
-  if (isWasmImport)
+  if (isWasmImport) {
    F->addFnAttr("ftl_wasm_import", "true");
+   // host functions never unwind into the contract, with a memory effect
+   // this lets the optimizer merge repeated calls and hoist them out of loops
+   switch (wasmImportEffect) {
+   case FtlWasmImportAttr::Pure:
+      F->addFnAttr(llvm::Attribute::ReadNone);
+      F->addFnAttr(llvm::Attribute::NoUnwind);
+      break;
+   case FtlWasmImportAttr::ReadOnly:
+      F->addFnAttr(llvm::Attribute::ReadOnly);
+      F->addFnAttr(llvm::Attribute::NoUnwind);
+      break;
+   case FtlWasmImportAttr::ArgMemOnly:
+      F->addFnAttr(llvm::Attribute::ArgMemOnly);
+      F->addFnAttr(llvm::Attribute::NoUnwind);
+      break;
+   case FtlWasmImportAttr::Any:
+      break;
+   }
+  }
 
   if (isWasmEntry)
    F->addFnAttr("ftl_wasm_entry", "true");
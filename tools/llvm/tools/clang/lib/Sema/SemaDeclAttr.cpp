@@ -399,17 +399,53 @@ static void handleFtlContractAttribute(Sema &S, Decl *D, const AttributeList &AL
 }
 
 static void handleFtlActionAttribute(Sema &S, Decl *D, const AttributeList &AL) {
+  // An optional access identifier comes first: action(readonly, "name").
+  FtlActionAttr::AccessType Access = FtlActionAttr::ReadWrite;
+  unsigned NameIdx = 0;
+  if (AL.getNumArgs() > 0 && AL.isArgIdent(0)) {
+    IdentifierInfo *II = AL.getArgAsIdent(0)->Ident;
+    if (!FtlActionAttr::ConvertStrToAccessType(II->getName(), Access)) {
+      S.Diag(AL.getLoc(), diag::err_attribute_type_not_supported)
+        << AL.getName() << II;
+      return;
+    }
+    NameIdx = 1;
+  }
+
   // Handle the cases where the attribute has a text message.
   StringRef Str, Replacement;
-  if (AL.isArgExpr(0) && AL.getArgAsExpr(0) &&
-      !S.checkStringLiteralArgumentAttr(AL, 0, Str))
+  if (AL.getNumArgs() > NameIdx && AL.isArgExpr(NameIdx) &&
+      AL.getArgAsExpr(NameIdx) &&
+      !S.checkStringLiteralArgumentAttr(AL, NameIdx, Str))
     return;
 
   D->addAttr(::new (S.Context)
-                 FtlActionAttr(AL.getRange(), S.Context, Str,
+                 FtlActionAttr(AL.getRange(), S.Context, Access, Str,
                                 AL.getAttributeSpellingListIndex()));
 }
 
+static void handleFtlWasmImportAttribute(Sema &S, Decl *D, const AttributeList &AL) {
+  FtlWasmImportAttr::EffectType Effect = FtlWasmImportAttr::Any;
+  if (AL.getNumArgs() > 0) {
+    if (!AL.isArgIdent(0)) {
+      S.Diag(AL.getLoc(), diag::err_attribute_argument_n_type)
+        << AL.getName() << 1 << AANT_ArgumentIdentifier;
+      return;
+    }
+
+    IdentifierInfo *II = AL.getArgAsIdent(0)->Ident;
+    if (!FtlWasmImportAttr::ConvertStrToEffectType(II->getName(), Effect)) {
+      S.Diag(AL.getLoc(), diag::err_attribute_type_not_supported)
+        << AL.getName() << II;
+      return;
+    }
+  }
+
+  D->addAttr(::new (S.Context)
+                 FtlWasmImportAttr(AL.getRange(), S.Context, Effect,
+                                   AL.getAttributeSpellingListIndex()));
+}
+
 static void handleFtlTableAttribute(Sema &S, Decl *D, const AttributeList &AL) {
   // Handle the cases where the attribute has a text message.
   StringRef Str, Replacement;
@@ -5855,7 +5891,7 @@ static void ProcessDeclAttribute(Sema &S, Scope *scope, Decl *D,
         << AL.getName() << D->getLocation();
     break;
   case AttributeList::AT_FtlWasmImport:
-    handleSimpleAttribute<FtlWasmImportAttr>(S, D, AL);
+    handleFtlWasmImportAttribute(S, D, AL);
     break;
   case AttributeList::AT_FtlWasmEntry:
     handleSimpleAttribute<FtlWasmEntryAttr>(S, D, AL);
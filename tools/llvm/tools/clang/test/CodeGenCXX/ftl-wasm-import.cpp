@@ -0,0 +1,63 @@
+// RUN: %clang_cc1 -triple wasm32-unknown-unknown -std=c++11 -O2 -emit-llvm -o - %s | FileCheck %s
+
+// The effect of an ftl::wasm_import lets the optimizer merge repeated calls:
+// pure ones everywhere, readonly ones only while no memory is written between
+// them, and unmarked ones never.
+
+extern "C" {
+[[ftl::wasm_import]] int any_import(int);
+[[ftl::wasm_import(pure)]] int pure_import(int);
+[[ftl::wasm_import(readonly)]] int readonly_import(int);
+}
+
+int state;
+
+// CHECK-LABEL: define {{.*}}@twice_pure(
+// CHECK: call i32 @pure_import(
+// CHECK-NOT: call {{.*}}@
+// CHECK: ret i32
+extern "C" int twice_pure(int x) { return pure_import(x) + pure_import(x); }
+
+// CHECK-LABEL: define {{.*}}@twice_pure_across_store(
+// CHECK: call i32 @pure_import(
+// CHECK-NOT: call {{.*}}@
+// CHECK: ret i32
+extern "C" int twice_pure_across_store(int x) {
+  int a = pure_import(x);
+  state = a;
+  return a + pure_import(x);
+}
+
+// CHECK-LABEL: define {{.*}}@twice_readonly(
+// CHECK: call i32 @readonly_import(
+// CHECK-NOT: call {{.*}}@
+// CHECK: ret i32
+extern "C" int twice_readonly(int x) { return readonly_import(x) + readonly_import(x); }
+
+// CHECK-LABEL: define {{.*}}@twice_readonly_across_store(
+// CHECK: call i32 @readonly_import(
+// CHECK: store
+// CHECK: call i32 @readonly_import(
+// CHECK: ret i32
+extern "C" int twice_readonly_across_store(int x) {
+  int a = readonly_import(x);
+  state = a;
+  return a + readonly_import(x);
+}
+
+// CHECK-LABEL: define {{.*}}@twice_any(
+// CHECK: call i32 @any_import(
+// CHECK: call i32 @any_import(
+// CHECK: ret i32
+extern "C" int twice_any(int x) { return any_import(x) + any_import(x); }
+
+// CHECK-LABEL: define {{.*}}@loop_pure(
+// CHECK: call i32 @pure_import(
+// CHECK-NOT: call {{.*}}@
+// CHECK: ret i32
+extern "C" int loop_pure(int x, int n) {
+  int sum = 0;
+  for (int i = 0; i < n; i++)
+    sum += pure_import(x);
+  return sum;
+}
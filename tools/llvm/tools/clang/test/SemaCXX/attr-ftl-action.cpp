@@ -0,0 +1,16 @@
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s
+
+struct [[ftl::action]] transfer_args {};
+struct [[ftl::action(readonly)]] balance_args {};
+struct [[ftl::action(bogus)]] bogus_args {}; // expected-error {{'action' attribute argument not supported: 'bogus'}}
+
+struct contract {
+  [[ftl::action]] void a();
+  [[ftl::action("b")]] void b();
+  [[ftl::action(readwrite)]] void c();
+  [[ftl::action(readonly, "d")]] void d();
+  [[ftl::action(readonly_)]] void e(); // expected-error {{'action' attribute argument not supported: 'readonly_'}}
+  [[ftl::action(bogus, "f")]] void f(); // expected-error {{'action' attribute argument not supported: 'bogus'}}
+  void g() __attribute__((ftl_action(readonly)));
+  void h() __attribute__((ftl_action(readwrit))); // expected-error {{'ftl_action' attribute argument not supported: 'readwrit'}}
+};
@@ -0,0 +1,13 @@
+// RUN: %clang_cc1 -std=c++11 -fsyntax-only -verify %s
+
+extern "C" {
+[[ftl::wasm_import]] void a();
+[[ftl::wasm_import(any)]] void b();
+[[ftl::wasm_import(pure)]] int c();
+[[ftl::wasm_import(readonly)]] int d(const void *);
+[[ftl::wasm_import(argmemonly)]] void e(void *);
+[[ftl::wasm_import(readnone)]] int g(); // expected-error {{'wasm_import' attribute argument not supported: 'readnone'}}
+[[ftl::wasm_import("pure")]] int h(); // expected-error {{'wasm_import' attribute requires parameter 1 to be an identifier}}
+int i() __attribute__((ftl_wasm_import(pure)));
+int j() __attribute__((ftl_wasm_import(pur))); // expected-error {{'ftl_wasm_import' attribute argument not supported: 'pur'}}
+}